@@ -0,0 +1,548 @@
+/*
+ * Tscheme: A Tiny Scheme Interpreter
+ * Copyright (c) 1995-2013 Takuo WATANABE (Tokyo Institute of Technology)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdbool.h>
+#include <setjmp.h>
+
+#include "tscheme.h"
+
+/* Bignums
+
+   An exact integer out of fixnum range is a bignum: its magnitude
+   is a malloc'ed array of 32-bit digits, least significant first and
+   with no leading zero digit, and BIG_SIZE is the number of digits,
+   negated for a negative number.  Every operation returns a fixnum
+   when the result fits in one, so an exact integer has a single
+   representation and a bignum is never zero.
+
+   The functions taking SCM arguments accept fixnums and bignums
+   alike; the nat_* ones work on bare magnitudes.  Multiplication is
+   schoolbook below KARATSUBA_THRESHOLD digits and Karatsuba above.
+   Decimal conversion works in chunks of 9 digits; reading a long
+   numeral splits it in halves joined by a multiplication, so that it
+   takes advantage of Karatsuba. */
+
+typedef unsigned int digit;
+typedef unsigned long long ddigit;
+
+#define DIGIT_BITS 32
+#define DIGIT_BASE ((ddigit)1 << DIGIT_BITS)
+#define KARATSUBA_THRESHOLD 32
+#define DEC_CHUNK 1000000000U
+#define DEC_CHUNK_DIGITS 9
+#define PARSE_SPLIT_DIGITS 1000
+
+static digit *alloc_digits(long n) {
+    digit *d;
+    if ((d = (digit *)calloc((size_t)(n > 0 ? n : 1), sizeof(digit))) == NULL)
+        fatal_error("malloc: bignum");
+    return d;
+}
+
+/* The length of the N digits at D without leading zeros */
+static long nat_trim(const digit *d, long n) {
+    while (n > 0 && d[n - 1] == 0)
+        n--;
+    return n;
+}
+
+static int nat_cmp(const digit *a, long na, const digit *b, long nb) {
+    if (na != nb)
+        return na < nb ? -1 : 1;
+    while (na-- > 0)
+        if (a[na] != b[na])
+            return a[na] < b[na] ? -1 : 1;
+    return 0;
+}
+
+/* R[0..NR) += A[0..NA); the sum must fit in NR digits */
+static void nat_add_to(digit *r, long nr, const digit *a, long na) {
+    ddigit carry = 0;
+    long i;
+    for (i = 0; i < na; i++) {
+        carry += (ddigit)r[i] + a[i];
+        r[i] = (digit)carry;
+        carry >>= DIGIT_BITS;
+    }
+    for (; carry != 0 && i < nr; i++) {
+        carry += r[i];
+        r[i] = (digit)carry;
+        carry >>= DIGIT_BITS;
+    }
+}
+
+/* R[0..NR) -= A[0..NA); the difference must not be negative */
+static void nat_sub_from(digit *r, long nr, const digit *a, long na) {
+    digit borrow = 0;
+    long i;
+    for (i = 0; i < na; i++) {
+        ddigit s = (ddigit)a[i] + borrow;
+        borrow = r[i] < s;
+        r[i] = (digit)(r[i] - s);
+    }
+    for (; borrow != 0 && i < nr; i++) {
+        borrow = r[i] == 0;
+        r[i]--;
+    }
+}
+
+static void nat_mul_school(digit *r, const digit *a, long na,
+                           const digit *b, long nb) {
+    long i, j;
+    memset(r, 0, (size_t)(na + nb) * sizeof(digit));
+    for (i = 0; i < nb; i++) {
+        ddigit carry = 0;
+        if (b[i] == 0)
+            continue;
+        for (j = 0; j < na; j++) {
+            carry += (ddigit)a[j] * b[i] + r[i + j];
+            r[i + j] = (digit)carry;
+            carry >>= DIGIT_BITS;
+        }
+        r[i + na] = (digit)carry;
+    }
+}
+
+/* R[0..NA+NB) = A * B */
+static void nat_mul(digit *r, const digit *a, long na,
+                    const digit *b, long nb) {
+    digit *t;
+    long m, i;
+
+    if (na < nb) {
+        const digit *x = a;
+        a = b;
+        b = x;
+        m = na;
+        na = nb;
+        nb = m;
+    }
+    if (nb < KARATSUBA_THRESHOLD) {
+        nat_mul_school(r, a, na, b, nb);
+        return;
+    }
+    if (2 * nb <= na) {
+        /* unbalanced: multiply B by slices of A as long as B */
+        memset(r, 0, (size_t)(na + nb) * sizeof(digit));
+        t = alloc_digits(2 * nb);
+        for (i = 0; i < na; i += nb) {
+            m = na - i < nb ? na - i : nb;
+            nat_mul(t, a + i, m, b, nb);
+            nat_add_to(r + i, na + nb - i, t, m + nb);
+        }
+        free(t);
+        return;
+    }
+
+    /* A = A1 B^m + A0, B = B1 B^m + B0, where na > nb > m */
+    {
+        long la, lb, lz;
+        digit *sa, *sb, *z1;
+
+        m = na / 2;
+        la = na - m + 1;
+        lb = (nb - m > m ? nb - m : m) + 1;
+        sa = alloc_digits(la);
+        sb = alloc_digits(lb);
+        z1 = alloc_digits(la + lb);
+        memcpy(sa, a + m, (size_t)(na - m) * sizeof(digit));
+        nat_add_to(sa, la, a, m);
+        memcpy(sb, b, (size_t)m * sizeof(digit));
+        nat_add_to(sb, lb, b + m, nb - m);
+        nat_mul(z1, sa, nat_trim(sa, la), sb, nat_trim(sb, lb));
+        lz = la + lb;
+        nat_mul(r, a, m, b, m);
+        nat_mul(r + 2 * m, a + m, na - m, b + m, nb - m);
+        nat_sub_from(z1, lz, r, 2 * m);
+        nat_sub_from(z1, lz, r + 2 * m, na + nb - 2 * m);
+        nat_add_to(r + m, na + nb - m, z1, nat_trim(z1, lz));
+        free(sa);
+        free(sb);
+        free(z1);
+    }
+}
+
+/* Divides A[0..NA) by the digit D in place; returns the remainder */
+static digit nat_div_digit(digit *a, long na, digit d) {
+    ddigit rem = 0;
+    while (na-- > 0) {
+        rem = (rem << DIGIT_BITS) | a[na];
+        a[na] = (digit)(rem / d);
+        rem %= d;
+    }
+    return (digit)rem;
+}
+
+static int leading_zeros(digit d) {
+    int n = 0;
+    while ((d & ((digit)1 << (DIGIT_BITS - 1))) == 0) {
+        d <<= 1;
+        n++;
+    }
+    return n;
+}
+
+/* Q[0..NU-NV+1) and R[0..NV) = U / V and U mod V, where NU >= NV >= 2
+   and V has no leading zero (Knuth's algorithm D) */
+static void nat_divmod(digit *q, digit *r, const digit *u, long nu,
+                       const digit *v, long nv) {
+    digit *un = alloc_digits(nu + 1), *vn = alloc_digits(nv);
+    int s = leading_zeros(v[nv - 1]);
+    long i, j;
+
+    for (i = nv - 1; i > 0; i--)
+        vn[i] = (v[i] << s) | (digit)((ddigit)v[i - 1] >> (DIGIT_BITS - s));
+    vn[0] = v[0] << s;
+    un[nu] = (digit)((ddigit)u[nu - 1] >> (DIGIT_BITS - s));
+    for (i = nu - 1; i > 0; i--)
+        un[i] = (u[i] << s) | (digit)((ddigit)u[i - 1] >> (DIGIT_BITS - s));
+    un[0] = u[0] << s;
+
+    for (j = nu - nv; j >= 0; j--) {
+        ddigit num = ((ddigit)un[j + nv] << DIGIT_BITS) | un[j + nv - 1];
+        ddigit qhat = num / vn[nv - 1], rhat = num % vn[nv - 1], p;
+        long long t, k;
+
+        while (qhat >= DIGIT_BASE ||
+               qhat * vn[nv - 2] > ((rhat << DIGIT_BITS) | un[j + nv - 2])) {
+            qhat--;
+            rhat += vn[nv - 1];
+            if (rhat >= DIGIT_BASE)
+                break;
+        }
+        /* multiply and subtract */
+        k = 0;
+        for (i = 0; i < nv; i++) {
+            p = qhat * vn[i];
+            t = (long long)un[i + j] - k - (long long)(p & 0xFFFFFFFFULL);
+            un[i + j] = (digit)t;
+            k = (long long)(p >> DIGIT_BITS) - (t >> DIGIT_BITS);
+        }
+        t = (long long)un[j + nv] - k;
+        un[j + nv] = (digit)t;
+        q[j] = (digit)qhat;
+        if (t < 0) {
+            /* qhat was one too large: add back */
+            ddigit c = 0;
+            q[j]--;
+            for (i = 0; i < nv; i++) {
+                c += (ddigit)un[i + j] + vn[i];
+                un[i + j] = (digit)c;
+                c >>= DIGIT_BITS;
+            }
+            un[j + nv] += (digit)c;
+        }
+    }
+    for (i = 0; i < nv - 1; i++)
+        r[i] = (un[i] >> s) |
+            (digit)(((ddigit)un[i + 1] << (DIGIT_BITS - s)) & 0xFFFFFFFFULL);
+    r[nv - 1] = un[nv - 1] >> s;
+    free(un);
+    free(vn);
+}
+
+/* Exact integers as magnitudes */
+
+struct nat {
+    const digit *d;
+    long n;
+    bool neg;
+    digit buf[2];
+};
+
+static void nat_of(SCM x, struct nat *v) {
+    if (IS_FIXNUM(x)) {
+        long long n = FIXNUM(x);
+        v->neg = n < 0;
+        if (n < 0)
+            n = -n;
+        v->buf[0] = (digit)n;
+        v->buf[1] = 0;
+        v->d = v->buf;
+        v->n = n == 0 ? 0 : 1;
+    }
+    else {
+        v->neg = BIG_SIZE(x) < 0;
+        v->n = v->neg ? -BIG_SIZE(x) : BIG_SIZE(x);
+        v->d = BIG_DIGITS(x);
+    }
+}
+
+/* The integer -1^NEG * D[0..N), taking over D */
+static SCM mk_exact(digit *d, long n, bool neg) {
+    n = nat_trim(d, n);
+    if (n <= 1 && (ddigit)(n == 0 ? 0 : d[0]) <= (ddigit)FIXNUM_MAX + neg) {
+        long long v = n == 0 ? 0 : (long long)d[0];
+        free(d);
+        return MK_FIXNUM((int)(neg ? -v : v));
+    }
+    return mk_bignum(neg ? -n : n, d);
+}
+
+SCM mk_integer(long long n) {
+    ddigit m = n < 0 ? -(ddigit)n : (ddigit)n;
+    digit *d;
+
+    if (n >= FIXNUM_MIN && n <= FIXNUM_MAX)
+        return MK_FIXNUM((int)n);
+    d = alloc_digits(2);
+    d[0] = (digit)m;
+    d[1] = (digit)(m >> DIGIT_BITS);
+    return mk_exact(d, 2, n < 0);
+}
+
+/* Whether X is an exact integer that fits in a long long, which is
+   then stored in *N */
+int integer_value(SCM x, long long *n) {
+    struct nat v;
+    ddigit m;
+
+    if (IS_FIXNUM(x)) {
+        *n = FIXNUM(x);
+        return true;
+    }
+    if (!IS_BIGNUM(x))
+        return false;
+    nat_of(x, &v);
+    if (v.n > 2)
+        return false;
+    m = v.d[0] | (v.n == 2 ? (ddigit)v.d[1] << DIGIT_BITS : 0);
+    if (m > (ddigit)1 << 63 || (m == (ddigit)1 << 63 && !v.neg))
+        return false;
+    *n = v.neg ? (long long)(0 - m) : (long long)m;
+    return true;
+}
+
+static SCM add_signed(SCM x, SCM y, bool negate_y) {
+    struct nat a, b;
+    digit *d;
+    long n;
+
+    nat_of(x, &a);
+    nat_of(y, &b);
+    if (negate_y)
+        b.neg = !b.neg;
+    if (a.n < b.n || (a.n == b.n && nat_cmp(a.d, a.n, b.d, b.n) < 0)) {
+        struct nat t = a;
+        a = b;
+        b = t;
+        if (a.d == b.buf)
+            a.d = a.buf;
+        if (b.d == a.buf)
+            b.d = b.buf;
+    }
+    n = a.n + 1;
+    d = alloc_digits(n);
+    memcpy(d, a.d, (size_t)a.n * sizeof(digit));
+    if (a.neg == b.neg)
+        nat_add_to(d, n, b.d, b.n);
+    else
+        nat_sub_from(d, n, b.d, b.n);
+    return mk_exact(d, n, a.neg);
+}
+
+SCM big_add(SCM x, SCM y) {
+    return add_signed(x, y, false);
+}
+
+SCM big_sub(SCM x, SCM y) {
+    return add_signed(x, y, true);
+}
+
+SCM big_mul(SCM x, SCM y) {
+    struct nat a, b;
+    digit *d;
+
+    nat_of(x, &a);
+    nat_of(y, &b);
+    if (a.n == 0 || b.n == 0)
+        return MK_FIXNUM(0);
+    d = alloc_digits(a.n + b.n);
+    nat_mul(d, a.d, a.n, b.d, b.n);
+    return mk_exact(d, a.n + b.n, a.neg != b.neg);
+}
+
+/* The quotient of X by Y truncated toward zero, and in *REM the
+   remainder, which has the sign of X */
+SCM big_divide(SCM x, SCM y, SCM *rem) {
+    struct nat a, b;
+    digit *q, *r;
+
+    nat_of(x, &a);
+    nat_of(y, &b);
+    if (b.n == 0)
+        error1("ERROR: %s: Division by zero.\n", "/");
+    if (nat_cmp(a.d, a.n, b.d, b.n) < 0) {
+        *rem = x;
+        return MK_FIXNUM(0);
+    }
+    q = alloc_digits(a.n);
+    memcpy(q, a.d, (size_t)a.n * sizeof(digit));
+    if (b.n == 1) {
+        r = alloc_digits(1);
+        r[0] = nat_div_digit(q, a.n, b.d[0]);
+        *rem = mk_exact(r, 1, a.neg);
+        return mk_exact(q, a.n, a.neg != b.neg);
+    }
+    r = alloc_digits(b.n);
+    nat_divmod(q, r, a.d, a.n, b.d, b.n);
+    *rem = mk_exact(r, b.n, a.neg);
+    return mk_exact(q, a.n - b.n + 1, a.neg != b.neg);
+}
+
+/* -1, 0 or 1 as X is less than, equal to or greater than Y */
+int big_compare(SCM x, SCM y) {
+    struct nat a, b;
+    int c;
+
+    nat_of(x, &a);
+    nat_of(y, &b);
+    if (a.n == 0 && b.n == 0)
+        return 0;
+    if (a.neg != b.neg)
+        return a.neg ? -1 : 1;
+    c = nat_cmp(a.d, a.n, b.d, b.n);
+    return a.neg ? -c : c;
+}
+
+double big_to_double(SCM x) {
+    struct nat a;
+    double d = 0.0;
+    long i;
+
+    nat_of(x, &a);
+    for (i = a.n - 1; i >= 0; i--)
+        d = d * (double)DIGIT_BASE + a.d[i];
+    return a.neg ? -d : d;
+}
+
+/* The exact integer equal to D, which must be integral and finite */
+SCM big_from_double(double d) {
+    double m = fabs(d);
+    long n = 0, i;
+    digit *r;
+
+    while (ldexp(1.0, (int)(n * DIGIT_BITS)) <= m)
+        n++;
+    r = alloc_digits(n);
+    for (i = 0; i < n; i++) {
+        double q = floor(m / (double)DIGIT_BASE);
+        r[i] = (digit)(m - q * (double)DIGIT_BASE);
+        m = q;
+    }
+    return mk_exact(r, n, d < 0);
+}
+
+/* X to the power of the non-negative fixnum K, by squaring */
+SCM big_expt(SCM x, long k) {
+    SCM r = MK_FIXNUM(1);
+    while (k > 0) {
+        if (k & 1)
+            r = big_mul(r, x);
+        k >>= 1;
+        if (k > 0)
+            x = big_mul(x, x);
+    }
+    return r;
+}
+
+/* Decimal conversion */
+
+static SCM parse_digits(char *s, long len) {
+    digit *d;
+    long n, i, k;
+
+    if (len > PARSE_SPLIT_DIGITS) {
+        long low = len / 2;
+        SCM high = parse_digits(s, len - low);
+        return big_add(big_mul(high, big_expt(MK_FIXNUM(10), low)),
+                       parse_digits(s + len - low, low));
+    }
+    n = len / DEC_CHUNK_DIGITS + 2;
+    d = alloc_digits(n);
+    for (i = 0; i < len; i += k) {
+        digit chunk = 0, scale = 1, carry;
+        long j;
+        k = (len - i) % DEC_CHUNK_DIGITS;
+        if (k == 0)
+            k = DEC_CHUNK_DIGITS;
+        for (j = 0; j < k; j++) {
+            chunk = chunk * 10 + (digit)(s[i + j] - '0');
+            scale *= 10;
+        }
+        /* d = d * scale + chunk */
+        carry = chunk;
+        for (j = 0; j < n; j++) {
+            ddigit t = (ddigit)d[j] * scale + carry;
+            d[j] = (digit)t;
+            carry = (digit)(t >> DIGIT_BITS);
+        }
+    }
+    return mk_exact(d, n, false);
+}
+
+/* The exact integer written in S: an optional sign and digits */
+SCM parse_integer(char *s) {
+    bool neg = s[0] == '-';
+    SCM x;
+
+    if (s[0] == '-' || s[0] == '+')
+        s++;
+    x = parse_digits(s, (long)strlen(s));
+    return neg ? big_sub(MK_FIXNUM(0), x) : x;
+}
+
+/* The decimal numeral of the exact integer X, in a malloc'ed
+   string */
+char *integer_to_string(SCM x) {
+    struct nat a;
+    digit *d, *chunks;
+    long n, nchunks = 0;
+    char *s, *p;
+
+    nat_of(x, &a);
+    n = a.n;
+    d = alloc_digits(n);
+    memcpy(d, a.d, (size_t)n * sizeof(digit));
+    chunks = alloc_digits(n * 2 + 1);
+    do {
+        chunks[nchunks++] = nat_div_digit(d, n, DEC_CHUNK);
+        n = nat_trim(d, n);
+    } while (n > 0);
+    if ((s = (char *)malloc((size_t)nchunks * DEC_CHUNK_DIGITS + 2)) == NULL)
+        fatal_error("malloc: integer_to_string");
+    p = s;
+    if (a.neg)
+        *p++ = '-';
+    p += sprintf(p, "%u", chunks[--nchunks]);
+    while (nchunks > 0)
+        p += sprintf(p, "%09u", chunks[--nchunks]);
+    free(d);
+    free(chunks);
+    return s;
+}
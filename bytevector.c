@@ -0,0 +1,646 @@
+/*
+ * Tscheme: A Tiny Scheme Interpreter
+ * Copyright (c) 1995-2013 Takuo WATANABE (Tokyo Institute of Technology)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <setjmp.h>
+
+#include "tscheme.h"
+
+/* Bytevectors and s32vectors
+
+   Homogeneous vectors of unboxed integers: a bytevector holds
+   unsigned bytes and an s32vector 32-bit signed integers.  As with a
+   string, the elements live in a malloc'ed array that the sweep
+   frees; gc does not look into it.  Arithmetic on the elements wraps
+   around, while a sum or dot product is exact and may be a
+   bignum.
+
+   Both kinds share the code below, which is told the type to expect
+   and the name to report in errors by a wrapper for each subr. */
+
+#define ELT_SIZE(type) ((type) == T_BYTEVECTOR ? 1 : (long)sizeof(int))
+
+static void check_numvec(char *fname, int type, SCM x, int argno) {
+    if (!IS_TYPE(x, type))
+        wta_error(fname, argno);
+}
+
+/* Checks that X may be stored in a vector of TYPE */
+static long element_value(char *fname, int type, SCM x, int argno) {
+    long long n;
+    if (!integer_value(x, &n) ||
+        (type == T_BYTEVECTOR ? n < 0 || n > 255 :
+         n < -2147483647LL - 1 || n > 2147483647LL))
+        wta_error(fname, argno);
+    return (long)n;
+}
+
+static SCM element_ref(SCM v, long i) {
+    if (IS_BYTEVECTOR(v))
+        return MK_FIXNUM(U8_DATA(v)[i]);
+    return mk_integer(S32_DATA(v)[i]);
+}
+
+static void element_set(SCM v, long i, long x) {
+    if (IS_BYTEVECTOR(v))
+        U8_DATA(v)[i] = (unsigned char)x;
+    else
+        S32_DATA(v)[i] = (int)x;
+}
+
+/* As vector_index and vector_range in vector.c */
+static long numvec_index(char *fname, SCM v, SCM k, int argno, bool endp) {
+    if (!IS_FIXNUM(k))
+        wta_error(fname, argno);
+    if (FIXNUM(k) < 0 || FIXNUM(k) > NUMVEC_DIM(v) ||
+        (FIXNUM(k) == NUMVEC_DIM(v) && !endp))
+        error1("ERROR: %s: Index out of range.\n", fname);
+    return FIXNUM(k);
+}
+
+static void numvec_range(char *fname, SCM v, SCM args, int argno,
+                         long *start, long *end) {
+    *start = 0;
+    *end = NUMVEC_DIM(v);
+    if (IS_PAIR(args)) {
+        *start = numvec_index(fname, v, CAR(args), argno, true);
+        args = CDR(args);
+    }
+    if (IS_PAIR(args))
+        *end = numvec_index(fname, v, CAR(args), argno + 1, true);
+    if (*end < *start)
+        error1("ERROR: %s: Index out of range.\n", fname);
+}
+
+/* Bulk kernels
+
+   Plain counted loops with no calls or early exits, so that the C
+   compiler can vectorize them (the Makefile builds this file with
+   -O3).  On x86, GCC also compiles each kernel for AVX2 and picks
+   that clone at load time on CPUs that have it; the default clone
+   uses the baseline instruction set of the target.  Wrapping
+   arithmetic is done on unsigned values, where it is defined
+   behaviour. */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KERNEL __attribute__((target_clones("avx2", "default")))
+#else
+#define KERNEL
+#endif
+
+KERNEL
+static void u8_add(unsigned char *d, unsigned char *a, unsigned char *b,
+                   long n) {
+    long i;
+    for (i = 0; i < n; i++)
+        d[i] = (unsigned char)(a[i] + b[i]);
+}
+
+KERNEL
+static void u8_mul(unsigned char *d, unsigned char *a, unsigned char *b,
+                   long n) {
+    long i;
+    for (i = 0; i < n; i++)
+        d[i] = (unsigned char)(a[i] * b[i]);
+}
+
+KERNEL
+static long long u8_dot(unsigned char *a, unsigned char *b, long n) {
+    long long s = 0;
+    long i;
+    for (i = 0; i < n; i++)
+        s += a[i] * b[i];
+    return s;
+}
+
+KERNEL
+static long long u8_sum(unsigned char *a, long n) {
+    long long s = 0;
+    long i;
+    for (i = 0; i < n; i++)
+        s += a[i];
+    return s;
+}
+
+KERNEL
+static int u8_min(unsigned char *a, long n) {
+    unsigned char m = a[0];
+    long i;
+    for (i = 1; i < n; i++)
+        m = a[i] < m ? a[i] : m;
+    return m;
+}
+
+KERNEL
+static int u8_max(unsigned char *a, long n) {
+    unsigned char m = a[0];
+    long i;
+    for (i = 1; i < n; i++)
+        m = a[i] > m ? a[i] : m;
+    return m;
+}
+
+KERNEL
+static void s32_add(int *d, int *a, int *b, long n) {
+    long i;
+    for (i = 0; i < n; i++)
+        d[i] = (int)((unsigned)a[i] + (unsigned)b[i]);
+}
+
+KERNEL
+static void s32_mul(int *d, int *a, int *b, long n) {
+    long i;
+    for (i = 0; i < n; i++)
+        d[i] = (int)((unsigned)a[i] * (unsigned)b[i]);
+}
+
+KERNEL
+static void s32_fill(int *d, int x, long n) {
+    long i;
+    for (i = 0; i < n; i++)
+        d[i] = x;
+}
+
+KERNEL
+static long long s32_dot(int *a, int *b, long n) {
+    long long s = 0;
+    long i;
+    for (i = 0; i < n; i++)
+        s += (long long)a[i] * b[i];
+    return s;
+}
+
+KERNEL
+static long long s32_sum(int *a, long n) {
+    long long s = 0;
+    long i;
+    for (i = 0; i < n; i++)
+        s += a[i];
+    return s;
+}
+
+KERNEL
+static int s32_min(int *a, long n) {
+    int m = a[0];
+    long i;
+    for (i = 1; i < n; i++)
+        m = a[i] < m ? a[i] : m;
+    return m;
+}
+
+KERNEL
+static int s32_max(int *a, long n) {
+    int m = a[0];
+    long i;
+    for (i = 1; i < n; i++)
+        m = a[i] > m ? a[i] : m;
+    return m;
+}
+
+/* Common code of the subrs */
+
+static SCM make_numvec(char *fname, int type, SCM args) {
+    SCM v;
+    long x = 0;
+    int n = check_nargs(fname, args, 1, 2);
+
+    if (!IS_FIXNUM(CAR(args)) || FIXNUM(CAR(args)) < 0)
+        wta_error(fname, 1);
+    if (n == 2)
+        x = element_value(fname, type, SECOND(args), 2);
+    v = mk_numvec(type, FIXNUM(CAR(args)));
+    if (type == T_BYTEVECTOR)
+        memset(U8_DATA(v), (int)x, (size_t)NUMVEC_DIM(v));
+    else
+        s32_fill(S32_DATA(v), (int)x, NUMVEC_DIM(v));
+    return v;
+}
+
+static SCM list_to_numvec(char *fname, int type, SCM list) {
+    SCM l, v;
+    long n = 0;
+
+    for (l = list; IS_PAIR(l); l = CDR(l))
+        element_value(fname, type, CAR(l), ++n);
+    if (!IS_NULL(l))
+        wta_error(fname, 1);
+    v = mk_numvec(type, n);
+    for (n = 0, l = list; IS_PAIR(l); l = CDR(l), n++)
+        element_set(v, n, element_value(fname, type, CAR(l), n + 1));
+    return v;
+}
+
+static SCM numvec_to_list(char *fname, int type, SCM args) {
+    SCM v, l = NIL;
+    long start, i;
+
+    check_nargs(fname, args, 1, 3);
+    check_numvec(fname, type, v = CAR(args), 1);
+    numvec_range(fname, v, CDR(args), 2, &start, &i);
+    while (i > start) {
+        SCM x = element_ref(v, --i);
+        l = CONS(x, l);
+    }
+    return l;
+}
+
+static SCM numvec_ref(char *fname, int type, SCM v, SCM k) {
+    check_numvec(fname, type, v, 1);
+    return element_ref(v, numvec_index(fname, v, k, 2, false));
+}
+
+static SCM numvec_set(char *fname, int type, SCM v, SCM k, SCM x) {
+    long i;
+    check_numvec(fname, type, v, 1);
+    i = numvec_index(fname, v, k, 2, false);
+    element_set(v, i, element_value(fname, type, x, 3));
+    return unspecified_value;
+}
+
+static SCM numvec_length(char *fname, int type, SCM v) {
+    check_numvec(fname, type, v, 1);
+    return MK_FIXNUM(NUMVEC_DIM(v));
+}
+
+static SCM numvec_fill(char *fname, int type, SCM args) {
+    SCM v;
+    long x, start, end;
+
+    check_nargs(fname, args, 2, 4);
+    check_numvec(fname, type, v = CAR(args), 1);
+    x = element_value(fname, type, SECOND(args), 2);
+    numvec_range(fname, v, CDDR(args), 3, &start, &end);
+    if (type == T_BYTEVECTOR)
+        memset(U8_DATA(v) + start, (int)x, (size_t)(end - start));
+    else
+        s32_fill(S32_DATA(v) + start, (int)x, end - start);
+    return unspecified_value;
+}
+
+static SCM numvec_copy(char *fname, int type, SCM args) {
+    SCM v, copy;
+    long start, end, size = ELT_SIZE(type);
+
+    check_nargs(fname, args, 1, 3);
+    check_numvec(fname, type, v = CAR(args), 1);
+    numvec_range(fname, v, CDR(args), 2, &start, &end);
+    copy = mk_numvec(type, end - start);
+    memcpy(NUMVEC_DATA(copy), (char *)NUMVEC_DATA(v) + start * size,
+           (size_t)((end - start) * size));
+    return copy;
+}
+
+static SCM numvec_copy_to(char *fname, int type, SCM args) {
+    SCM to, from;
+    long at, start, end, size = ELT_SIZE(type);
+
+    check_nargs(fname, args, 3, 5);
+    check_numvec(fname, type, to = FIRST(args), 1);
+    at = numvec_index(fname, to, SECOND(args), 2, true);
+    check_numvec(fname, type, from = THIRD(args), 3);
+    numvec_range(fname, from, CDR(CDDR(args)), 4, &start, &end);
+    if (end - start > NUMVEC_DIM(to) - at)
+        error1("ERROR: %s: Index out of range.\n", fname);
+    memmove((char *)NUMVEC_DATA(to) + at * size,
+            (char *)NUMVEC_DATA(from) + start * size,
+            (size_t)((end - start) * size));
+    return unspecified_value;
+}
+
+static SCM numvec_append(char *fname, int type, SCM args) {
+    SCM l, v;
+    long n = 0, size = ELT_SIZE(type);
+    int argno = 0;
+
+    for (l = args; IS_PAIR(l); l = CDR(l)) {
+        check_numvec(fname, type, CAR(l), ++argno);
+        n += NUMVEC_DIM(CAR(l));
+    }
+    v = mk_numvec(type, n);
+    for (n = 0, l = args; IS_PAIR(l); l = CDR(l)) {
+        memcpy((char *)NUMVEC_DATA(v) + n * size, NUMVEC_DATA(CAR(l)),
+               (size_t)(NUMVEC_DIM(CAR(l)) * size));
+        n += NUMVEC_DIM(CAR(l));
+    }
+    return v;
+}
+
+/* D := A + B or A * B, elementwise; all three of the same length */
+static SCM numvec_arith(char *fname, int type, SCM d, SCM a, SCM b,
+                        bool mulp) {
+    check_numvec(fname, type, d, 1);
+    check_numvec(fname, type, a, 2);
+    check_numvec(fname, type, b, 3);
+    if (NUMVEC_DIM(a) != NUMVEC_DIM(d) || NUMVEC_DIM(b) != NUMVEC_DIM(d))
+        error1("ERROR: %s: Lengths differ.\n", fname);
+    if (type == T_BYTEVECTOR)
+        (mulp ? u8_mul : u8_add)(U8_DATA(d), U8_DATA(a), U8_DATA(b),
+                                 NUMVEC_DIM(d));
+    else
+        (mulp ? s32_mul : s32_add)(S32_DATA(d), S32_DATA(a), S32_DATA(b),
+                                   NUMVEC_DIM(d));
+    return unspecified_value;
+}
+
+static SCM numvec_dot(char *fname, int type, SCM a, SCM b) {
+    check_numvec(fname, type, a, 1);
+    check_numvec(fname, type, b, 2);
+    if (NUMVEC_DIM(a) != NUMVEC_DIM(b))
+        error1("ERROR: %s: Lengths differ.\n", fname);
+    if (type == T_BYTEVECTOR)
+        return mk_integer(u8_dot(U8_DATA(a), U8_DATA(b), NUMVEC_DIM(a)));
+    return mk_integer(s32_dot(S32_DATA(a), S32_DATA(b), NUMVEC_DIM(a)));
+}
+
+static SCM numvec_sum(char *fname, int type, SCM a) {
+    check_numvec(fname, type, a, 1);
+    if (type == T_BYTEVECTOR)
+        return mk_integer(u8_sum(U8_DATA(a), NUMVEC_DIM(a)));
+    return mk_integer(s32_sum(S32_DATA(a), NUMVEC_DIM(a)));
+}
+
+static SCM numvec_extremum(char *fname, int type, SCM a, bool maxp) {
+    check_numvec(fname, type, a, 1);
+    if (NUMVEC_DIM(a) == 0)
+        error1("ERROR: %s: Empty vector.\n", fname);
+    if (type == T_BYTEVECTOR)
+        return MK_FIXNUM((maxp ? u8_max : u8_min)(U8_DATA(a),
+                                                  NUMVEC_DIM(a)));
+    return mk_integer((maxp ? s32_max : s32_min)(S32_DATA(a),
+                                                 NUMVEC_DIM(a)));
+}
+
+/* Bytevectors */
+
+/* BYTEVECTOR? x */
+SCM s_bytevectorp(SCM x) {
+    return IS_BYTEVECTOR(x) ? boolean_true : boolean_false;
+}
+
+/* MAKE-BYTEVECTOR k [byte] */
+SCM s_make_bytevector(SCM args) {
+    return make_numvec("make-bytevector", T_BYTEVECTOR, args);
+}
+
+/* BYTEVECTOR byte... */
+SCM s_bytevector(SCM args) {
+    return list_to_numvec("bytevector", T_BYTEVECTOR, args);
+}
+
+/* BYTEVECTOR-LENGTH bytevector */
+SCM s_bytevector_length(SCM v) {
+    return numvec_length("bytevector-length", T_BYTEVECTOR, v);
+}
+
+/* BYTEVECTOR-U8-REF bytevector k */
+SCM s_bytevector_u8_ref(SCM v, SCM k) {
+    return numvec_ref("bytevector-u8-ref", T_BYTEVECTOR, v, k);
+}
+
+/* BYTEVECTOR-U8-SET! bytevector k byte */
+SCM s_bytevector_u8_set(SCM v, SCM k, SCM x) {
+    return numvec_set("bytevector-u8-set!", T_BYTEVECTOR, v, k, x);
+}
+
+/* BYTEVECTOR-FILL! bytevector byte [start [end]] */
+SCM s_bytevector_fill(SCM args) {
+    return numvec_fill("bytevector-fill!", T_BYTEVECTOR, args);
+}
+
+/* BYTEVECTOR-COPY bytevector [start [end]] */
+SCM s_bytevector_copy(SCM args) {
+    return numvec_copy("bytevector-copy", T_BYTEVECTOR, args);
+}
+
+/* BYTEVECTOR-COPY! to at from [start [end]] */
+SCM s_bytevector_copy_to(SCM args) {
+    return numvec_copy_to("bytevector-copy!", T_BYTEVECTOR, args);
+}
+
+/* BYTEVECTOR-APPEND bytevector... */
+SCM s_bytevector_append(SCM args) {
+    return numvec_append("bytevector-append", T_BYTEVECTOR, args);
+}
+
+/* BYTEVECTOR->LIST bytevector [start [end]] */
+SCM s_bytevector_to_list(SCM args) {
+    return numvec_to_list("bytevector->list", T_BYTEVECTOR, args);
+}
+
+/* LIST->BYTEVECTOR list */
+SCM s_list_to_bytevector(SCM list) {
+    return list_to_numvec("list->bytevector", T_BYTEVECTOR, list);
+}
+
+/* BYTEVECTOR-ADD! d a b */
+SCM s_bytevector_add(SCM d, SCM a, SCM b) {
+    return numvec_arith("bytevector-add!", T_BYTEVECTOR, d, a, b, false);
+}
+
+/* BYTEVECTOR-MUL! d a b */
+SCM s_bytevector_mul(SCM d, SCM a, SCM b) {
+    return numvec_arith("bytevector-mul!", T_BYTEVECTOR, d, a, b, true);
+}
+
+/* BYTEVECTOR-DOT a b */
+SCM s_bytevector_dot(SCM a, SCM b) {
+    return numvec_dot("bytevector-dot", T_BYTEVECTOR, a, b);
+}
+
+/* BYTEVECTOR-SUM bytevector */
+SCM s_bytevector_sum(SCM a) {
+    return numvec_sum("bytevector-sum", T_BYTEVECTOR, a);
+}
+
+/* BYTEVECTOR-MIN bytevector */
+SCM s_bytevector_min(SCM a) {
+    return numvec_extremum("bytevector-min", T_BYTEVECTOR, a, false);
+}
+
+/* BYTEVECTOR-MAX bytevector */
+SCM s_bytevector_max(SCM a) {
+    return numvec_extremum("bytevector-max", T_BYTEVECTOR, a, true);
+}
+
+/* S32vectors */
+
+/* S32VECTOR? x */
+SCM s_s32vectorp(SCM x) {
+    return IS_S32VECTOR(x) ? boolean_true : boolean_false;
+}
+
+/* MAKE-S32VECTOR k [n] */
+SCM s_make_s32vector(SCM args) {
+    return make_numvec("make-s32vector", T_S32VECTOR, args);
+}
+
+/* S32VECTOR n... */
+SCM s_s32vector(SCM args) {
+    return list_to_numvec("s32vector", T_S32VECTOR, args);
+}
+
+/* S32VECTOR-LENGTH s32vector */
+SCM s_s32vector_length(SCM v) {
+    return numvec_length("s32vector-length", T_S32VECTOR, v);
+}
+
+/* S32VECTOR-REF s32vector k */
+SCM s_s32vector_ref(SCM v, SCM k) {
+    return numvec_ref("s32vector-ref", T_S32VECTOR, v, k);
+}
+
+/* S32VECTOR-SET! s32vector k n */
+SCM s_s32vector_set(SCM v, SCM k, SCM x) {
+    return numvec_set("s32vector-set!", T_S32VECTOR, v, k, x);
+}
+
+/* S32VECTOR-FILL! s32vector n [start [end]] */
+SCM s_s32vector_fill(SCM args) {
+    return numvec_fill("s32vector-fill!", T_S32VECTOR, args);
+}
+
+/* S32VECTOR-COPY s32vector [start [end]] */
+SCM s_s32vector_copy(SCM args) {
+    return numvec_copy("s32vector-copy", T_S32VECTOR, args);
+}
+
+/* S32VECTOR-COPY! to at from [start [end]] */
+SCM s_s32vector_copy_to(SCM args) {
+    return numvec_copy_to("s32vector-copy!", T_S32VECTOR, args);
+}
+
+/* S32VECTOR-APPEND s32vector... */
+SCM s_s32vector_append(SCM args) {
+    return numvec_append("s32vector-append", T_S32VECTOR, args);
+}
+
+/* S32VECTOR->LIST s32vector [start [end]] */
+SCM s_s32vector_to_list(SCM args) {
+    return numvec_to_list("s32vector->list", T_S32VECTOR, args);
+}
+
+/* LIST->S32VECTOR list */
+SCM s_list_to_s32vector(SCM list) {
+    return list_to_numvec("list->s32vector", T_S32VECTOR, list);
+}
+
+/* S32VECTOR-ADD! d a b */
+SCM s_s32vector_add(SCM d, SCM a, SCM b) {
+    return numvec_arith("s32vector-add!", T_S32VECTOR, d, a, b, false);
+}
+
+/* S32VECTOR-MUL! d a b */
+SCM s_s32vector_mul(SCM d, SCM a, SCM b) {
+    return numvec_arith("s32vector-mul!", T_S32VECTOR, d, a, b, true);
+}
+
+/* S32VECTOR-DOT a b */
+SCM s_s32vector_dot(SCM a, SCM b) {
+    return numvec_dot("s32vector-dot", T_S32VECTOR, a, b);
+}
+
+/* S32VECTOR-SUM s32vector */
+SCM s_s32vector_sum(SCM a) {
+    return numvec_sum("s32vector-sum", T_S32VECTOR, a);
+}
+
+/* S32VECTOR-MIN s32vector */
+SCM s_s32vector_min(SCM a) {
+    return numvec_extremum("s32vector-min", T_S32VECTOR, a, false);
+}
+
+/* S32VECTOR-MAX s32vector */
+SCM s_s32vector_max(SCM a) {
+    return numvec_extremum("s32vector-max", T_S32VECTOR, a, true);
+}
+
+void init_bytevector_subrs(void) {
+    /* Bytevector */
+    mk_subr("BYTEVECTOR?", (SCM (*)(void))s_bytevectorp, 1);
+    SET_FLAG(mk_subr("MAKE-BYTEVECTOR",
+                     (SCM (*)(void))s_make_bytevector, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("BYTEVECTOR", (SCM (*)(void))s_bytevector, -1),
+             FLAG_STACK_ARGS);
+    mk_subr("BYTEVECTOR-LENGTH", (SCM (*)(void))s_bytevector_length, 1);
+    mk_subr("BYTEVECTOR-U8-REF", (SCM (*)(void))s_bytevector_u8_ref, 2);
+    mk_subr("BYTEVECTOR-U8-SET!", (SCM (*)(void))s_bytevector_u8_set, 3);
+    SET_FLAG(mk_subr("BYTEVECTOR-FILL!",
+                     (SCM (*)(void))s_bytevector_fill, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("BYTEVECTOR-COPY",
+                     (SCM (*)(void))s_bytevector_copy, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("BYTEVECTOR-COPY!",
+                     (SCM (*)(void))s_bytevector_copy_to, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("BYTEVECTOR-APPEND",
+                     (SCM (*)(void))s_bytevector_append, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("BYTEVECTOR->LIST",
+                     (SCM (*)(void))s_bytevector_to_list, -1),
+             FLAG_STACK_ARGS);
+    mk_subr("LIST->BYTEVECTOR", (SCM (*)(void))s_list_to_bytevector, 1);
+    mk_subr("BYTEVECTOR-ADD!", (SCM (*)(void))s_bytevector_add, 3);
+    mk_subr("BYTEVECTOR-MUL!", (SCM (*)(void))s_bytevector_mul, 3);
+    mk_subr("BYTEVECTOR-DOT", (SCM (*)(void))s_bytevector_dot, 2);
+    mk_subr("BYTEVECTOR-SUM", (SCM (*)(void))s_bytevector_sum, 1);
+    mk_subr("BYTEVECTOR-MIN", (SCM (*)(void))s_bytevector_min, 1);
+    mk_subr("BYTEVECTOR-MAX", (SCM (*)(void))s_bytevector_max, 1);
+
+    /* S32vector */
+    mk_subr("S32VECTOR?", (SCM (*)(void))s_s32vectorp, 1);
+    SET_FLAG(mk_subr("MAKE-S32VECTOR",
+                     (SCM (*)(void))s_make_s32vector, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("S32VECTOR", (SCM (*)(void))s_s32vector, -1),
+             FLAG_STACK_ARGS);
+    mk_subr("S32VECTOR-LENGTH", (SCM (*)(void))s_s32vector_length, 1);
+    mk_subr("S32VECTOR-REF", (SCM (*)(void))s_s32vector_ref, 2);
+    mk_subr("S32VECTOR-SET!", (SCM (*)(void))s_s32vector_set, 3);
+    SET_FLAG(mk_subr("S32VECTOR-FILL!",
+                     (SCM (*)(void))s_s32vector_fill, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("S32VECTOR-COPY",
+                     (SCM (*)(void))s_s32vector_copy, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("S32VECTOR-COPY!",
+                     (SCM (*)(void))s_s32vector_copy_to, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("S32VECTOR-APPEND",
+                     (SCM (*)(void))s_s32vector_append, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("S32VECTOR->LIST",
+                     (SCM (*)(void))s_s32vector_to_list, -1),
+             FLAG_STACK_ARGS);
+    mk_subr("LIST->S32VECTOR", (SCM (*)(void))s_list_to_s32vector, 1);
+    mk_subr("S32VECTOR-ADD!", (SCM (*)(void))s_s32vector_add, 3);
+    mk_subr("S32VECTOR-MUL!", (SCM (*)(void))s_s32vector_mul, 3);
+    mk_subr("S32VECTOR-DOT", (SCM (*)(void))s_s32vector_dot, 2);
+    mk_subr("S32VECTOR-SUM", (SCM (*)(void))s_s32vector_sum, 1);
+    mk_subr("S32VECTOR-MIN", (SCM (*)(void))s_s32vector_min, 1);
+    mk_subr("S32VECTOR-MAX", (SCM (*)(void))s_s32vector_max, 1);
+}
@@ -23,30 +23,41 @@
  */
 
 #include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
 #include <setjmp.h>
 
 #include "tscheme.h"
 
 jmp_buf error_return;
 
+static SCM sym_sys_handlers, sym_error_object;
+
+static void signal_error(char *message);
+static void raise_uncaught(SCM obj);
+
 void wta_error(char *fname, int argno) {
-    fprintf(stderr, "ERROR: %s: Wrong type in arg %d\n", fname, argno);
-    longjmp(error_return, NON_FATAL);
+    char buf[STRBUF_SIZE];
+    snprintf(buf, sizeof(buf), "ERROR: %s: Wrong type in arg %d\n",
+             fname, argno);
+    signal_error(buf);
 }
 
 void wna_error(char *fname, int nargs) {
-    fprintf(stderr, "ERROR: %s: Wrong number (%d) of args.\n", fname, nargs);
-    longjmp(error_return, NON_FATAL);
+    char buf[STRBUF_SIZE];
+    snprintf(buf, sizeof(buf), "ERROR: %s: Wrong number (%d) of args.\n",
+             fname, nargs);
+    signal_error(buf);
 }
 
 void error0(char *message) {
-    fprintf(stderr, "%s", message);
-    longjmp(error_return, NON_FATAL);
+    signal_error(message);
 }
 
 void error1(char *message, char *arg) {
-    fprintf(stderr, message, arg);
-    longjmp(error_return, NON_FATAL);
+    char buf[STRBUF_SIZE];
+    snprintf(buf, sizeof(buf), message, arg);
+    signal_error(buf);
 }
 
 void fatal_error(char *message) {
@@ -54,6 +65,220 @@ void fatal_error(char *message) {
     longjmp(error_return, FATAL);
 }
 
+/* Handlers
+
+   SYS:*HANDLERS* holds the exception handlers of the current dynamic
+   extent, innermost first.  A handler is a procedure, or the tag of
+   a GUARD, which is found in the chain of catch frames.  A catch
+   frame lives in the C frame of the SYS:CATCH or SYS:GUARD that made
+   it; a throw longjmps straight to it and restores the handlers, the
+   evaluator stack and the step deadline it saved.  Nothing is paid
+   for a call that installs no handler.  An error signalled by the
+   interpreter goes to the innermost handler as an error object, or,
+   if there is none, is printed and ends the evaluation as before. */
+
+struct catch_frame {
+    jmp_buf jb;
+    SCM tag, value, handlers;
+    long stack_ptr, frame, deadline;
+    struct catch_frame *prev;
+};
+
+static struct catch_frame *catch_chain;
+
+/* Calls THUNK with HANDLERS installed.  Returns true if a throw to
+   TAG ended it, with the thrown object in *VALUE. */
+static bool catch_call(SCM tag, SCM thunk, SCM handlers, SCM *value) {
+    struct catch_frame f;
+
+    f.tag = tag;
+    f.handlers = SYM_VALUE(sym_sys_handlers);
+    f.stack_ptr = eval_stack_ptr;
+    f.frame = eval_frame;
+    f.deadline = eval_deadline;
+    f.prev = catch_chain;
+    if (setjmp(f.jb) == 0) {
+        catch_chain = &f;
+        SYM_VALUE(sym_sys_handlers) = handlers;
+        *value = apply_procedure(thunk, NIL);
+        SYM_VALUE(sym_sys_handlers) = f.handlers;
+        catch_chain = f.prev;
+        return false;
+    }
+    catch_chain = f.prev;
+    SYM_VALUE(sym_sys_handlers) = f.handlers;
+    eval_stack_ptr = f.stack_ptr;
+    eval_frame = f.frame;
+    set_eval_deadline(f.deadline);
+    *value = f.value;
+    return true;
+}
+
+static void throw(SCM tag, SCM value) {
+    struct catch_frame *f;
+    for (f = catch_chain; f != NULL; f = f->prev)
+        if (EQ(f->tag, tag)) {
+            f->value = value;
+            longjmp(f->jb, 1);
+        }
+    error0("ERROR: call/ec: the continuation is no longer active.\n");
+}
+
+/* Called when the toplevel takes over after an error */
+void reset_handlers(void) {
+    catch_chain = NULL;
+    SYM_VALUE(sym_sys_handlers) = NIL;
+}
+
+/* SYS:CATCH tag thunk -- the value of THUNK, or the values list
+   thrown to TAG */
+SCM s_sys_catch(SCM tag, SCM thunk) {
+    SCM value;
+    if (catch_call(tag, thunk, SYM_VALUE(sym_sys_handlers), &value))
+        return s_values(value);
+    return value;
+}
+
+/* SYS:THROW tag values */
+SCM s_sys_throw(SCM tag, SCM values) {
+    throw(tag, values);
+    return unspecified_value;
+}
+
+/* SYS:GUARD thunk handler -- calls THUNK; an object raised in it is
+   passed to HANDLER after the stack has been unwound */
+SCM s_sys_guard(SCM thunk, SCM handler) {
+    SCM tag = CONS(sym_sys_handlers, NIL), value;
+    if (catch_call(tag, thunk, CONS(tag, SYM_VALUE(sym_sys_handlers)),
+                   &value))
+        return apply_procedure(handler, CONS(value, NIL));
+    return value;
+}
+
+/* WITH-EXCEPTION-HANDLER handler thunk */
+SCM s_with_exception_handler(SCM handler, SCM thunk) {
+    SCM saved = SYM_VALUE(sym_sys_handlers), value;
+    SYM_VALUE(sym_sys_handlers) = CONS(handler, saved);
+    value = apply_procedure(thunk, NIL);
+    SYM_VALUE(sym_sys_handlers) = saved;
+    return value;
+}
+
+/* Calls the innermost handler on OBJ, with the outer handlers
+   installed, and returns its value. */
+static SCM call_handler(SCM obj) {
+    SCM handlers = SYM_VALUE(sym_sys_handlers), h, value;
+
+    if (!IS_PAIR(handlers))
+        raise_uncaught(obj);
+    h = CAR(handlers);
+    if (IS_PAIR(h))
+        throw(h, obj);
+    SYM_VALUE(sym_sys_handlers) = CDR(handlers);
+    value = apply_procedure(h, CONS(obj, NIL));
+    SYM_VALUE(sym_sys_handlers) = handlers;
+    return value;
+}
+
+/* RAISE obj */
+SCM s_raise(SCM obj) {
+    SCM handlers = SYM_VALUE(sym_sys_handlers);
+    call_handler(obj);
+    SYM_VALUE(sym_sys_handlers) = CDR(handlers);
+    error0("ERROR: raise: the handler returned.\n");
+    return unspecified_value;
+}
+
+/* RAISE-CONTINUABLE obj */
+SCM s_raise_continuable(SCM obj) {
+    return call_handler(obj);
+}
+
+static SCM mk_error_object(SCM message, SCM irritants) {
+    return CONS(sym_error_object, CONS(message, irritants));
+}
+
+/* ERROR message irritant... */
+SCM s_error(SCM args) {
+    if (!IS_PAIR(args))
+        wna_error("error", 0);
+    return s_raise(mk_error_object(CAR(args), CDR(args)));
+}
+
+SCM s_error_objectp(SCM x) {
+    return (IS_PAIR(x) && EQ(CAR(x), sym_error_object) && IS_PAIR(CDR(x)))
+        ? boolean_true : boolean_false;
+}
+
+SCM s_error_object_message(SCM x) {
+    if (EQ(s_error_objectp(x), boolean_false))
+        wta_error("error-object-message", 1);
+    return CADR(x);
+}
+
+SCM s_error_object_irritants(SCM x) {
+    if (EQ(s_error_objectp(x), boolean_false))
+        wta_error("error-object-irritants", 1);
+    return CDDR(x);
+}
+
+static void raise_uncaught(SCM obj) {
+    SCM l;
+    if (NEQ(s_error_objectp(obj), boolean_false)) {
+        fprintf(stderr, "ERROR: ");
+        scm_write(CADR(obj), stderr_value, 1);
+        for (l = CDDR(obj); IS_PAIR(l); l = CDR(l)) {
+            fprintf(stderr, " ");
+            scm_write(CAR(l), stderr_value, 0);
+        }
+    }
+    else {
+        fprintf(stderr, "ERROR: uncaught exception: ");
+        scm_write(obj, stderr_value, 0);
+    }
+    fprintf(stderr, "\n");
+    longjmp(error_return, NON_FATAL);
+}
+
+/* The message of an error object made from MESSAGE, a line printed
+   as "ERROR: text\n", is just the text. */
+static void signal_error(char *message) {
+    char buf[STRBUF_SIZE];
+    size_t n;
+
+    if (!IS_PAIR(SYM_VALUE(sym_sys_handlers))) {
+        fprintf(stderr, "%s", message);
+        longjmp(error_return, NON_FATAL);
+    }
+    if (strncmp(message, "ERROR: ", 7) == 0)
+        message += 7;
+    n = strlen(message);
+    if (n > 0 && message[n - 1] == '\n')
+        n--;
+    snprintf(buf, sizeof(buf), "%.*s", (int)n, message);
+    s_raise(mk_error_object(mk_string(buf, (long)strlen(buf)), NIL));
+}
+
+void init_error_subrs(void) {
+    sym_sys_handlers = mk_symbol("SYS:*HANDLERS*");
+    SYM_VALUE(sym_sys_handlers) = NIL;
+    sym_error_object = mk_symbol("SYS:ERROR-OBJECT");
+
+    mk_subr("SYS:CATCH", (SCM (*)(void))s_sys_catch, 2);
+    mk_subr("SYS:THROW", (SCM (*)(void))s_sys_throw, 2);
+    mk_subr("SYS:GUARD", (SCM (*)(void))s_sys_guard, 2);
+    mk_subr("WITH-EXCEPTION-HANDLER",
+            (SCM (*)(void))s_with_exception_handler, 2);
+    mk_subr("RAISE", (SCM (*)(void))s_raise, 1);
+    mk_subr("RAISE-CONTINUABLE", (SCM (*)(void))s_raise_continuable, 1);
+    mk_subr("ERROR", (SCM (*)(void))s_error, -1);
+    mk_subr("ERROR-OBJECT?", (SCM (*)(void))s_error_objectp, 1);
+    mk_subr("ERROR-OBJECT-MESSAGE",
+            (SCM (*)(void))s_error_object_message, 1);
+    mk_subr("ERROR-OBJECT-IRRITANTS",
+            (SCM (*)(void))s_error_object_irritants, 1);
+}
+
 int check_nargs(char *fname, SCM args, int min, int max) {
     if (!(IS_PAIR(args) || IS_NULL(args)))
         error0("wrong arguments");
@@ -23,28 +23,410 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <setjmp.h>
+#include <signal.h>
 
 #include "tscheme.h"
 
 #define SUBR_SNAME(s) STR_DATA(SYM_PNAME(SUBR_NAME(s)))
 
+/* Variables and fixnums are evaluated without a recursive call */
+#define EVAL_ARG(x,r)                           \
+    (IS_FIXNUM(x) ? (x) :                       \
+     IS_SYMBOL(x) ? get_symval(r, x) : eval_recursive(x, r))
+
 static SCM evaluate_list(SCM exps, SCM env);
-static SCM extend_env(SCM alist, SCM vars, SCM vals);
+static SCM apply_subrn_on_stack(SCM fun, SCM exps, SCM env);
+static SCM bind_arguments(SCM alist, SCM vars, SCM exps, SCM env);
+static SCM bind_list(SCM alist, SCM vars, SCM vals);
+static SCM stack_list(struct object *cells, SCM *vals, int n);
+static SCM apply_closure_body(SCM fun, SCM env);
+static SCM bind_closure_args(SCM fun, SCM args);
+static SCM spread_apply(SCM args, SCM *spread);
 static SCM extend_let_env(SCM alist, SCM let_list);
 static SCM extend_let_star_env(SCM alist, SCM let_list);
 static SCM extend_letrec_env(SCM alist, SCM let_list);
 static SCM get_symcell(SCM alist, SCM sym);
+static SCM flat_env(SCM vars, SCM alist);
 static SCM get_symval(SCM alist, SCM sym);
 static SCM set_symval(SCM alist, SCM sym, SCM val, int definep);
+static SCM bind(SCM alist, SCM sym, SCM val);
+static void check_arity(SCM fun, SCM args);
+static bool is_procedure(SCM x);
+static SCM apply_inline(SCM fun, SCM args, SCM env);
+static SCM eval_recursive(SCM exp, SCM env);
+static SCM eval_stack_run(SCM exp, SCM env);
+static SCM bind_values(SCM alist, SCM vars, SCM *vals, int n);
+static bool loop_is_safe(SCM form);
+static SCM mk_loop(SCM form, SCM env);
+static void update_loop_vars(SCM env, SCM *vals, int n);
+static SCM rebind_do_vars(SCM form, SCM env, SCM outer, SCM *vals, int n);
+
+/* Call-site caches
+
+   An operator symbol that has never been bound in a local
+   environment always denotes its global value.  For such call sites
+   the callee, already checked against the number of arguments at
+   that site, is kept in a direct-mapped table indexed by the address
+   of the call form.  Redefining a global procedure, binding a symbol
+   locally for the first time, or a GC (which may recycle the cell of
+   a call form) bumps cache_epoch and so invalidates every entry. */
+
+#define CALL_CACHE_SIZE 1024
+#define CALL_CACHE_INDEX(e) \
+    ((((unsigned)(e)) / sizeof(struct object)) % CALL_CACHE_SIZE)
+
+static struct call_cache {
+    SCM site, callee;
+    unsigned long epoch;
+} call_cache[CALL_CACHE_SIZE];
+
+static unsigned long cache_epoch = 1;
+
+long stat_call_cache_hits, stat_call_cache_misses;
+
+void invalidate_call_caches(void) {
+    cache_epoch++;
+}
+
+/* The cached callee of the form E, or NULL if there is none */
+static SCM cached_callee(SCM e) {
+    struct call_cache *cc;
+
+    if (!IS_PAIR(e) || !IS_SYMBOL(CAR(e)) || IS_LEXICAL(CAR(e)))
+        return NULL;
+    cc = &call_cache[CALL_CACHE_INDEX(e)];
+    return EQ(cc->site, e) && cc->epoch == cache_epoch ? cc->callee : NULL;
+}
+
+/* Inlined primitives
+
+   The builtin subrs below carry an opcode in their tags.  A cached
+   call site whose callee has an opcode runs it directly, with a
+   fixnum fast path, instead of going through SUBR_FUN.  Since the
+   call cache only holds the current global value of a symbol that
+   is not bound locally, rebinding (e.g.) + locally or globally
+   disables inlining at every affected site.
+
+   The arithmetic and comparison primitives evaluate their operands
+   with eval_number, which runs a nested cached call of +, - or *
+   without boxing its value: in (< (+ (* x x) (* y y)) r2) on
+   flonums, no flonum is allocated at all. */
+
+enum {
+    OP_NONE = 0,
+    OP_CAR, OP_CDR, OP_NULLP, OP_PAIRP, OP_NOT, OP_ZEROP,
+    OP_ONEPLUS, OP_MINUSONEPLUS,
+    OP_CONS, OP_EQ, OP_PLUS, OP_MINUS, OP_TIMES,
+    OP_NUMEQUAL, OP_LESSTHAN, OP_LESSEQUAL, OP_GREATERTHAN, OP_GREATEREQUAL,
+    /* variants called by compiled code where the types of the
+       arguments are known: no dispatch on types, and only the
+       fixnum fast path on numbers */
+    OP_SYS_CAR, OP_SYS_CDR, OP_SYS_ZEROP, OP_SYS_ONEPLUS,
+    OP_SYS_MINUSONEPLUS, OP_SYS_PLUS, OP_SYS_MINUS, OP_SYS_TIMES,
+    OP_SYS_NUMEQUAL, OP_SYS_LESSTHAN, OP_SYS_LESSEQUAL,
+    OP_SYS_GREATERTHAN, OP_SYS_GREATEREQUAL,
+    NUM_INLINE_OPS
+};
+
+static char *inline_subr_names[NUM_INLINE_OPS] = {
+    NULL,
+    "CAR", "CDR", "NULL?", "PAIR?", "NOT", "ZERO?",
+    "1+", "-1+",
+    "CONS", "EQ?", "+", "-", "*",
+    "=", "<", "<=", ">", ">=",
+    "SYS:CAR", "SYS:CDR", "SYS:ZERO?", "SYS:1+",
+    "SYS:-1+", "SYS:+", "SYS:-", "SYS:*",
+    "SYS:=", "SYS:<", "SYS:<=",
+    "SYS:>", "SYS:>="
+};
+
+long stat_inline_calls, stat_unchecked_calls;
+
+void init_eval(void) {
+    int op;
+    multiple_values = mk_symbol("**VALUES**");
+    for (op = OP_NONE + 1; op < NUM_INLINE_OPS; op++)
+        SET_INLINE_OP(SYM_VALUE(mk_symbol(inline_subr_names[op])), op);
+}
+
+/* Safe points
+
+   EVAL_FUEL is decremented at every closure entry and at every
+   iteration of a DO.  When it runs out, safe_point checks for a
+   pending interrupt and for the deadline set by WITH-BUDGET, and
+   refills it.  Without a deadline it gets FUEL_INTERVAL steps, so an
+   interrupt is acted on within that many steps, at a point where the
+   heap and the evaluator are consistent.  Steps are counted on a
+   clock, fuel_issued - eval_fuel, so a deadline is an absolute step
+   count that a catch frame can simply save and restore. */
+
+#define FUEL_INTERVAL 10000
+#define USE_FUEL() { if (--eval_fuel <= 0) safe_point(); }
+
+long eval_fuel = FUEL_INTERVAL;
+long eval_deadline = NO_DEADLINE;
+static long fuel_issued = FUEL_INTERVAL;
+static volatile sig_atomic_t interrupt_pending;
+long stat_safe_points;
+
+static void safe_point(void);
+
+/* Sets the deadline to D and hands out the steps up to it, at most
+   FUEL_INTERVAL at a time. */
+void set_eval_deadline(long d) {
+    long now = fuel_issued - eval_fuel, chunk = FUEL_INTERVAL;
+    if (d != NO_DEADLINE && d - now < chunk)
+        chunk = d - now > 0 ? d - now : 0;
+    eval_deadline = d;
+    fuel_issued = now + chunk;
+    eval_fuel = chunk;
+}
+
+/* Called by the SIGINT handler.  The second interrupt before a safe
+   point is reached returns to the toplevel at once. */
+void request_interrupt(void) {
+    if (interrupt_pending) {
+        interrupt_pending = 0;
+        fprintf(stderr, "Interrupted\n");
+        longjmp(error_return, NON_FATAL);
+    }
+    interrupt_pending = 1;
+}
+
+static void safe_point(void) {
+    stat_safe_points++;
+    if (interrupt_pending) {
+        interrupt_pending = 0;
+        fprintf(stderr, "Interrupted\n");
+        longjmp(error_return, NON_FATAL);
+    }
+    if (eval_deadline != NO_DEADLINE &&
+        fuel_issued - eval_fuel >= eval_deadline) {
+        fuel_issued -= eval_fuel;
+        eval_fuel = 0;
+        error0("ERROR: with-budget: the budget is exhausted.\n");
+    }
+    set_eval_deadline(eval_deadline);
+}
+
+/* WITH-BUDGET n thunk -- calls THUNK, which may take at most N
+   steps, and no more than the enclosing budget leaves */
+SCM s_with_budget(SCM n, SCM thunk) {
+    long saved = eval_deadline, d;
+    SCM value;
+
+    if (!IS_FIXNUM(n) || FIXNUM(n) < 0)
+        wta_error("with-budget", 1);
+    d = fuel_issued - eval_fuel + FIXNUM(n);
+    set_eval_deadline(saved != NO_DEADLINE && saved < d ? saved : d);
+    value = apply_procedure(thunk, NIL);
+    set_eval_deadline(saved);
+    return value;
+}
+
+/* Loops
+
+   A named let binds its name to a closure over the loop variables.
+   If the name occurs in the body only as the operator of tail calls
+   with one argument per variable, and nothing in the body can
+   capture the environment (LAMBDA, THE-ENVIRONMENT), a call of that
+   closure never needs the bindings of the previous iteration again.
+   Such a loop is flagged FLAG_LOOP: its closure keeps a single frame
+   whose bindings each call updates in place.  A DO whose parts
+   cannot capture the environment is run the same way; otherwise
+   every iteration binds fresh variables.  The check is done once per
+   form and remembered in the flags of the form. */
+
+static bool loop_safe(SCM x, SCM name, int nvars, bool tail);
+
+static bool loop_safe_body(SCM body, SCM name, int nvars, bool tail) {
+    for (; IS_PAIR(body); body = CDR(body))
+        if (!loop_safe(CAR(body), name, nvars,
+                       tail && IS_NULL(CDR(body))))
+            return false;
+    return IS_NULL(body);
+}
+
+static bool loop_safe_bspecs(SCM bspecs, SCM name, int nvars) {
+    for (; IS_PAIR(bspecs); bspecs = CDR(bspecs)) {
+        if (!IS_PAIR(CAR(bspecs)) || EQ(CAAR(bspecs), name) ||
+            !loop_safe_body(CDAR(bspecs), name, nvars, false))
+            return false;
+    }
+    return IS_NULL(bspecs);
+}
+
+static bool loop_safe(SCM x, SCM name, int nvars, bool tail) {
+    SCM op, args;
+
+    if (IS_SYMBOL(x))
+        return NEQ(x, name);
+    if (!IS_PAIR(x))
+        return true;
+    op = CAR(x);
+    args = CDR(x);
+    if (!IS_PAIR(args))
+        return IS_NULL(args) && loop_safe(op, name, nvars, false);
+    if (EQ(op, sym_quote))
+        return true;
+    else if (EQ(op, sym_lambda) || EQ(op, sym_sys_lambda))
+        return false;
+    else if (EQ(op, name)) {
+        int n = 0;
+        if (!tail)
+            return false;
+        for (; IS_PAIR(args); args = CDR(args), n++)
+            if (!loop_safe(CAR(args), name, nvars, false))
+                return false;
+        return n == nvars;
+    }
+    else if (EQ(op, sym_if)) {
+        if (!loop_safe(CAR(args), name, nvars, false))
+            return false;
+        for (args = CDR(args); IS_PAIR(args); args = CDR(args))
+            if (!loop_safe(CAR(args), name, nvars, tail))
+                return false;
+        return IS_NULL(args);
+    }
+    else if (EQ(op, sym_begin) || EQ(op, sym_and) || EQ(op, sym_or))
+        return loop_safe_body(args, name, nvars, tail);
+    else if (EQ(op, sym_cond) || EQ(op, sym_case)) {
+        if (EQ(op, sym_case)) {
+            if (!loop_safe(CAR(args), name, nvars, false))
+                return false;
+            args = CDR(args);
+        }
+        for (; IS_PAIR(args); args = CDR(args)) {
+            SCM clause = CAR(args);
+            if (!IS_PAIR(clause))
+                return false;
+            if (EQ(op, sym_cond) && NEQ(CAR(clause), sym_else) &&
+                !loop_safe(CAR(clause), name, nvars, false))
+                return false;
+            if (!loop_safe_body(CDR(clause), name, nvars, tail))
+                return false;
+        }
+        return IS_NULL(args);
+    }
+    else if (EQ(op, sym_let) || EQ(op, sym_let_star) ||
+             EQ(op, sym_letrec)) {
+        if (IS_SYMBOL(CAR(args))) {
+            if (EQ(CAR(args), name) || !IS_PAIR(CDR(args)))
+                return false;
+            args = CDR(args);
+        }
+        return loop_safe_bspecs(CAR(args), name, nvars) &&
+            loop_safe_body(CDR(args), name, nvars, tail);
+    }
+    else if (EQ(op, sym_do)) {
+        if (!IS_PAIR(CDR(args)) || !IS_PAIR(CADR(args)))
+            return false;
+        return loop_safe_bspecs(CAR(args), name, nvars) &&
+            loop_safe(CAR(CADR(args)), name, nvars, false) &&
+            loop_safe_body(CDR(CADR(args)), name, nvars, tail) &&
+            loop_safe_body(CDDR(args), name, nvars, false);
+    }
+    else if (EQ(op, sym_set) || EQ(op, sym_define)) {
+        if (!IS_SYMBOL(CAR(args)) || EQ(CAR(args), name))
+            return false;
+        return loop_safe_body(CDR(args), name, nvars, false);
+    }
+    if (IS_SYMBOL(op) && IS_FSUBR(SYM_VALUE(op)))
+        return false;
+    return loop_safe(op, name, nvars, false) &&
+        loop_safe_body(args, name, nvars, false);
+}
+
+/* Does the named let or do FORM run with in-place updates? */
+static bool loop_is_safe(SCM form) {
+    if (!HAS_FLAG(form, FLAG_LOOP_CHECKED)) {
+        SCM args = CDR(form), name = NIL, bspecs = FIRST(args), l;
+        int nvars = 0;
+        bool safe;
+        if (EQ(CAR(form), sym_let)) {
+            name = FIRST(args);
+            bspecs = SECOND(args);
+        }
+        for (l = bspecs; IS_PAIR(l); l = CDR(l))
+            nvars++;
+        if (EQ(CAR(form), sym_let))
+            safe = loop_safe_bspecs(bspecs, name, nvars) &&
+                loop_safe_body(CDDR(args), name, nvars, true);
+        else
+            safe = loop_safe(form, name, nvars, true);
+        if (safe && nvars <= MAX_STACK_ARGS)
+            SET_FLAG(form, FLAG_LOOP);
+        SET_FLAG(form, FLAG_LOOP_CHECKED);
+    }
+    return HAS_FLAG(form, FLAG_LOOP);
+}
+
+/* Makes the procedure of the named let FORM, bound to its name in a
+   new frame on ENV.  The frame of the loop variables is added by the
+   caller. */
+static SCM mk_loop(SCM form, SCM env) {
+    SCM args = CDR(form), vars = NIL, *tail = &vars, bspecs, loop;
+
+    for (bspecs = SECOND(args); IS_PAIR(bspecs); bspecs = CDR(bspecs)) {
+        *tail = CONS(CAAR(bspecs), NIL);
+        tail = &CDR(*tail);
+    }
+    env = bind(env, FIRST(args), unbound_value);
+    loop = mk_closure(CONS(vars, CDDR(args)), env);
+    set_symval(env, FIRST(args), loop, 0);
+    if (loop_is_safe(form))
+        SET_FLAG(loop, FLAG_LOOP);
+    return loop;
+}
 
+/* Stores the N values in VALS into the innermost N bindings of ENV,
+   which were made in the order of the loop variables. */
+static void update_loop_vars(SCM env, SCM *vals, int n) {
+    while (n > 0) {
+        CDR(CAR(env)) = vals[--n];
+        env = CDR(env);
+    }
+}
+
+/* Binds the variables of the DO FORM to the next values VALS, in
+   place if possible or else in a fresh frame on OUTER. */
+static SCM rebind_do_vars(SCM form, SCM env, SCM outer, SCM *vals, int n) {
+    SCM bspecs;
+    int i = 0;
+
+    if (loop_is_safe(form)) {
+        update_loop_vars(env, vals, n);
+        return env;
+    }
+    for (bspecs = SECOND(form); !IS_NULL(bspecs); bspecs = CDR(bspecs))
+        outer = bind(outer, CAAR(bspecs), vals[i++]);
+    return outer;
+}
+
+/* Evaluator modes
+
+   By default expressions are evaluated by eval_recursive, which uses
+   the C stack for every non-tail subexpression.  In stack mode
+   eval_stack_run is used instead; it keeps its continuation on a
+   growable heap region, so the depth of non-tail recursion is bounded
+   only by memory. */
+
+int stack_eval_mode = NO;
 
 SCM evaluate(SCM exp, SCM env) {
+    if (stack_eval_mode)
+        return eval_stack_run(exp, env);
+    return eval_recursive(exp, env);
+}
+
+static SCM eval_recursive(SCM exp, SCM env) {
     SCM e = exp, r = env;
 
 #ifdef DEBUG
-    fprintf (stderr, "evaluate: ");
+    fprintf (stderr, "eval_recursive: ");
     scm_write (exp, stderr_value, 0);
     putc ('\n', stderr);
 #endif
@@ -55,7 +437,7 @@ SCM evaluate(SCM exp, SCM env) {
     if (IS_NULL(e))
         return unspecified_value;
     while (!IS_NULL(CDR(e))) {
-        evaluate(CAR(e), r);
+        eval_recursive(CAR(e), r);
         e = CDR(e);
     }
     e = CAR(e);
@@ -68,6 +450,17 @@ SCM evaluate(SCM exp, SCM env) {
     case T_CHARACTER:
     case T_NULL:
     case T_STRING:
+    case T_VECTOR:
+    case T_BYTEVECTOR:
+    case T_S32VECTOR:
+    case T_FLONUM:
+    case T_BIGNUM:
+    case T_HASHTABLE:
+    case T_MAP:
+    case T_SET:
+    case T_RECORD_TYPE:
+    case T_RECORD:
+    case T_RECORD_PROC:
     case T_EOF_VALUE:
         return e;
         
@@ -83,6 +476,21 @@ SCM evaluate(SCM exp, SCM env) {
     }
 
     SCM op  = CAR(e), args = CDR(e);
+    struct call_cache *cc = NULL;
+
+    /* A cache hit implies that e was an application when it was
+       cached, so the special forms need not be checked. */
+    if (IS_SYMBOL(op) && !IS_LEXICAL(op)) {
+        cc = &call_cache[CALL_CACHE_INDEX(e)];
+        if (EQ(cc->site, e) && cc->epoch == cache_epoch) {
+            stat_call_cache_hits++;
+            op = cc->callee;
+            if (INLINE_OP(op) != OP_NONE)
+                return apply_inline(op, args, r);
+            goto apply;
+        }
+    }
+
     if (EQ(op, sym_quote))
         return(CAR(args));
     if (EQ(op, sym_begin)) {
@@ -91,8 +499,14 @@ SCM evaluate(SCM exp, SCM env) {
     }
     else if (EQ(op, sym_let)) {
         if (IS_SYMBOL(FIRST(args))) {
-            printf("sorry\n");
-            return NIL;
+            SCM loop = mk_loop(e, r), frame = CLOSURE_ENV(loop), l;
+            for (l = SECOND(args); !IS_NULL(l); l = CDR(l))
+                frame = bind(frame, CAAR(l), EVAL_ARG(CADR(CAR(l)), r));
+            if (HAS_FLAG(loop, FLAG_LOOP))
+                CLOSURE_ENV(loop) = frame;
+            r = frame;
+            e = CDDR(args);
+            goto eval_begin;
         }
         else {
             e = CDR(args);
@@ -110,8 +524,37 @@ SCM evaluate(SCM exp, SCM env) {
         r = extend_letrec_env(r, FIRST(args));
         goto eval_begin;
     }
+    else if (EQ(op, sym_do)) {
+        SCM outer = r, l;
+        bool safe = loop_is_safe(e);
+        for (l = FIRST(args); !IS_NULL(l); l = CDR(l))
+            r = bind(r, CAAR(l), EVAL_ARG(CADR(CAR(l)), outer));
+        while (EQ(eval_recursive(CAR(SECOND(args)), r), boolean_false)) {
+            USE_FUEL();
+            for (l = CDDR(args); !IS_NULL(l); l = CDR(l))
+                eval_recursive(CAR(l), r);
+            if (safe) {
+                SCM vals[MAX_STACK_ARGS];
+                int n = 0;
+                for (l = FIRST(args); !IS_NULL(l); l = CDR(l), n++)
+                    vals[n] = IS_NULL(CDDR(CAR(l))) ?
+                        get_symval(r, CAAR(l)) : EVAL_ARG(THIRD(CAR(l)), r);
+                update_loop_vars(r, vals, n);
+            }
+            else {
+                SCM frame = outer;
+                for (l = FIRST(args); !IS_NULL(l); l = CDR(l))
+                    frame = bind(frame, CAAR(l), IS_NULL(CDDR(CAR(l))) ?
+                                 get_symval(r, CAAR(l)) :
+                                 eval_recursive(THIRD(CAR(l)), r));
+                r = frame;
+            }
+        }
+        e = CDR(SECOND(args));
+        goto eval_begin;
+    }
     else if (EQ(op, sym_if)) {
-        if (EQ(evaluate (FIRST(args), r), boolean_false)) {
+        if (EQ(eval_recursive (FIRST(args), r), boolean_false)) {
             e = CDDR(args);
             goto eval_begin;
         }
@@ -127,7 +570,8 @@ SCM evaluate(SCM exp, SCM env) {
                 e = CDAR(args);
                 goto eval_begin;
             }
-            else if (NEQ((tmp = evaluate (CAAR(args), r)), boolean_false)) {
+            else if (NEQ((tmp = eval_recursive(CAAR(args), r)),
+                         boolean_false)) {
                 e = CDAR(args);
                 if (IS_NULL(e)) return tmp;
                 goto eval_begin;
@@ -136,9 +580,10 @@ SCM evaluate(SCM exp, SCM env) {
             if (!(IS_PAIR(args) || IS_NULL(args)))
                 error0("cond: ill-formed expression");
         }
+        return unspecified_value;
     }
     else if (EQ(op, sym_case)) {
-        SCM tmp = evaluate(FIRST(args), r);
+        SCM tmp = eval_recursive(FIRST(args), r);
         args = CDR(args);
         while (!IS_NULL(args)) {
             if (EQ(CAAR(args), sym_else)) {
@@ -146,7 +591,7 @@ SCM evaluate(SCM exp, SCM env) {
                 goto eval_begin;
             }
             else if (IS_PAIR(CAAR(args))) {
-                if (memq(tmp, CAAR(args))) {
+                if (memv(tmp, CAAR(args))) {
                     e = CDAR(args);
                     goto eval_begin;
                 }
@@ -157,32 +602,40 @@ SCM evaluate(SCM exp, SCM env) {
             if (!(IS_PAIR(args) || IS_NULL(args)))
                 error0("case: ill-formed expression");
         }
+        return unspecified_value;
     }
     else if (EQ(op, sym_and)) {
-        SCM tmp = boolean_true;
-        while (!IS_NULL(args)) {
-            tmp = evaluate (FIRST(args), r);
-            if (EQ(tmp, boolean_false))
+        if (IS_NULL(args))
+            return boolean_true;
+        while (!IS_NULL(CDR(args))) {
+            if (EQ(eval_recursive (FIRST(args), r), boolean_false))
                 return boolean_false;
             args = CDR(args);
         }
-        return tmp;
+        e = FIRST(args);
+        goto eval_one;
     }
     else if (EQ(op, sym_or)) {
-        while (!IS_NULL(args)) {
-            SCM tmp = evaluate (FIRST(args), r);
+        if (IS_NULL(args))
+            return boolean_false;
+        while (!IS_NULL(CDR(args))) {
+            SCM tmp = eval_recursive (FIRST(args), r);
             if (NEQ(tmp, boolean_false))
                 return tmp;
             args = CDR(args);
         }
-        return boolean_false;
+        e = FIRST(args);
+        goto eval_one;
     }
     else if (EQ(op, sym_lambda)) {
-        return mk_closure(CAR(args), CDR(args), r);
+        return mk_closure(args, r);
+    }
+    else if (EQ(op, sym_sys_lambda)) {
+        return mk_closure(CDR(args), flat_env(FIRST(args), r));
     }
     else if (EQ(op, sym_set)) {
         if (IS_SYMBOL(CAR(args)))
-            set_symval(r, CAR(args), evaluate(CADR(args), r), 0);
+            set_symval(r, CAR(args), eval_recursive(CADR(args), r), 0);
         else
             error0("set!: 1st arg is not a symbol.");
         return unspecified_value;
@@ -191,7 +644,7 @@ SCM evaluate(SCM exp, SCM env) {
         SCM first = CAR(args);
         switch (TYPE(first)) {
         case T_SYMBOL:
-            set_symval(r, first, evaluate(CADR(args), r), 1);
+            set_symval(r, first, eval_recursive(CADR(args), r), 1);
             return unspecified_value;
         case T_PAIR: {
             SCM closure;
@@ -205,34 +658,56 @@ SCM evaluate(SCM exp, SCM env) {
             error0("define: wrong expression");
         }
     }
-    op = evaluate(op, r);
+    if (cc != NULL) {
+        stat_call_cache_misses++;
+        op = get_symval(r, op);
+        check_arity(op, args);
+        if (is_procedure(op)) {
+            cc->site = e;
+            cc->callee = op;
+            cc->epoch = cache_epoch;
+        }
+    }
+    else {
+        op = eval_recursive(op, r);
+        check_arity(op, args);
+    }
+
+ apply:
     switch (TYPE(op)) {
     case T_FSUBR:
         return ((*(SCM (*)(SCM ,SCM))SUBR_FUN(op))(args, r));
 
     case T_SUBR0:
-        check_nargs(SUBR_SNAME(op), args, 0, 0);
         return ((*SUBR_FUN(op))());
 
     case T_SUBR1:
-        check_nargs(SUBR_SNAME(op), args, 1, 1);
         return ((*(SCM (*)(SCM))SUBR_FUN(op))
-                (evaluate(FIRST(args),r)));
+                (EVAL_ARG(FIRST(args),r)));
 
     case T_SUBR2:
-        check_nargs(SUBR_SNAME(op), args, 2, 2);
         return ((*(SCM (*)(SCM, SCM))SUBR_FUN(op))
-                (evaluate(FIRST(args),r),
-                 evaluate(SECOND(args),r)));
+                (EVAL_ARG(FIRST(args),r),
+                 EVAL_ARG(SECOND(args),r)));
 
     case T_SUBR3:
-        check_nargs(SUBR_SNAME(op), args, 3, 3);
         return ((*(SCM (*)(SCM, SCM, SCM))SUBR_FUN(op))
-                (evaluate(FIRST(args),r),
-                 evaluate(SECOND(args),r),
-                 evaluate(THIRD(args),r)));
+                (EVAL_ARG(FIRST(args),r),
+                 EVAL_ARG(SECOND(args),r),
+                 EVAL_ARG(THIRD(args),r)));
 
     case T_SUBRN:
+        if (HAS_FLAG(op, FLAG_APPLY)) {
+            op = spread_apply(evaluate_list(args, r), &args);
+            if (!IS_CLOSURE(op))
+                return apply_procedure(op, args);
+            USE_FUEL();
+            r = bind_closure_args(op, args);
+            e = CDR(CLOSURE_CODE(op));
+            goto eval_begin;
+        }
+        if (HAS_FLAG(op, FLAG_STACK_ARGS))
+            return apply_subrn_on_stack(op, args, r);
         if (!IS_NULL(args)) {
             if (IS_PAIR(args))
                 args = evaluate_list(args, r);
@@ -241,32 +716,1249 @@ SCM evaluate(SCM exp, SCM env) {
         }
         return ((*(SCM (*)(SCM))SUBR_FUN(op))(args));
 
+    case T_RECORD_PROC: {
+        /* the values are kept on the C stack, where the GC finds
+           them while the record is made */
+        SCM l;
+        int n = 0;
+        for (l = args; IS_PAIR(l); l = CDR(l))
+            n++;
+        SCM vals[n + 1];
+        for (n = 0; IS_PAIR(args); args = CDR(args))
+            vals[n++] = EVAL_ARG(CAR(args), r);
+        return apply_record_proc(op, vals, n);
+    }
+
     case T_CLOSURE:
-        if (!IS_NULL(args)) {
-            if (IS_PAIR(args))
-                args = evaluate_list(args, r);
-            else
-                error0 ("invalid expression.");
+        USE_FUEL();
+        if (HAS_FLAG(op, FLAG_LOOP)) {
+            SCM vals[MAX_STACK_ARGS];
+            int n = 0;
+            for (; !IS_NULL(args); args = CDR(args))
+                vals[n++] = EVAL_ARG(CAR(args), r);
+            r = CLOSURE_ENV(op);
+            update_loop_vars(r, vals, n);
         }
+        else
+            r = bind_arguments(CLOSURE_ENV(op), CAR(CLOSURE_CODE(op)),
+                               args, r);
         e = CDR(CLOSURE_CODE(op));
-        r = extend_env(CLOSURE_ENV(op), CAR(CLOSURE_CODE(op)), args);
         goto eval_begin;
     default:
         error0 ("unknown function type");
         return unspecified_value;
     }
-} /* evaluate */
+} /* eval_recursive */
+
+/* Explicit-stack evaluator
+
+   A frame on eval_stack starts with its kind and the index of the
+   previous frame, followed by the slots of that kind.  The values of
+   the arguments of an application are pushed above its K_ARGS frame.
+   Every word on the stack is a Scheme object, so gc marks the frames
+   precisely.  Forms are evaluated with the same helpers and the same
+   call-site caches as in eval_recursive; an inlined primitive is only
+   used when its operands are variables, numbers or (up to
+   INLINE_DEPTH deep) cached calls of inlined primitives on such
+   operands, since apply_inline evaluates them without pushing
+   frames. */
+
+enum {
+    K_DONE,         /* -                        */
+    K_SEQ,          /* rest-of-body env         */
+    K_IF,           /* args env                 */
+    K_COND,         /* clauses env              */
+    K_CASE,         /* clauses env              */
+    K_AND,          /* rest env                 */
+    K_OR,           /* rest env                 */
+    K_SET,          /* var env                  */
+    K_DEFINE,       /* var env                  */
+    K_LET,          /* bspecs new-env body env loop */
+    K_LET_STAR,     /* bspecs env body          */
+    K_LETREC,       /* bspecs env body          */
+    K_OP,           /* args env                 */
+    K_ARGS,         /* fun exps env . values    */
+    K_DO            /* form env outer rest phase . values */
+};
+
+/* phases of K_DO */
+enum { DO_INIT, DO_TEST, DO_BODY, DO_STEP };
+
+#define EVAL_STACK_INITIAL_SIZE 1024
+
+#define IS_TRIVIAL(x) (IS_FIXNUM(x) || IS_SYMBOL(x))
+#define INLINE_DEPTH 4
+
+#define FRAME_KIND(f)   FIXNUM(eval_stack[f])
+#define FRAME_LINK(f)   FIXNUM(eval_stack[(f) + 1])
+#define FRAME_SLOT(f,i) (eval_stack[(f) + 2 + (i)])
+
+SCM *eval_stack;
+long eval_stack_ptr;
+long eval_frame = -1;
+static long eval_stack_size;
+
+static void reserve_eval_stack(long n) {
+    if (eval_stack_ptr + n > eval_stack_size) {
+        long size = eval_stack_size;
+        if (size == 0)
+            size = EVAL_STACK_INITIAL_SIZE;
+        SCM *p;
+        while (eval_stack_ptr + n > size)
+            size *= 2;
+        if ((p = (SCM *)realloc(eval_stack, size * sizeof(SCM))) == NULL)
+            fatal_error("realloc: eval_stack");
+        eval_stack = p;
+        eval_stack_size = size;
+    }
+}
+
+static void push_frame(int kind, int nslots) {
+    int i;
+    reserve_eval_stack(2 + nslots);
+    eval_stack[eval_stack_ptr] = MK_FIXNUM(kind);
+    eval_stack[eval_stack_ptr + 1] = MK_FIXNUM(eval_frame);
+    for (i = 0; i < nslots; i++)
+        eval_stack[eval_stack_ptr + 2 + i] = NIL;
+    eval_frame = eval_stack_ptr;
+    eval_stack_ptr += 2 + nslots;
+}
+
+static void pop_frame(void) {
+    eval_stack_ptr = eval_frame;
+    eval_frame = FRAME_LINK(eval_frame);
+}
+
+static void push_value(SCM x) {
+    reserve_eval_stack(1);
+    eval_stack[eval_stack_ptr++] = x;
+}
+
+/* Discards all frames; called when an error returns to the top level */
+void reset_eval_stack(void) {
+    eval_stack_ptr = 0;
+    eval_frame = -1;
+}
+
+static bool inline_operands(SCM args, int depth);
+
+static bool inline_operand(SCM e, int depth) {
+    SCM fun;
+
+    if (IS_TRIVIAL(e) || IS_FLONUM(e))
+        return true;
+    return depth > 0 && (fun = cached_callee(e)) != NULL &&
+        INLINE_OP(fun) != OP_NONE && inline_operands(CDR(e), depth - 1);
+}
+
+/* Whether apply_inline can evaluate the operands ARGS of a cached
+   call without evaluation frames */
+static bool inline_operands(SCM args, int depth) {
+    return inline_operand(FIRST(args), depth) &&
+        (IS_NULL(CDR(args)) || inline_operand(SECOND(args), depth));
+}
+
+/* Evaluates E into *VAL if that needs no frame: a variable, a
+   constant, or a cached call of an inlined primitive on such
+   operands. */
+static bool eval_simple(SCM e, SCM r, SCM *val) {
+    SCM args;
+    struct call_cache *cc;
+
+    if (IS_FIXNUM(e) || IS_FLONUM(e)) {
+        *val = e;
+        return true;
+    }
+    if (IS_SYMBOL(e)) {
+        *val = get_symval(r, e);
+        return true;
+    }
+    if (!IS_PAIR(e) || !IS_SYMBOL(CAR(e)) || IS_LEXICAL(CAR(e)))
+        return false;
+    if (EQ(CAR(e), sym_quote)) {
+        *val = CADR(e);
+        return true;
+    }
+    cc = &call_cache[CALL_CACHE_INDEX(e)];
+    args = CDR(e);
+    if (EQ(cc->site, e) && cc->epoch == cache_epoch &&
+        INLINE_OP(cc->callee) != OP_NONE &&
+        inline_operands(args, INLINE_DEPTH)) {
+        stat_call_cache_hits++;
+        *val = apply_inline(cc->callee, args, r);
+        return true;
+    }
+    return false;
+}
+
+static SCM eval_stack_run(SCM exp, SCM env) {
+    SCM e = exp, r = env, val = unspecified_value;
+    SCM op, args, fun, *vals;
+    long f;
+    int n;
+
+    push_frame(K_DONE, 0);
+    goto eval;
+
+ eval_body:
+    if (IS_NULL(e)) {
+        val = unspecified_value;
+        goto ret;
+    }
+    if (!IS_NULL(CDR(e))) {
+        push_frame(K_SEQ, 2);
+        FRAME_SLOT(eval_frame, 0) = CDR(e);
+        FRAME_SLOT(eval_frame, 1) = r;
+    }
+    e = CAR(e);
+
+ eval:
+    switch (TYPE(e)) {
+    case T_FIXNUM:
+    case T_BOOLEAN:
+    case T_CHARACTER:
+    case T_NULL:
+    case T_STRING:
+    case T_VECTOR:
+    case T_BYTEVECTOR:
+    case T_S32VECTOR:
+    case T_FLONUM:
+    case T_BIGNUM:
+    case T_HASHTABLE:
+    case T_MAP:
+    case T_SET:
+    case T_RECORD_TYPE:
+    case T_RECORD:
+    case T_RECORD_PROC:
+    case T_EOF_VALUE:
+        val = e;
+        goto ret;
+    case T_SYMBOL:
+        val = get_symval(r, e);
+        goto ret;
+    case T_PAIR:
+        break;
+    default:
+        error0("invalid expression type.");
+    }
+
+    op = CAR(e);
+    args = CDR(e);
+    if (IS_SYMBOL(op) && !IS_LEXICAL(op)) {
+        struct call_cache *cc = &call_cache[CALL_CACHE_INDEX(e)];
+        if (EQ(cc->site, e) && cc->epoch == cache_epoch) {
+            stat_call_cache_hits++;
+            fun = cc->callee;
+            /* operands that need no evaluation frame */
+            if (INLINE_OP(fun) != OP_NONE &&
+                inline_operands(args, INLINE_DEPTH)) {
+                val = apply_inline(fun, args, r);
+                goto ret;
+            }
+            goto eval_args;
+        }
+    }
+
+    if (EQ(op, sym_quote)) {
+        val = CAR(args);
+        goto ret;
+    }
+    else if (EQ(op, sym_begin)) {
+        e = args;
+        goto eval_body;
+    }
+    else if (EQ(op, sym_let)) {
+        push_frame(K_LET, 5);
+        if (IS_SYMBOL(FIRST(args))) {
+            SCM loop = mk_loop(e, r);
+            FRAME_SLOT(eval_frame, 0) = SECOND(args);
+            FRAME_SLOT(eval_frame, 1) = CLOSURE_ENV(loop);
+            FRAME_SLOT(eval_frame, 2) = CDDR(args);
+            FRAME_SLOT(eval_frame, 4) = loop;
+        }
+        else {
+            FRAME_SLOT(eval_frame, 0) = FIRST(args);
+            FRAME_SLOT(eval_frame, 1) = r;
+            FRAME_SLOT(eval_frame, 2) = CDR(args);
+        }
+        FRAME_SLOT(eval_frame, 3) = r;
+        goto let_next;
+    }
+    else if (EQ(op, sym_do)) {
+        push_frame(K_DO, 5);
+        FRAME_SLOT(eval_frame, 0) = e;
+        FRAME_SLOT(eval_frame, 2) = r;
+        FRAME_SLOT(eval_frame, 3) = FIRST(args);
+        FRAME_SLOT(eval_frame, 4) = MK_FIXNUM(DO_INIT);
+        goto do_next;
+    }
+    else if (EQ(op, sym_let_star)) {
+        push_frame(K_LET_STAR, 3);
+        FRAME_SLOT(eval_frame, 0) = FIRST(args);
+        FRAME_SLOT(eval_frame, 1) = r;
+        FRAME_SLOT(eval_frame, 2) = CDR(args);
+        goto let_star_next;
+    }
+    else if (EQ(op, sym_letrec)) {
+        SCM l;
+        push_frame(K_LETREC, 3);
+        FRAME_SLOT(eval_frame, 0) = FIRST(args);
+        FRAME_SLOT(eval_frame, 1) = r;
+        FRAME_SLOT(eval_frame, 2) = CDR(args);
+        for (l = FIRST(args); !IS_NULL(l); l = CDR(l))
+            FRAME_SLOT(eval_frame, 1) =
+                bind(FRAME_SLOT(eval_frame, 1), CAAR(l), unbound_value);
+        goto letrec_next;
+    }
+    else if (EQ(op, sym_if)) {
+        if (eval_simple(FIRST(args), r, &val)) {
+            if (EQ(val, boolean_false)) {
+                e = CDDR(args);
+                goto eval_body;
+            }
+            e = SECOND(args);
+            goto eval;
+        }
+        push_frame(K_IF, 2);
+        FRAME_SLOT(eval_frame, 0) = args;
+        FRAME_SLOT(eval_frame, 1) = r;
+        e = FIRST(args);
+        goto eval;
+    }
+    else if (EQ(op, sym_cond)) {
+        push_frame(K_COND, 2);
+        FRAME_SLOT(eval_frame, 0) = args;
+        FRAME_SLOT(eval_frame, 1) = r;
+        goto cond_next;
+    }
+    else if (EQ(op, sym_case)) {
+        push_frame(K_CASE, 2);
+        FRAME_SLOT(eval_frame, 0) = CDR(args);
+        FRAME_SLOT(eval_frame, 1) = r;
+        e = FIRST(args);
+        goto eval;
+    }
+    else if (EQ(op, sym_and) || EQ(op, sym_or)) {
+        if (IS_NULL(args)) {
+            val = EQ(op, sym_and) ? boolean_true : boolean_false;
+            goto ret;
+        }
+        if (!IS_NULL(CDR(args))) {
+            push_frame(EQ(op, sym_and) ? K_AND : K_OR, 2);
+            FRAME_SLOT(eval_frame, 0) = CDR(args);
+            FRAME_SLOT(eval_frame, 1) = r;
+        }
+        e = FIRST(args);
+        goto eval;
+    }
+    else if (EQ(op, sym_lambda)) {
+        val = mk_closure(args, r);
+        goto ret;
+    }
+    else if (EQ(op, sym_sys_lambda)) {
+        val = mk_closure(CDR(args), flat_env(FIRST(args), r));
+        goto ret;
+    }
+    else if (EQ(op, sym_set) ||
+             (EQ(op, sym_define) && IS_SYMBOL(CAR(args)))) {
+        if (!IS_SYMBOL(CAR(args)))
+            error0("set!: 1st arg is not a symbol.");
+        push_frame(EQ(op, sym_set) ? K_SET : K_DEFINE, 2);
+        FRAME_SLOT(eval_frame, 0) = CAR(args);
+        FRAME_SLOT(eval_frame, 1) = r;
+        e = CADR(args);
+        goto eval;
+    }
+    else if (EQ(op, sym_define)) {
+        val = eval_recursive(e, r);
+        goto ret;
+    }
+
+    /* application */
+    if (IS_SYMBOL(op) && !IS_LEXICAL(op)) {
+        struct call_cache *cc = &call_cache[CALL_CACHE_INDEX(e)];
+        stat_call_cache_misses++;
+        fun = get_symval(r, op);
+        check_arity(fun, args);
+        if (is_procedure(fun)) {
+            cc->site = e;
+            cc->callee = fun;
+            cc->epoch = cache_epoch;
+        }
+    }
+    else if (IS_SYMBOL(op)) {
+        fun = get_symval(r, op);
+        check_arity(fun, args);
+    }
+    else {
+        push_frame(K_OP, 2);
+        FRAME_SLOT(eval_frame, 0) = args;
+        FRAME_SLOT(eval_frame, 1) = r;
+        e = op;
+        goto eval;
+    }
+
+ eval_args:
+    if (IS_FSUBR(fun)) {
+        val = (*(SCM (*)(SCM ,SCM))SUBR_FUN(fun))(args, r);
+        goto ret;
+    }
+    push_frame(K_ARGS, 3);
+    FRAME_SLOT(eval_frame, 0) = fun;
+    FRAME_SLOT(eval_frame, 2) = r;
+
+ next_arg:
+    for (;;) {
+        if (IS_NULL(args))
+            goto apply;
+        if (!IS_PAIR(args))
+            error0 ("invalid expression.");
+        if (!eval_simple(CAR(args), r, &val))
+            break;
+        push_value(val);
+        args = CDR(args);
+    }
+    FRAME_SLOT(eval_frame, 1) = CDR(args);
+    e = CAR(args);
+    goto eval;
+
+ apply:
+    /* the K_ARGS frame is on top, followed by the argument values */
+    f = eval_frame;
+    fun = FRAME_SLOT(f, 0);
+    vals = &FRAME_SLOT(f, 3);
+    n = (int)(eval_stack_ptr - (f + 5));
+    switch (TYPE(fun)) {
+    case T_SUBR0:
+        pop_frame();
+        val = (*SUBR_FUN(fun))();
+        goto ret;
+    case T_SUBR1: {
+        SCM x = vals[0];
+        pop_frame();
+        val = (*(SCM (*)(SCM))SUBR_FUN(fun))(x);
+        goto ret;
+    }
+    case T_SUBR2: {
+        SCM x = vals[0], y = vals[1];
+        pop_frame();
+        val = (*(SCM (*)(SCM, SCM))SUBR_FUN(fun))(x, y);
+        goto ret;
+    }
+    case T_SUBR3: {
+        SCM x = vals[0], y = vals[1], z = vals[2];
+        pop_frame();
+        val = (*(SCM (*)(SCM, SCM, SCM))SUBR_FUN(fun))(x, y, z);
+        goto ret;
+    }
+    case T_SUBRN: {
+        struct object cells[MAX_STACK_ARGS];
+        SCM l = NIL;
+        if (HAS_FLAG(fun, FLAG_STACK_ARGS) && n <= MAX_STACK_ARGS)
+            l = stack_list(cells, vals, n);
+        else
+            while (n > 0)
+                l = CONS(vals[--n], l);
+        pop_frame();
+        if (HAS_FLAG(fun, FLAG_APPLY)) {
+            fun = spread_apply(l, &args);
+            if (!IS_CLOSURE(fun)) {
+                val = apply_procedure(fun, args);
+                goto ret;
+            }
+            USE_FUEL();
+            r = bind_closure_args(fun, args);
+            e = CDR(CLOSURE_CODE(fun));
+            goto eval_body;
+        }
+        val = (*(SCM (*)(SCM))SUBR_FUN(fun))(l);
+        goto ret;
+    }
+    case T_RECORD_PROC:
+        /* the values stay on the stack until the record is made */
+        val = apply_record_proc(fun, vals, n);
+        pop_frame();
+        goto ret;
+    case T_CLOSURE:
+        USE_FUEL();
+        if (HAS_FLAG(fun, FLAG_LOOP)) {
+            r = CLOSURE_ENV(fun);
+            update_loop_vars(r, vals, n);
+        }
+        else
+            r = bind_values(CLOSURE_ENV(fun), CAR(CLOSURE_CODE(fun)),
+                            vals, n);
+        pop_frame();
+        e = CDR(CLOSURE_CODE(fun));
+        goto eval_body;
+    default:
+        error0 ("unknown function type");
+    }
+
+ let_next:
+    f = eval_frame;
+    args = FRAME_SLOT(f, 0);
+    if (IS_NULL(args)) {
+        r = FRAME_SLOT(f, 1);
+        e = FRAME_SLOT(f, 2);
+        if (HAS_FLAG(FRAME_SLOT(f, 4), FLAG_LOOP))
+            CLOSURE_ENV(FRAME_SLOT(f, 4)) = r;
+        pop_frame();
+        goto eval_body;
+    }
+    if (IS_NULL(CDAR(args))) {
+        FRAME_SLOT(f, 1) = bind(FRAME_SLOT(f, 1), CAAR(args), unbound_value);
+        FRAME_SLOT(f, 0) = CDR(args);
+        goto let_next;
+    }
+    e = CADR(CAR(args));
+    r = FRAME_SLOT(f, 3);
+    goto eval;
+
+ let_star_next:
+    f = eval_frame;
+    args = FRAME_SLOT(f, 0);
+    r = FRAME_SLOT(f, 1);
+    if (IS_NULL(args)) {
+        e = FRAME_SLOT(f, 2);
+        pop_frame();
+        goto eval_body;
+    }
+    if (IS_NULL(CDAR(args))) {
+        FRAME_SLOT(f, 1) = bind(r, CAAR(args), unbound_value);
+        FRAME_SLOT(f, 0) = CDR(args);
+        goto let_star_next;
+    }
+    e = CADR(CAR(args));
+    goto eval;
+
+ letrec_next:
+    f = eval_frame;
+    args = FRAME_SLOT(f, 0);
+    r = FRAME_SLOT(f, 1);
+    if (IS_NULL(args)) {
+        e = FRAME_SLOT(f, 2);
+        pop_frame();
+        goto eval_body;
+    }
+    e = SECOND(CAR(args));
+    goto eval;
+
+ cond_next:
+    f = eval_frame;
+    args = FRAME_SLOT(f, 0);
+    if (IS_NULL(args)) {
+        pop_frame();
+        val = unspecified_value;
+        goto ret;
+    }
+    if (!IS_PAIR(args))
+        error0("cond: ill-formed expression");
+    r = FRAME_SLOT(f, 1);
+    if (EQ(CAAR(args), sym_else)) {
+        pop_frame();
+        e = CDAR(args);
+        goto eval_body;
+    }
+    e = CAAR(args);
+    goto eval;
+
+ do_next:
+    /* the values of the inits or steps are pushed above the frame */
+    f = eval_frame;
+    e = FRAME_SLOT(f, 0);
+    args = FRAME_SLOT(f, 3);
+    switch (FIXNUM(FRAME_SLOT(f, 4))) {
+    case DO_INIT:
+        if (IS_PAIR(args)) {
+            FRAME_SLOT(f, 3) = CDR(args);
+            r = FRAME_SLOT(f, 2);
+            e = CADR(CAR(args));
+            goto eval;
+        }
+        r = FRAME_SLOT(f, 2);
+        vals = &FRAME_SLOT(f, 5);
+        for (n = 0, args = SECOND(e); !IS_NULL(args); args = CDR(args))
+            r = bind(r, CAAR(args), vals[n++]);
+        FRAME_SLOT(f, 1) = r;
+        break;
+    case DO_BODY:
+        if (IS_PAIR(args)) {
+            FRAME_SLOT(f, 3) = CDR(args);
+            r = FRAME_SLOT(f, 1);
+            e = CAR(args);
+            goto eval;
+        }
+        USE_FUEL();
+        FRAME_SLOT(f, 3) = SECOND(e);
+        FRAME_SLOT(f, 4) = MK_FIXNUM(DO_STEP);
+        goto do_next;
+    case DO_STEP:
+        r = FRAME_SLOT(f, 1);
+        if (IS_PAIR(args)) {
+            FRAME_SLOT(f, 3) = CDR(args);
+            if (!IS_NULL(CDDR(CAR(args)))) {
+                e = THIRD(CAR(args));
+                goto eval;
+            }
+            push_value(get_symval(r, CAAR(args)));
+            goto do_next;
+        }
+        vals = &FRAME_SLOT(f, 5);
+        n = (int)(eval_stack_ptr - (f + 7));
+        FRAME_SLOT(f, 1) = rebind_do_vars(e, r, FRAME_SLOT(f, 2), vals, n);
+        break;
+    }
+    /* test */
+    eval_stack_ptr = f + 7;
+    FRAME_SLOT(f, 4) = MK_FIXNUM(DO_TEST);
+    r = FRAME_SLOT(f, 1);
+    e = CAR(THIRD(e));
+    goto eval;
+
+ ret:
+    f = eval_frame;
+    switch (FRAME_KIND(f)) {
+    case K_DONE:
+        pop_frame();
+        return val;
+
+    case K_SEQ:
+        e = FRAME_SLOT(f, 0);
+        r = FRAME_SLOT(f, 1);
+        if (IS_NULL(CDR(e)))
+            pop_frame();
+        else
+            FRAME_SLOT(f, 0) = CDR(e);
+        e = CAR(e);
+        goto eval;
+
+    case K_IF:
+        args = FRAME_SLOT(f, 0);
+        r = FRAME_SLOT(f, 1);
+        pop_frame();
+        if (EQ(val, boolean_false)) {
+            e = CDDR(args);
+            goto eval_body;
+        }
+        e = SECOND(args);
+        goto eval;
+
+    case K_COND:
+        args = FRAME_SLOT(f, 0);
+        if (NEQ(val, boolean_false)) {
+            r = FRAME_SLOT(f, 1);
+            pop_frame();
+            e = CDAR(args);
+            if (IS_NULL(e))
+                goto ret;
+            goto eval_body;
+        }
+        FRAME_SLOT(f, 0) = CDR(args);
+        goto cond_next;
+
+    case K_CASE:
+        args = FRAME_SLOT(f, 0);
+        r = FRAME_SLOT(f, 1);
+        pop_frame();
+        for (; !IS_NULL(args); args = CDR(args)) {
+            if (!IS_PAIR(args))
+                error0("case: ill-formed expression");
+            if (EQ(CAAR(args), sym_else) ||
+                (IS_PAIR(CAAR(args)) && memv(val, CAAR(args)))) {
+                e = CDAR(args);
+                goto eval_body;
+            }
+            if (!IS_PAIR(CAAR(args)))
+                error0("case: ill-formed expression");
+        }
+        val = unspecified_value;
+        goto ret;
+
+    case K_AND:
+    case K_OR:
+        if (EQ(val, boolean_false) == (FRAME_KIND(f) == K_AND)) {
+            pop_frame();
+            goto ret;
+        }
+        args = FRAME_SLOT(f, 0);
+        r = FRAME_SLOT(f, 1);
+        if (IS_NULL(CDR(args)))
+            pop_frame();
+        else
+            FRAME_SLOT(f, 0) = CDR(args);
+        e = CAR(args);
+        goto eval;
+
+    case K_SET:
+    case K_DEFINE:
+        set_symval(FRAME_SLOT(f, 1), FRAME_SLOT(f, 0), val,
+                   FRAME_KIND(f) == K_DEFINE);
+        pop_frame();
+        val = unspecified_value;
+        goto ret;
+
+    case K_LET:
+        args = FRAME_SLOT(f, 0);
+        FRAME_SLOT(f, 1) = bind(FRAME_SLOT(f, 1), CAAR(args), val);
+        FRAME_SLOT(f, 0) = CDR(args);
+        goto let_next;
+
+    case K_LET_STAR:
+        args = FRAME_SLOT(f, 0);
+        FRAME_SLOT(f, 1) = bind(FRAME_SLOT(f, 1), CAAR(args), val);
+        FRAME_SLOT(f, 0) = CDR(args);
+        goto let_star_next;
+
+    case K_LETREC:
+        args = FRAME_SLOT(f, 0);
+        set_symval(FRAME_SLOT(f, 1), CAAR(args), val, 0);
+        FRAME_SLOT(f, 0) = CDR(args);
+        goto letrec_next;
+
+    case K_OP:
+        fun = val;
+        args = FRAME_SLOT(f, 0);
+        r = FRAME_SLOT(f, 1);
+        pop_frame();
+        check_arity(fun, args);
+        goto eval_args;
+
+    case K_ARGS:
+        push_value(val);
+        args = FRAME_SLOT(eval_frame, 1);
+        r = FRAME_SLOT(eval_frame, 2);
+        goto next_arg;
+
+    case K_DO:
+        switch (FIXNUM(FRAME_SLOT(f, 4))) {
+        case DO_TEST:
+            if (NEQ(val, boolean_false)) {
+                r = FRAME_SLOT(f, 1);
+                e = CDR(THIRD(FRAME_SLOT(f, 0)));
+                pop_frame();
+                goto eval_body;
+            }
+            FRAME_SLOT(f, 3) = CDR(CDDR(FRAME_SLOT(f, 0)));
+            FRAME_SLOT(f, 4) = MK_FIXNUM(DO_BODY);
+            break;
+        case DO_INIT:
+        case DO_STEP:
+            push_value(val);
+            break;
+        }
+        goto do_next;
+
+    default:
+        fatal_error("eval_stack_run: broken frame\n");
+        return unspecified_value;
+    }
+} /* eval_stack_run */
+
+/* SYS:EVAL exp env -- env may be an alist built by hand */
+SCM s_sys_eval(SCM exp, SCM env) {
+    SCM l;
+    for (l = env; IS_PAIR(l); l = CDR(l))
+        if (IS_PAIR(CAR(l)) && IS_SYMBOL(CAAR(l)) && !IS_LEXICAL(CAAR(l))) {
+            SET_FLAG(CAAR(l), FLAG_LEXICAL);
+            invalidate_call_caches();
+        }
+    return evaluate(exp, env);
+}
+
+/* Applies the procedure FUN to the list of values ARGS.  This is
+   for C code that calls back into Scheme, e.g. a macro expander. */
+SCM apply_procedure(SCM fun, SCM args) {
+    check_arity(fun, args);
+    switch (TYPE(fun)) {
+    case T_SUBR0:
+        return ((*SUBR_FUN(fun))());
+    case T_SUBR1:
+        return ((*(SCM (*)(SCM))SUBR_FUN(fun))(FIRST(args)));
+    case T_SUBR2:
+        return ((*(SCM (*)(SCM, SCM))SUBR_FUN(fun))
+                (FIRST(args), SECOND(args)));
+    case T_SUBR3:
+        return ((*(SCM (*)(SCM, SCM, SCM))SUBR_FUN(fun))
+                (FIRST(args), SECOND(args), THIRD(args)));
+    case T_SUBRN:
+        return ((*(SCM (*)(SCM))SUBR_FUN(fun))(args));
+    case T_RECORD_PROC: {
+        SCM l;
+        int n = 0;
+        for (l = args; IS_PAIR(l); l = CDR(l))
+            n++;
+        SCM vals[n + 1];
+        for (n = 0; IS_PAIR(args); args = CDR(args))
+            vals[n++] = CAR(args);
+        return apply_record_proc(fun, vals, n);
+    }
+    case T_CLOSURE:
+        return apply_closure_body(fun, bind_closure_args(fun, args));
+    default:
+        error0 ("unknown function type");
+        return unspecified_value;
+    }
+}
+
+/* The environment in which the body of the closure FUN runs when it
+   is applied to the list of values ARGS. */
+static SCM bind_closure_args(SCM fun, SCM args) {
+    if (HAS_FLAG(fun, FLAG_LOOP)) {
+        SCM vals[MAX_STACK_ARGS];
+        int n = 0;
+        for (; IS_PAIR(args) && n < MAX_STACK_ARGS; args = CDR(args))
+            vals[n++] = CAR(args);
+        update_loop_vars(CLOSURE_ENV(fun), vals, n);
+        return CLOSURE_ENV(fun);
+    }
+    return bind_list(CLOSURE_ENV(fun), CAR(CLOSURE_CODE(fun)), args);
+}
+
+/* APPLY
+
+   Both evaluators recognize the APPLY subr by its FLAG_APPLY and
+   tail-call the procedure it is given, so a loop through APPLY runs
+   in constant space.  The last argument is shared, not copied: only
+   the cells for the arguments before it are consed. */
+
+/* Spreads the argument list (FUN X... LIST) of APPLY, again as long
+   as FUN is APPLY itself.  Returns the procedure and sets *SPREAD to
+   the list (X... . LIST) of its arguments. */
+static SCM spread_apply(SCM args, SCM *spread) {
+    SCM fun, head, *tail, l;
+    int argno;
+
+    do {
+        if (!IS_PAIR(args) || !IS_PAIR(CDR(args)))
+            wna_error("apply", IS_PAIR(args) ? 1 : 0);
+        fun = CAR(args);
+        head = NIL;
+        tail = &head;
+        for (args = CDR(args), argno = 2; IS_PAIR(CDR(args));
+             args = CDR(args), argno++) {
+            *tail = CONS(CAR(args), NIL);
+            tail = &CDR(*tail);
+        }
+        for (l = CAR(args); IS_PAIR(l); l = CDR(l))
+            ;
+        if (!IS_NULL(l))
+            wta_error("apply", argno);
+        *tail = CAR(args);
+        args = head;
+    } while (IS_SUBRN(fun) && HAS_FLAG(fun, FLAG_APPLY));
+    *spread = args;
+    return fun;
+}
+
+/* APPLY fun x... list -- called directly only from C; the evaluators
+   handle a call of APPLY themselves. */
+SCM s_apply(SCM args) {
+    SCM fun = spread_apply(args, &args);
+    return apply_procedure(fun, args);
+}
+
+/* Applies FUN to the N values in VALS without consing an argument
+   list, except for a SUBRN that keeps it or a rest parameter. */
+static SCM apply_values(SCM fun, SCM *vals, int n) {
+    struct object cells[MAX_STACK_ARGS];
+    SCM args;
+    int i;
+
+    switch (TYPE(fun)) {
+    case T_SUBR0:
+    case T_SUBR1:
+    case T_SUBR2:
+    case T_SUBR3:
+        if (n != TYPE(fun) - T_SUBR0)
+            wna_error(SUBR_SNAME(fun), n);
+        break;
+    case T_SUBRN:
+        if (HAS_FLAG(fun, FLAG_STACK_ARGS) && n <= MAX_STACK_ARGS)
+            args = stack_list(cells, vals, n);
+        else
+            for (args = NIL, i = n; i > 0; i--)
+                args = CONS(vals[i - 1], args);
+        return ((*(SCM (*)(SCM))SUBR_FUN(fun))(args));
+    case T_RECORD_PROC:
+        return apply_record_proc(fun, vals, n);
+    case T_CLOSURE:
+        if (HAS_FLAG(fun, FLAG_LOOP)) {
+            update_loop_vars(CLOSURE_ENV(fun), vals, n);
+            return apply_closure_body(fun, CLOSURE_ENV(fun));
+        }
+        return apply_closure_body(fun, bind_values(CLOSURE_ENV(fun),
+                                                   CAR(CLOSURE_CODE(fun)),
+                                                   vals, n));
+    default:
+        error0 ("unknown function type");
+    }
+    switch (n) {
+    case 0:
+        return ((*SUBR_FUN(fun))());
+    case 1:
+        return ((*(SCM (*)(SCM))SUBR_FUN(fun))(vals[0]));
+    case 2:
+        return ((*(SCM (*)(SCM, SCM))SUBR_FUN(fun))(vals[0], vals[1]));
+    default:
+        return ((*(SCM (*)(SCM, SCM, SCM))SUBR_FUN(fun))
+                (vals[0], vals[1], vals[2]));
+    }
+}
+
+static SCM apply_closure_body(SCM fun, SCM env) {
+    SCM body, val = unspecified_value;
+    USE_FUEL();
+    for (body = CDR(CLOSURE_CODE(fun)); IS_PAIR(body); body = CDR(body))
+        val = evaluate(CAR(body), env);
+    return val;
+}
+
+/* Multiple values
+
+   (VALUES x...) with other than one argument stores its arguments in
+   the register area mv_values and returns the marker MULTIPLE_VALUES.
+   A consumer reads them back right away, before anything else can
+   return multiple values; they never go through the heap.  gc marks
+   the register area. */
+
+SCM multiple_values;
+SCM mv_values[MAX_VALUES];
+int mv_count;
+
+/* VALUES x... */
+SCM s_values(SCM args) {
+    if (IS_PAIR(args) && IS_NULL(CDR(args)))
+        return CAR(args);
+    for (mv_count = 0; IS_PAIR(args); args = CDR(args)) {
+        if (mv_count == MAX_VALUES)
+            error0("values: too many values.\n");
+        mv_values[mv_count++] = CAR(args);
+    }
+    return multiple_values;
+}
+
+/* CALL-WITH-VALUES producer consumer */
+SCM s_call_with_values(SCM producer, SCM consumer) {
+    SCM vals[MAX_VALUES], x = apply_procedure(producer, NIL);
+    int i, n;
+
+    if (EQ(x, multiple_values)) {
+        n = mv_count;
+        for (i = 0; i < n; i++)
+            vals[i] = mv_values[i];
+    }
+    else {
+        vals[0] = x;
+        n = 1;
+    }
+    return apply_values(consumer, vals, n);
+}
+
+/* SYS:VALUES-CHECK x n restp -- loads the values X into the register
+   area; there must be N of them, or at least N if RESTP is true. */
+SCM s_sys_values_check(SCM x, SCM n, SCM restp) {
+    if (NEQ(x, multiple_values)) {
+        mv_values[0] = x;
+        mv_count = 1;
+    }
+    if (EQ(restp, boolean_false) ? mv_count != FIXNUM(n)
+                                 : mv_count < FIXNUM(n))
+        wna_error("receive", mv_count);
+    return unspecified_value;
+}
+
+/* SYS:VALUE-REF i */
+SCM s_sys_value_ref(SCM i) {
+    return mv_values[FIXNUM(i)];
+}
+
+/* SYS:VALUES-REST i -- the values from the I-th on, as a list */
+SCM s_sys_values_rest(SCM i) {
+    SCM l = NIL;
+    int j;
+    for (j = mv_count; j > FIXNUM(i); j--)
+        l = CONS(mv_values[j - 1], l);
+    return l;
+}
+
+static void check_arity(SCM fun, SCM args) {
+    switch (TYPE(fun)) {
+    case T_SUBR0:
+        check_nargs(SUBR_SNAME(fun), args, 0, 0);
+        break;
+    case T_SUBR1:
+        check_nargs(SUBR_SNAME(fun), args, 1, 1);
+        break;
+    case T_SUBR2:
+        check_nargs(SUBR_SNAME(fun), args, 2, 2);
+        break;
+    case T_SUBR3:
+        check_nargs(SUBR_SNAME(fun), args, 3, 3);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Unboxed numbers
+
+   A number computed by an inlined primitive for an enclosing one is
+   kept in a struct number rather than in a cell.  Anything else,
+   including a bignum, is kept as it is and goes to the subr, which
+   also does the arithmetic when a fixnum result overflows. */
+
+enum { NUM_FIXNUM, NUM_FLONUM, NUM_OTHER };
+
+struct number {
+    int kind;
+    int i;              /* NUM_FIXNUM */
+    double d;           /* NUM_FLONUM */
+    SCM x;              /* NUM_OTHER */
+};
+
+static void unbox_number(SCM x, struct number *n) {
+    if (IS_FIXNUM(x)) {
+        n->kind = NUM_FIXNUM;
+        n->i = FIXNUM(x);
+    }
+    else if (IS_FLONUM(x)) {
+        n->kind = NUM_FLONUM;
+        n->d = FLONUM(x);
+    }
+    else {
+        n->kind = NUM_OTHER;
+        n->x = x;
+    }
+}
+
+static SCM box_number(struct number *n) {
+    switch (n->kind) {
+    case NUM_FIXNUM:
+        return MK_FIXNUM(n->i);
+    case NUM_FLONUM:
+        return mk_flonum(n->d);
+    default:
+        return n->x;
+    }
+}
+
+static void apply_number_op(SCM fun, SCM args, SCM env, struct number *n);
+
+static void eval_number(SCM e, SCM env, struct number *n) {
+    SCM fun;
+    int op;
+
+    if (IS_FLONUM(e)) {
+        n->kind = NUM_FLONUM;
+        n->d = FLONUM(e);
+        return;
+    }
+    if (IS_PAIR(e) && (fun = cached_callee(e)) != NULL &&
+        ((op = INLINE_OP(fun)) == OP_PLUS || op == OP_MINUS ||
+         op == OP_TIMES)) {
+        stat_call_cache_hits++;
+        stat_inline_calls++;
+        apply_number_op(fun, CDR(e), env, n);
+        return;
+    }
+    unbox_number(EVAL_ARG(e, env), n);
+}
+
+/* Runs the inlined arithmetic or comparison FUN into *N */
+static void apply_number_op(SCM fun, SCM args, SCM env, struct number *n) {
+    struct number a, b;
+    double x, y;
+    bool c;
+
+    eval_number(FIRST(args), env, &a);
+    eval_number(SECOND(args), env, &b);
+    if (a.kind == NUM_OTHER || b.kind == NUM_OTHER)
+        goto generic;
+    if (a.kind == NUM_FIXNUM && b.kind == NUM_FIXNUM &&
+        INLINE_OP(fun) <= OP_TIMES) {
+        long long v = INLINE_OP(fun) == OP_PLUS ? (long long)a.i + b.i :
+            INLINE_OP(fun) == OP_MINUS ? (long long)a.i - b.i :
+            (long long)a.i * b.i;
+        if (v < FIXNUM_MIN || v > FIXNUM_MAX)
+            goto generic;
+        n->kind = NUM_FIXNUM;
+        n->i = (int)v;
+        return;
+    }
+    x = a.kind == NUM_FIXNUM ? (double)a.i : a.d;
+    y = b.kind == NUM_FIXNUM ? (double)b.i : b.d;
+    n->kind = NUM_FLONUM;
+    switch (INLINE_OP(fun)) {
+    case OP_PLUS:
+        n->d = x + y;
+        return;
+    case OP_MINUS:
+        n->d = x - y;
+        return;
+    case OP_TIMES:
+        n->d = x * y;
+        return;
+    case OP_NUMEQUAL:
+        c = x == y;
+        break;
+    case OP_LESSTHAN:
+        c = x < y;
+        break;
+    case OP_LESSEQUAL:
+        c = x <= y;
+        break;
+    case OP_GREATERTHAN:
+        c = x > y;
+        break;
+    default:
+        c = x >= y;
+        break;
+    }
+    n->kind = NUM_OTHER;
+    n->x = c ? boolean_true : boolean_false;
+    return;
+
+ generic:
+    unbox_number((*(SCM (*)(SCM, SCM))SUBR_FUN(fun))
+                 (box_number(&a), box_number(&b)), n);
+}
+
+/* Runs an inlined primitive; arguments of the wrong type are left
+   to the subr itself, which signals the error, and so are fixnum
+   results that overflow, which the subr turns into bignums. */
+static SCM apply_inline(SCM fun, SCM args, SCM env) {
+    SCM x, y;
+    int op = INLINE_OP(fun), r;
+    struct number n;
+
+    stat_inline_calls++;
+    if (op >= OP_PLUS && op <= OP_GREATEREQUAL) {
+        apply_number_op(fun, args, env, &n);
+        return box_number(&n);
+    }
+    x = EVAL_ARG(FIRST(args), env);
+    switch (op) {
+    case OP_CAR:
+        if (IS_PAIR(x))
+            return CAR(x);
+        break;
+    case OP_CDR:
+        if (IS_PAIR(x))
+            return CDR(x);
+        break;
+    case OP_NULLP:
+        return IS_NULL(x) ? boolean_true : boolean_false;
+    case OP_PAIRP:
+        return IS_PAIR(x) ? boolean_true : boolean_false;
+    case OP_NOT:
+        return EQ(x, boolean_false) ? boolean_true : boolean_false;
+    case OP_ZEROP:
+        if (IS_FIXNUM(x))
+            return EQ(x, MK_FIXNUM(0)) ? boolean_true : boolean_false;
+        break;
+    case OP_ONEPLUS:
+        if (IS_FIXNUM(x) && FIXNUM_ADD(x, MK_FIXNUM(1), &r))
+            return FIXNUM_OF_BITS(r);
+        break;
+    case OP_MINUSONEPLUS:
+        if (IS_FIXNUM(x) && FIXNUM_SUB(x, MK_FIXNUM(1), &r))
+            return FIXNUM_OF_BITS(r);
+        break;
+    case OP_SYS_CAR:
+        stat_unchecked_calls++;
+        if (IS_PAIR(x))
+            return CAR(x);
+        break;
+    case OP_SYS_CDR:
+        stat_unchecked_calls++;
+        if (IS_PAIR(x))
+            return CDR(x);
+        break;
+    case OP_SYS_ZEROP:
+        stat_unchecked_calls++;
+        return EQ(x, MK_FIXNUM(0)) ? boolean_true : boolean_false;
+    case OP_SYS_ONEPLUS:
+        stat_unchecked_calls++;
+        if (IS_FIXNUM(x) && FIXNUM_ADD(x, MK_FIXNUM(1), &r))
+            return FIXNUM_OF_BITS(r);
+        break;
+    case OP_SYS_MINUSONEPLUS:
+        stat_unchecked_calls++;
+        if (IS_FIXNUM(x) && FIXNUM_SUB(x, MK_FIXNUM(1), &r))
+            return FIXNUM_OF_BITS(r);
+        break;
+    default:
+        y = EVAL_ARG(SECOND(args), env);
+        switch (op) {
+        case OP_CONS:
+            return CONS(x, y);
+        case OP_EQ:
+            return EQ(x, y) ? boolean_true : boolean_false;
+        case OP_SYS_PLUS:
+            stat_unchecked_calls++;
+            if (IS_FIXNUM(x) && IS_FIXNUM(y) && FIXNUM_ADD(x, y, &r))
+                return FIXNUM_OF_BITS(r);
+            break;
+        case OP_SYS_MINUS:
+            stat_unchecked_calls++;
+            if (IS_FIXNUM(x) && IS_FIXNUM(y) && FIXNUM_SUB(x, y, &r))
+                return FIXNUM_OF_BITS(r);
+            break;
+        case OP_SYS_TIMES:
+            stat_unchecked_calls++;
+            if (IS_FIXNUM(x) && IS_FIXNUM(y) && FIXNUM_MUL(x, y, &r))
+                return FIXNUM_OF_BITS(r);
+            break;
+        default:
+            /* the fixnum comparisons */
+            stat_unchecked_calls++;
+            if (!IS_FIXNUM(x) || !IS_FIXNUM(y))
+                break;
+            switch (op) {
+            case OP_SYS_NUMEQUAL:
+                return FIXNUM(x) == FIXNUM(y) ? boolean_true : boolean_false;
+            case OP_SYS_LESSTHAN:
+                return FIXNUM(x) < FIXNUM(y) ? boolean_true : boolean_false;
+            case OP_SYS_LESSEQUAL:
+                return FIXNUM(x) <= FIXNUM(y) ? boolean_true : boolean_false;
+            case OP_SYS_GREATERTHAN:
+                return FIXNUM(x) > FIXNUM(y) ? boolean_true : boolean_false;
+            default:
+                return FIXNUM(x) >= FIXNUM(y) ? boolean_true : boolean_false;
+            }
+        }
+        return ((*(SCM (*)(SCM, SCM))SUBR_FUN(fun))(x, y));
+    }
+    return ((*(SCM (*)(SCM))SUBR_FUN(fun))(x));
+}
+
+static bool is_procedure(SCM x) {
+    switch (TYPE(x)) {
+    case T_SUBR0:
+    case T_SUBR1:
+    case T_SUBR2:
+    case T_SUBR3:
+    case T_SUBRN:
+    case T_FSUBR:
+    case T_CLOSURE:
+    case T_RECORD_PROC:
+        return true;
+    default:
+        return false;
+    }
+}
 
 static SCM evaluate_list(SCM exps, SCM env) {
     SCM result, tmp;
     if (!IS_NULL(exps)) {
-        result = CONS(evaluate(CAR(exps), env), NIL);
+        result = CONS(eval_recursive(CAR(exps), env), NIL);
         tmp = result;
         while (true) {
             exps = CDR(exps);
             if (IS_NULL(exps))
                 break;
-            CDR(tmp) = CONS(evaluate(CAR(exps), env), NIL);
+            CDR(tmp) = CONS(eval_recursive(CAR(exps), env), NIL);
             tmp = CDR(tmp);
         }
     }
@@ -275,32 +1967,134 @@ static SCM evaluate_list(SCM exps, SCM env) {
     return result;
 }
 
+/* Calls a SUBRN that only reads its argument list.  The list is
+   built from cells in this C frame rather than from the heap; the
+   conservative stack scan of gc keeps the argument values alive. */
+static SCM apply_subrn_on_stack(SCM fun, SCM exps, SCM env) {
+    struct object cells[MAX_STACK_ARGS];
+    SCM args = NIL, l;
+    int i, n = 0;
+
+    for (l = exps; IS_PAIR(l); l = CDR(l))
+        n++;
+    if (!IS_NULL(l))
+        error0 ("invalid expression.");
+    if (n > MAX_STACK_ARGS)
+        args = evaluate_list(exps, env);
+    else if (n > 0) {
+        for (i = 0; i < n; i++) {
+            SCM cell = &cells[i];
+            GC_TAGS(cell) = (unsigned short)0;
+            SET_BOXED_TYPE(cell, T_PAIR);
+            CAR(cell) = eval_recursive(CAR(exps), env);
+            CDR(cell) = (i + 1 < n) ? &cells[i + 1] : NIL;
+            exps = CDR(exps);
+        }
+        args = &cells[0];
+    }
+    return ((*(SCM (*)(SCM))SUBR_FUN(fun))(args));
+}
+
+/* A list of the N values in VALS made of the CELLS of the caller's
+   C frame, for a SUBRN flagged FLAG_STACK_ARGS. */
+static SCM stack_list(struct object *cells, SCM *vals, int n) {
+    SCM l = NIL;
+    while (n > 0) {
+        SCM cell = &cells[--n];
+        GC_TAGS(cell) = (unsigned short)0;
+        SET_BOXED_TYPE(cell, T_PAIR);
+        CAR(cell) = vals[n];
+        CDR(cell) = l;
+        l = cell;
+    }
+    return l;
+}
+
 
 /* Environment */
 
-static SCM extend_env(SCM alist, SCM vars, SCM vals) {
-    while (!IS_NULL(vars)) {
-        if (IS_SYMBOL(vars))
-            return CONS(CONS(vars, vals), alist);
-        else if (IS_PAIR(vars)) {
-            alist = CONS(CONS(CAR(vars), CAR(vals)), alist);
-            vars = CDR(vars);
-            vals = CDR(vals);
-        }
-        else
-            error0("extend_env: invalid arg.");
+/* Binds the parameters VARS to the N values in VALS. */
+static SCM bind_values(SCM alist, SCM vars, SCM *vals, int n) {
+    int i = 0;
+    while (IS_PAIR(vars) && i < n) {
+        alist = bind(alist, CAR(vars), vals[i++]);
+        vars = CDR(vars);
     }
+    if (IS_SYMBOL(vars)) {
+        SCM rest = NIL;
+        int j;
+        for (j = n; j > i; j--)
+            rest = CONS(vals[j - 1], rest);
+        return bind(alist, vars, rest);
+    }
+    if (!(IS_PAIR(vars) || IS_NULL(vars)))
+        error0("bind_values: invalid parameter list.");
+    if (!(IS_NULL(vars) && i == n))
+        wna_error("closure", n);
     return alist;
 }
 
+/* Binds the parameters VARS to the values in the list VALS. */
+static SCM bind_list(SCM alist, SCM vars, SCM vals) {
+    int n = 0;
+    while (IS_PAIR(vars) && IS_PAIR(vals)) {
+        alist = bind(alist, CAR(vars), CAR(vals));
+        vars = CDR(vars);
+        vals = CDR(vals);
+        n++;
+    }
+    if (IS_SYMBOL(vars))
+        return bind(alist, vars, vals);
+    if (!(IS_PAIR(vars) || IS_NULL(vars)))
+        error0("bind_list: invalid parameter list.");
+    if (!(IS_NULL(vars) && IS_NULL(vals))) {
+        for (; IS_PAIR(vals); vals = CDR(vals))
+            n++;
+        wna_error("closure", n);
+    }
+    return alist;
+}
+
+/* Binds the parameters VARS to the values of the argument
+   expressions EXPS evaluated in ENV.  Each value goes directly into
+   its binding; a list is consed only for a rest parameter. */
+static SCM bind_arguments(SCM alist, SCM vars, SCM exps, SCM env) {
+    int n = 0;
+    while (IS_PAIR(vars)) {
+        if (!IS_PAIR(exps))
+            break;
+        alist = bind(alist, CAR(vars), eval_recursive(CAR(exps), env));
+        vars = CDR(vars);
+        exps = CDR(exps);
+        n++;
+    }
+    if (IS_SYMBOL(vars))
+        return bind(alist, vars, evaluate_list(exps, env));
+    if (!(IS_PAIR(vars) || IS_NULL(vars)))
+        error0("bind_arguments: invalid parameter list.");
+    if (!(IS_NULL(vars) && IS_NULL(exps))) {
+        for (; IS_PAIR(exps); exps = CDR(exps))
+            n++;
+        wna_error("closure", n);
+    }
+    return alist;
+}
+
+static SCM bind(SCM alist, SCM sym, SCM val) {
+    if (!IS_LEXICAL(sym)) {
+        SET_FLAG(sym, FLAG_LEXICAL);
+        invalidate_call_caches();
+    }
+    return CONS(CONS(sym, val), alist);
+}
+
 static SCM extend_let_env(SCM alist, SCM let_list) {
     SCM org_alist = alist;
     while (!IS_NULL(let_list)) {
         SCM first = CAR(let_list);
-        alist = CONS(CONS(CAR(first),
-                          (IS_NULL(CDR(first)) ? unbound_value :
-                           evaluate(CADR(first), org_alist))),
-                     alist);
+        alist = bind(alist, CAR(first),
+                     (IS_NULL(CDR(first)) ? unbound_value :
+                      eval_recursive(CADR(first), org_alist)));
         let_list = CDR(let_list);
     }
     return alist;
@@ -309,10 +2103,9 @@ static SCM extend_let_env(SCM alist, SCM let_list) {
 static SCM extend_let_star_env(SCM alist, SCM let_list) {
     while (!IS_NULL(let_list)) {
         SCM first = CAR(let_list);
-        alist = CONS(CONS(CAR(first),
-                          (IS_NULL(CDR(first)) ? unbound_value :
-                           evaluate(CADR(first), alist))),
-                     alist);
+        alist = bind(alist, CAR(first),
+                     (IS_NULL(CDR(first)) ? unbound_value :
+                      eval_recursive(CADR(first), alist)));
         let_list = CDR(let_list);
     }
     return alist;
@@ -321,18 +2114,37 @@ static SCM extend_let_star_env(SCM alist, SCM let_list) {
 static SCM extend_letrec_env(SCM alist, SCM let_list) {
     SCM tmp = let_list;
     while (!IS_NULL(tmp)) {
-        alist = CONS(CONS(CAAR(tmp), unbound_value), alist);
+        alist = bind(alist, CAAR(tmp), unbound_value);
         tmp = CDR(tmp);
     }
     tmp = let_list;
     while (!IS_NULL(tmp)) {
         SCM first = CAR(tmp);
-        set_symval(alist, FIRST(first), evaluate(SECOND(first), alist), 0);
+        set_symval(alist, FIRST(first),
+                   eval_recursive(SECOND(first), alist), 0);
         tmp = CDR(tmp);
     }
     return alist;
 }
 
+/* Flat closures
+
+   sys:compile turns a LAMBDA nested in a local scope into
+   (SYS:LAMBDA (var...) args . body), listing the local variables the
+   body refers to.  Such a closure gets an environment made of just
+   the binding cells of those variables.  The cells are shared with
+   the enclosing frames, so SET! on either side is seen by both; a
+   closure keeps alive only what it can reach. */
+static SCM flat_env(SCM vars, SCM alist) {
+    SCM env = NIL;
+    for (; !IS_NULL(vars); vars = CDR(vars)) {
+        SCM cell = get_symcell(alist, CAR(vars));
+        if (!IS_NULL(cell))
+            env = CONS(cell, env);
+    }
+    return env;
+}
+
 static SCM get_symcell(SCM alist, SCM sym) {
     while (!IS_NULL(alist)) {
         SCM cell = CAR(alist);
@@ -346,7 +2158,7 @@ static SCM get_symcell(SCM alist, SCM sym) {
 static SCM get_symval(SCM alist, SCM sym) {
     SCM tmp;
 
-    if (EQ((tmp = get_symcell(alist, sym)), NIL)) {
+    if (!IS_LEXICAL(sym) || EQ((tmp = get_symcell(alist, sym)), NIL)) {
         if (EQ((tmp = SYM_VALUE(sym)), unbound_value))
             error1("ERROR: unbound variable %s.\n",
                    STR_DATA(SYM_PNAME(sym)));
@@ -362,10 +2174,12 @@ static SCM get_symval(SCM alist, SCM sym) {
 
 static SCM set_symval(SCM alist, SCM sym, SCM val, int definep) {
     SCM tmp;
-    if (EQ((tmp = get_symcell(alist, sym)), NIL)) {
+    if (!IS_LEXICAL(sym) || EQ((tmp = get_symcell(alist, sym)), NIL)) {
         if (EQ((tmp = SYM_VALUE(sym)), unbound_value) && !definep)
             error1("ERROR: unbound variable %s.\n",
                    STR_DATA(SYM_PNAME(sym)));
+        if (is_procedure(tmp))
+            invalidate_call_caches();
         return SYM_VALUE(sym) = val;
     }
     else
@@ -0,0 +1,623 @@
+/*
+ * Tscheme: A Tiny Scheme Interpreter
+ * Copyright (c) 1995-2013 Takuo WATANABE (Tokyo Institute of Technology)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <setjmp.h>
+
+#include "tscheme.h"
+
+/* Persistent maps and sets
+
+   A map is a hash array mapped trie keyed with equal? and
+   equal-hash: each node takes 5 bits of the hash of a key, and has
+   an entry for each bit set in its 32-bit bitmap.  An entry is
+   either a key and its value, or a NULL key and a child, which is a
+   node or, once the hash bits are used up, an alist of the keys
+   whose hashes are the same.  A set is a map whose values are #t.
+
+   An update copies the nodes on the path to the key and shares the
+   rest with the old map.  A transient (FLAG_TRANSIENT) is a map
+   updated in place instead: the nodes it has copied belong to it,
+   as recorded by the edit token in their first slot, and are changed
+   in place by later updates; the others are copied as for a
+   persistent map.  The root of a transient always belongs to it, so
+   the token of a transient is that of its root.  PERSISTENT! turns a
+   transient into a persistent map, which no transient holds the
+   token of any more.  A persistent update of a transient could not
+   share its nodes, so it is an error. */
+
+#define HAMT_BITS  5
+#define HAMT_MASK  31
+#define HASH_BITS  32
+
+#define OWNER(n) (HAMT_SLOTS(n)[0])
+#define KEY(n,i) (HAMT_SLOTS(n)[1 + 2 * (i)])
+#define VAL(n,i) (HAMT_SLOTS(n)[2 + 2 * (i)])
+
+/* The index of the entry for BIT in a node with BITMAP */
+#define ENTRY_INDEX(bitmap, bit) __builtin_popcount((bitmap) & ((bit) - 1))
+
+static SCM *alloc_slots(long n) {
+    SCM *slots;
+    if ((slots = calloc((size_t)(1 + 2 * n), sizeof(SCM))) == NULL)
+        fatal_error("malloc: hamt node");
+    return slots;
+}
+
+/* A node with BITMAP and NULL entries, which belongs to EDIT */
+static SCM new_node(unsigned bitmap, SCM edit) {
+    SCM node = mk_hamt_node(bitmap,
+                            alloc_slots(__builtin_popcount(bitmap)));
+    OWNER(node) = edit;
+    return node;
+}
+
+static bool owned(SCM node, SCM edit) {
+    return edit != NULL && OWNER(node) == edit;
+}
+
+/* The value of KEY, whose hash is H, under NODE, or NULL */
+static SCM node_ref(SCM node, SCM key, unsigned h) {
+    int shift = 0;
+    SCM k, v, l;
+
+    for (;;) {
+        unsigned bit = 1U << ((h >> shift) & HAMT_MASK);
+        int i;
+        if ((HAMT_BITMAP(node) & bit) == 0)
+            return NULL;
+        i = ENTRY_INDEX(HAMT_BITMAP(node), bit);
+        k = KEY(node, i);
+        v = VAL(node, i);
+        if (k != NULL)
+            return equal(k, key) ? v : NULL;
+        if (!IS_HAMT_NODE(v))
+            break;
+        node = v;
+        shift += HAMT_BITS;
+    }
+    for (l = v; IS_PAIR(l); l = CDR(l))
+        if (equal(CAAR(l), key))
+            return CDAR(l);
+    return NULL;
+}
+
+/* NODE with entry I set to K and V, in place if it belongs to EDIT */
+static SCM node_replace(SCM node, int i, SCM k, SCM v, SCM edit) {
+    SCM copy;
+
+    if (owned(node, edit)) {
+        KEY(node, i) = k;
+        VAL(node, i) = v;
+        return node;
+    }
+    copy = new_node(HAMT_BITMAP(node), edit);
+    memcpy(HAMT_SLOTS(copy) + 1, HAMT_SLOTS(node) + 1,
+           2 * HAMT_COUNT(node) * sizeof(SCM));
+    KEY(copy, i) = k;
+    VAL(copy, i) = v;
+    return copy;
+}
+
+/* NODE with a new entry K, V for BIT, whose index is I */
+static SCM node_insert(SCM node, unsigned bit, int i, SCM k, SCM v,
+                       SCM edit) {
+    int n = HAMT_COUNT(node);
+    SCM copy;
+
+    if (owned(node, edit)) {
+        SCM *slots = realloc(HAMT_SLOTS(node),
+                             (1 + 2 * (n + 1)) * sizeof(SCM));
+        if (slots == NULL)
+            fatal_error("malloc: hamt node");
+        memmove(slots + 1 + 2 * (i + 1), slots + 1 + 2 * i,
+                2 * (n - i) * sizeof(SCM));
+        HAMT_SLOTS(node) = slots;
+        HAMT_BITMAP(node) |= bit;
+        KEY(node, i) = k;
+        VAL(node, i) = v;
+        return node;
+    }
+    copy = new_node(HAMT_BITMAP(node) | bit, edit);
+    memcpy(HAMT_SLOTS(copy) + 1, HAMT_SLOTS(node) + 1,
+           2 * i * sizeof(SCM));
+    memcpy(HAMT_SLOTS(copy) + 1 + 2 * (i + 1), HAMT_SLOTS(node) + 1 + 2 * i,
+           2 * (n - i) * sizeof(SCM));
+    KEY(copy, i) = k;
+    VAL(copy, i) = v;
+    return copy;
+}
+
+/* NODE without the entry for BIT, whose index is I, or NULL if it
+   was the only one */
+static SCM node_remove(SCM node, unsigned bit, int i, SCM edit) {
+    int n = HAMT_COUNT(node);
+    SCM copy;
+
+    if (n == 1)
+        return NULL;
+    if (owned(node, edit)) {
+        memmove(HAMT_SLOTS(node) + 1 + 2 * i,
+                HAMT_SLOTS(node) + 1 + 2 * (i + 1),
+                2 * (n - i - 1) * sizeof(SCM));
+        HAMT_BITMAP(node) &= ~bit;
+        return node;
+    }
+    copy = new_node(HAMT_BITMAP(node) & ~bit, edit);
+    memcpy(HAMT_SLOTS(copy) + 1, HAMT_SLOTS(node) + 1,
+           2 * i * sizeof(SCM));
+    memcpy(HAMT_SLOTS(copy) + 1 + 2 * i, HAMT_SLOTS(node) + 1 + 2 * (i + 1),
+           2 * (n - i - 1) * sizeof(SCM));
+    return copy;
+}
+
+/* A child at SHIFT holding the two keys K1 and K2 */
+static SCM merge_entries(SCM k1, SCM v1, unsigned h1, SCM k2, SCM v2,
+                         unsigned h2, int shift, SCM edit) {
+    unsigned i1, i2;
+    SCM node;
+
+    if (shift >= HASH_BITS)
+        return CONS(CONS(k1, v1), CONS(CONS(k2, v2), NIL));
+    i1 = (h1 >> shift) & HAMT_MASK;
+    i2 = (h2 >> shift) & HAMT_MASK;
+    if (i1 == i2) {
+        SCM child = merge_entries(k1, v1, h1, k2, v2, h2,
+                                  shift + HAMT_BITS, edit);
+        node = new_node(1U << i1, edit);
+        VAL(node, 0) = child;
+        return node;
+    }
+    node = new_node((1U << i1) | (1U << i2), edit);
+    KEY(node, i1 > i2) = k1;
+    VAL(node, i1 > i2) = v1;
+    KEY(node, i1 < i2) = k2;
+    VAL(node, i1 < i2) = v2;
+    return node;
+}
+
+/* The alist BUCKET with KEY set to VALUE */
+static SCM bucket_set(SCM bucket, SCM key, SCM value, bool *added) {
+    SCM l;
+
+    for (l = bucket; IS_PAIR(l); l = CDR(l))
+        if (equal(CAAR(l), key)) {
+            if (EQ(CDAR(l), value))
+                return bucket;
+            break;
+        }
+    if (IS_PAIR(l)) {
+        SCM rest = CDR(l), head = NIL, p;
+        for (p = bucket; NEQ(p, l); p = CDR(p))
+            head = CONS(CAR(p), head);
+        for (l = CONS(CONS(key, value), rest); IS_PAIR(head);
+             head = CDR(head))
+            l = CONS(CAR(head), l);
+        return l;
+    }
+    *added = true;
+    return CONS(CONS(key, value), bucket);
+}
+
+/* The alist BUCKET without KEY */
+static SCM bucket_delete(SCM bucket, SCM key, bool *removed) {
+    if (!IS_PAIR(bucket))
+        return bucket;
+    if (equal(CAAR(bucket), key)) {
+        *removed = true;
+        return CDR(bucket);
+    }
+    {
+        SCM rest = bucket_delete(CDR(bucket), key, removed);
+        return EQ(rest, CDR(bucket)) ? bucket : CONS(CAR(bucket), rest);
+    }
+}
+
+/* NODE at SHIFT with KEY, whose hash is H, set to VALUE */
+static SCM node_set(SCM node, SCM key, unsigned h, SCM value, int shift,
+                    SCM edit, bool *added) {
+    unsigned bit = 1U << ((h >> shift) & HAMT_MASK);
+    int i = ENTRY_INDEX(HAMT_BITMAP(node), bit);
+    SCM k, v, child;
+
+    if ((HAMT_BITMAP(node) & bit) == 0) {
+        *added = true;
+        return node_insert(node, bit, i, key, value, edit);
+    }
+    k = KEY(node, i);
+    v = VAL(node, i);
+    if (k == NULL) {
+        child = IS_HAMT_NODE(v) ?
+            node_set(v, key, h, value, shift + HAMT_BITS, edit, added) :
+            bucket_set(v, key, value, added);
+        return EQ(child, v) ? node : node_replace(node, i, NULL, child, edit);
+    }
+    if (equal(k, key))
+        return EQ(v, value) ? node : node_replace(node, i, k, value, edit);
+    *added = true;
+    child = merge_entries(k, v, equal_hash_value(k), key, value, h,
+                          shift + HAMT_BITS, edit);
+    return node_replace(node, i, NULL, child, edit);
+}
+
+/* NODE at SHIFT without KEY, or NULL if it has no entry left.  A
+   child left with a single key is replaced by the key. */
+static SCM node_delete(SCM node, SCM key, unsigned h, int shift, SCM edit,
+                       bool *removed) {
+    unsigned bit = 1U << ((h >> shift) & HAMT_MASK);
+    int i = ENTRY_INDEX(HAMT_BITMAP(node), bit);
+    SCM k, v, child;
+
+    if ((HAMT_BITMAP(node) & bit) == 0)
+        return node;
+    k = KEY(node, i);
+    v = VAL(node, i);
+    if (k != NULL) {
+        if (!equal(k, key))
+            return node;
+        *removed = true;
+        return node_remove(node, bit, i, edit);
+    }
+    if (IS_HAMT_NODE(v)) {
+        child = node_delete(v, key, h, shift + HAMT_BITS, edit, removed);
+        if (EQ(child, v))
+            return node;
+        if (child == NULL)
+            return node_remove(node, bit, i, edit);
+        if (HAMT_COUNT(child) == 1 && KEY(child, 0) != NULL)
+            return node_replace(node, i, KEY(child, 0), VAL(child, 0), edit);
+        return node_replace(node, i, NULL, child, edit);
+    }
+    child = bucket_delete(v, key, removed);
+    if (EQ(child, v))
+        return node;
+    if (IS_NULL(CDR(child)))
+        return node_replace(node, i, CAAR(child), CDAR(child), edit);
+    return node_replace(node, i, NULL, child, edit);
+}
+
+/* Calls F with each key and value under NODE and ARG */
+static void node_for_each(SCM node, void (*f)(SCM, SCM, SCM *), SCM *arg) {
+    int i, n = HAMT_COUNT(node);
+    SCM l;
+
+    for (i = 0; i < n; i++) {
+        SCM k = KEY(node, i), v = VAL(node, i);
+        if (k != NULL)
+            f(k, v, arg);
+        else if (IS_HAMT_NODE(v))
+            node_for_each(v, f, arg);
+        else
+            for (l = v; IS_PAIR(l); l = CDR(l))
+                f(CAAR(l), CDAR(l), arg);
+    }
+}
+
+/* Map and set objects */
+
+static SCM empty_root(SCM edit) {
+    return new_node(0, edit);
+}
+
+/* M, argument ARGNO of FNAME, checked to be of TYPE, and persistent
+   if PERSISTENTP */
+static SCM map_arg(char *fname, int type, SCM m, int argno,
+                   bool persistentp) {
+    if (!IS_TYPE(m, type) ||
+        (persistentp && HAS_FLAG(m, FLAG_TRANSIENT)))
+        wta_error(fname, argno);
+    return m;
+}
+
+/* The map M with KEY set to VALUE; a transient M is updated */
+static SCM map_set(SCM m, SCM key, SCM value) {
+    bool added = false;
+    SCM edit = HAS_FLAG(m, FLAG_TRANSIENT) ? OWNER(MAP_ROOT(m)) : NULL;
+    SCM root = node_set(MAP_ROOT(m), key, equal_hash_value(key), value, 0,
+                        edit, &added);
+
+    if (edit != NULL) {
+        MAP_ROOT(m) = root;
+        MAP_COUNT(m) += added;
+        return m;
+    }
+    if (EQ(root, MAP_ROOT(m)))
+        return m;
+    return mk_map(TYPE(m), MAP_COUNT(m) + added, root);
+}
+
+/* The map M without KEY; a transient M is updated */
+static SCM map_delete(SCM m, SCM key) {
+    bool removed = false;
+    SCM edit = HAS_FLAG(m, FLAG_TRANSIENT) ? OWNER(MAP_ROOT(m)) : NULL;
+    SCM root = node_delete(MAP_ROOT(m), key, equal_hash_value(key), 0,
+                           edit, &removed);
+
+    if (root == NULL)
+        root = empty_root(edit);
+    if (edit != NULL) {
+        MAP_ROOT(m) = root;
+        MAP_COUNT(m) -= removed;
+        return m;
+    }
+    if (EQ(root, MAP_ROOT(m)))
+        return m;
+    return mk_map(TYPE(m), MAP_COUNT(m) - removed, root);
+}
+
+static SCM map_ref(SCM m, SCM key) {
+    return node_ref(MAP_ROOT(m), key, equal_hash_value(key));
+}
+
+/* A new transient with the contents of M, of TYPE */
+static SCM transient_of(int type, SCM m) {
+    SCM root, t;
+
+    if (m == NULL)
+        root = empty_root(CONS(NIL, NIL));
+    else {
+        root = new_node(HAMT_BITMAP(MAP_ROOT(m)), CONS(NIL, NIL));
+        memcpy(HAMT_SLOTS(root) + 1, HAMT_SLOTS(MAP_ROOT(m)) + 1,
+               2 * HAMT_COUNT(root) * sizeof(SCM));
+    }
+    t = mk_map(type, m == NULL ? 0 : MAP_COUNT(m), root);
+    SET_FLAG(t, FLAG_TRANSIENT);
+    return t;
+}
+
+static void push_key(SCM k, SCM v, SCM *l) {
+    *l = CONS(k, *l);
+}
+
+static void push_value(SCM k, SCM v, SCM *l) {
+    *l = CONS(v, *l);
+}
+
+static void push_pair(SCM k, SCM v, SCM *l) {
+    *l = CONS(CONS(k, v), *l);
+}
+
+static SCM map_to_list(SCM m, void (*push)(SCM, SCM, SCM *)) {
+    SCM l = NIL;
+    node_for_each(MAP_ROOT(m), push, &l);
+    return l;
+}
+
+/* MAP? x */
+SCM s_mapp(SCM x) {
+    return IS_MAP(x) ? boolean_true : boolean_false;
+}
+
+/* MAKE-MAP */
+SCM s_make_map(void) {
+    return mk_map(T_MAP, 0, empty_root(NULL));
+}
+
+/* MAP-COUNT map */
+SCM s_map_count(SCM m) {
+    return MK_FIXNUM(MAP_COUNT(map_arg("map-count", T_MAP, m, 1, false)));
+}
+
+/* MAP-REF map key [default] -- DEFAULT is #f if omitted */
+SCM s_map_ref(SCM args) {
+    int n = check_nargs("map-ref", args, 2, 3);
+    SCM v = map_ref(map_arg("map-ref", T_MAP, FIRST(args), 1, false),
+                    SECOND(args));
+    if (v != NULL)
+        return v;
+    return n == 3 ? THIRD(args) : boolean_false;
+}
+
+/* MAP-CONTAINS? map key */
+SCM s_map_contains(SCM m, SCM key) {
+    return map_ref(map_arg("map-contains?", T_MAP, m, 1, false), key)
+        != NULL ? boolean_true : boolean_false;
+}
+
+/* MAP-SET map key value */
+SCM s_map_set(SCM m, SCM key, SCM value) {
+    return map_set(map_arg("map-set", T_MAP, m, 1, true), key, value);
+}
+
+/* MAP-DELETE map key */
+SCM s_map_delete(SCM m, SCM key) {
+    return map_delete(map_arg("map-delete", T_MAP, m, 1, true), key);
+}
+
+/* MAP-KEYS map */
+SCM s_map_keys(SCM m) {
+    return map_to_list(map_arg("map-keys", T_MAP, m, 1, false), push_key);
+}
+
+/* MAP-VALUES map */
+SCM s_map_values(SCM m) {
+    return map_to_list(map_arg("map-values", T_MAP, m, 1, false),
+                       push_value);
+}
+
+/* MAP->ALIST map */
+SCM s_map_to_alist(SCM m) {
+    return map_to_list(map_arg("map->alist", T_MAP, m, 1, false),
+                       push_pair);
+}
+
+/* ALIST->MAP alist -- the first of duplicate keys wins */
+SCM s_alist_to_map(SCM alist) {
+    SCM t = transient_of(T_MAP, NULL), l;
+
+    for (l = alist; IS_PAIR(l); l = CDR(l)) {
+        if (!IS_PAIR(CAR(l)))
+            wta_error("alist->map", 1);
+        if (map_ref(t, CAAR(l)) == NULL)
+            map_set(t, CAAR(l), CDAR(l));
+    }
+    if (!IS_NULL(l))
+        wta_error("alist->map", 1);
+    CLEAR_FLAG(t, FLAG_TRANSIENT);
+    return t;
+}
+
+static void call_with_entry(SCM k, SCM v, SCM *proc) {
+    apply_procedure(*proc, CONS(k, CONS(v, NIL)));
+}
+
+static void call_with_key(SCM k, SCM v, SCM *proc) {
+    apply_procedure(*proc, CONS(k, NIL));
+}
+
+/* MAP-FOR-EACH proc map -- PROC is called with each key and value */
+SCM s_map_for_each(SCM proc, SCM m) {
+    node_for_each(MAP_ROOT(map_arg("map-for-each", T_MAP, m, 2, false)),
+                  call_with_entry, &proc);
+    return unspecified_value;
+}
+
+/* SET? x */
+SCM s_setp(SCM x) {
+    return IS_SET(x) ? boolean_true : boolean_false;
+}
+
+/* MAKE-SET */
+SCM s_make_set(void) {
+    return mk_map(T_SET, 0, empty_root(NULL));
+}
+
+/* SET-COUNT set */
+SCM s_set_count(SCM s) {
+    return MK_FIXNUM(MAP_COUNT(map_arg("set-count", T_SET, s, 1, false)));
+}
+
+/* SET-CONTAINS? set x */
+SCM s_set_contains(SCM s, SCM x) {
+    return map_ref(map_arg("set-contains?", T_SET, s, 1, false), x)
+        != NULL ? boolean_true : boolean_false;
+}
+
+/* SET-ADD set x */
+SCM s_set_add(SCM s, SCM x) {
+    return map_set(map_arg("set-add", T_SET, s, 1, true), x, boolean_true);
+}
+
+/* SET-DELETE set x */
+SCM s_set_delete(SCM s, SCM x) {
+    return map_delete(map_arg("set-delete", T_SET, s, 1, true), x);
+}
+
+/* SET->LIST set */
+SCM s_set_to_list(SCM s) {
+    return map_to_list(map_arg("set->list", T_SET, s, 1, false), push_key);
+}
+
+/* LIST->SET list */
+SCM s_list_to_set(SCM list) {
+    SCM t = transient_of(T_SET, NULL), l;
+
+    for (l = list; IS_PAIR(l); l = CDR(l))
+        map_set(t, CAR(l), boolean_true);
+    if (!IS_NULL(l))
+        wta_error("list->set", 1);
+    CLEAR_FLAG(t, FLAG_TRANSIENT);
+    return t;
+}
+
+/* SET-FOR-EACH proc set */
+SCM s_set_for_each(SCM proc, SCM s) {
+    node_for_each(MAP_ROOT(map_arg("set-for-each", T_SET, s, 2, false)),
+                  call_with_key, &proc);
+    return unspecified_value;
+}
+
+/* Transients */
+
+/* The transient M of FNAME, which is argument 1 */
+static SCM transient_arg(char *fname, SCM m) {
+    if ((!IS_MAP(m) && !IS_SET(m)) || !HAS_FLAG(m, FLAG_TRANSIENT))
+        wta_error(fname, 1);
+    return m;
+}
+
+/* TRANSIENT map-or-set -- a transient copy of it */
+SCM s_transient(SCM m) {
+    if ((!IS_MAP(m) && !IS_SET(m)) || HAS_FLAG(m, FLAG_TRANSIENT))
+        wta_error("transient", 1);
+    return transient_of(TYPE(m), m);
+}
+
+/* TRANSIENT-SET! transient-map key value */
+SCM s_transient_set(SCM t, SCM key, SCM value) {
+    if (!IS_MAP(transient_arg("transient-set!", t)))
+        wta_error("transient-set!", 1);
+    return map_set(t, key, value);
+}
+
+/* TRANSIENT-ADD! transient-set x */
+SCM s_transient_add(SCM t, SCM x) {
+    if (!IS_SET(transient_arg("transient-add!", t)))
+        wta_error("transient-add!", 1);
+    return map_set(t, x, boolean_true);
+}
+
+/* TRANSIENT-DELETE! transient key */
+SCM s_transient_delete(SCM t, SCM key) {
+    return map_delete(transient_arg("transient-delete!", t), key);
+}
+
+/* PERSISTENT! transient -- makes it persistent and returns it */
+SCM s_persistent(SCM t) {
+    CLEAR_FLAG(transient_arg("persistent!", t), FLAG_TRANSIENT);
+    return t;
+}
+
+void init_hamt_subrs(void) {
+    mk_subr("MAP?", (SCM (*)(void))s_mapp, 1);
+    mk_subr("MAKE-MAP", (SCM (*)(void))s_make_map, 0);
+    mk_subr("MAP-COUNT", (SCM (*)(void))s_map_count, 1);
+    SET_FLAG(mk_subr("MAP-REF", (SCM (*)(void))s_map_ref, -1),
+             FLAG_STACK_ARGS);
+    mk_subr("MAP-CONTAINS?", (SCM (*)(void))s_map_contains, 2);
+    mk_subr("MAP-SET", (SCM (*)(void))s_map_set, 3);
+    mk_subr("MAP-DELETE", (SCM (*)(void))s_map_delete, 2);
+    mk_subr("MAP-KEYS", (SCM (*)(void))s_map_keys, 1);
+    mk_subr("MAP-VALUES", (SCM (*)(void))s_map_values, 1);
+    mk_subr("MAP->ALIST", (SCM (*)(void))s_map_to_alist, 1);
+    mk_subr("ALIST->MAP", (SCM (*)(void))s_alist_to_map, 1);
+    mk_subr("MAP-FOR-EACH", (SCM (*)(void))s_map_for_each, 2);
+    mk_subr("SET?", (SCM (*)(void))s_setp, 1);
+    mk_subr("MAKE-SET", (SCM (*)(void))s_make_set, 0);
+    mk_subr("SET-COUNT", (SCM (*)(void))s_set_count, 1);
+    mk_subr("SET-CONTAINS?", (SCM (*)(void))s_set_contains, 2);
+    mk_subr("SET-ADD", (SCM (*)(void))s_set_add, 2);
+    mk_subr("SET-DELETE", (SCM (*)(void))s_set_delete, 2);
+    mk_subr("SET->LIST", (SCM (*)(void))s_set_to_list, 1);
+    mk_subr("LIST->SET", (SCM (*)(void))s_list_to_set, 1);
+    mk_subr("SET-FOR-EACH", (SCM (*)(void))s_set_for_each, 2);
+    mk_subr("TRANSIENT", (SCM (*)(void))s_transient, 1);
+    mk_subr("TRANSIENT-SET!", (SCM (*)(void))s_transient_set, 3);
+    mk_subr("TRANSIENT-ADD!", (SCM (*)(void))s_transient_add, 2);
+    mk_subr("TRANSIENT-DELETE!", (SCM (*)(void))s_transient_delete, 2);
+    mk_subr("PERSISTENT!", (SCM (*)(void))s_persistent, 1);
+}
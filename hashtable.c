@@ -0,0 +1,631 @@
+/*
+ * Tscheme: A Tiny Scheme Interpreter
+ * Copyright (c) 1995-2013 Takuo WATANABE (Tokyo Institute of Technology)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <setjmp.h>
+
+#include "tscheme.h"
+
+/* Hash tables
+
+   A hash table is open addressed with linear probing.  Its slots
+   are a malloc'ed array of a power of two entries, each keeping the
+   hash of its key, so that neither a lookup nor a resize recomputes
+   hashes of the keys in the table.  A deleted entry stays as a
+   tombstone until the next resize, which happens when live and
+   deleted entries would fill three quarters of the table and leaves
+   it at most half full.
+
+   The kind of a table decides how keys are compared and hashed:
+   with eq?, eqv?, equal?, or as strings, or else with the equality
+   and hash procedures given to MAKE-HASH-TABLE.  eq? hashing uses
+   the address of the object, which is stable since gc never moves a
+   cell; a moving collector would have to rehash eq and eqv tables.
+
+   Only a table of the general kind runs Scheme code during a lookup;
+   the effect of that code changing the table itself is undefined,
+   as is that of a procedure given to HASH-TABLE-WALK, but neither
+   can make the table inconsistent. */
+
+enum { HT_EQ, HT_EQV, HT_EQUAL, HT_STRING, HT_GENERAL };
+
+#define HT_MIN_SIZE 8
+#define EQUAL_HASH_BUDGET 32
+
+static unsigned hash_mix(unsigned h) {
+    h ^= h >> 16;
+    h *= 0x45d9f3bU;
+    h ^= h >> 16;
+    return h;
+}
+
+/* FNV-1a over the N bytes at P, continuing from H */
+static unsigned hash_bytes(const void *p, long n, unsigned h) {
+    const unsigned char *s = p;
+    while (n-- > 0)
+        h = (h ^ *s++) * 16777619U;
+    return h;
+}
+
+#define FNV_BASIS 2166136261U
+
+static unsigned eq_hash(SCM x) {
+    return hash_mix((unsigned)(unsigned long)x);
+}
+
+/* The hash of the string S, cached in its body */
+static unsigned string_hash(SCM s) {
+    if (STR_HASH(s) == 0)
+        STR_HASH(s) = hash_mix(hash_bytes(STR_DATA(s), STR_DIM(s),
+                                          FNV_BASIS));
+    return STR_HASH(s);
+}
+
+static unsigned eqv_hash(SCM x) {
+    if (IS_CHARACTER(x))
+        return hash_mix((unsigned)CHARACTER(x) ^ FNV_BASIS);
+    if (IS_FLONUM(x))
+        return hash_mix(hash_bytes(&FLONUM(x), sizeof(double), FNV_BASIS));
+    if (IS_BIGNUM(x))
+        return hash_mix(hash_bytes(BIG_DIGITS(x),
+                                   (BIG_SIZE(x) < 0 ? -BIG_SIZE(x) :
+                                    BIG_SIZE(x)) * sizeof(unsigned),
+                                   FNV_BASIS ^ (BIG_SIZE(x) < 0)));
+    return eq_hash(x);
+}
+
+/* The hash of X consistent with equal?.  *BUDGET bounds the number
+   of pairs and vector elements looked at, so that hashing a long or
+   circular structure takes constant time. */
+static unsigned equal_hash(SCM x, int *budget) {
+    unsigned h = FNV_BASIS;
+    long i;
+
+    for (; IS_PAIR(x) && *budget > 0; x = CDR(x)) {
+        (*budget)--;
+        h = (h ^ equal_hash(CAR(x), budget)) * 16777619U;
+    }
+    if (IS_PAIR(x))
+        return h;
+    if (IS_STRING(x))
+        return h ^ string_hash(x);
+    if (IS_VECTOR(x)) {
+        for (i = 0; i < VECTOR_DIM(x) && *budget > 0; i++) {
+            (*budget)--;
+            h = (h ^ equal_hash(VECTOR_DATA(x)[i], budget)) * 16777619U;
+        }
+        return hash_mix(h ^ (unsigned)VECTOR_DIM(x));
+    }
+    if (IS_BYTEVECTOR(x) || IS_S32VECTOR(x))
+        return hash_mix(hash_bytes(NUMVEC_DATA(x),
+                                   NUMVEC_DIM(x) *
+                                   (IS_BYTEVECTOR(x) ? 1 : sizeof(int)),
+                                   h));
+    return hash_mix(h ^ eqv_hash(x));
+}
+
+/* The hash of X consistent with equal?, also used by hamt.c */
+unsigned equal_hash_value(SCM x) {
+    int budget = EQUAL_HASH_BUDGET;
+    return equal_hash(x, &budget);
+}
+
+/* The hash of KEY for table T */
+static unsigned key_hash(struct hashtable *t, SCM key) {
+    int budget = EQUAL_HASH_BUDGET;
+    long long n;
+
+    switch (t->kind) {
+    case HT_EQ:
+        return eq_hash(key);
+    case HT_EQV:
+        return eqv_hash(key);
+    case HT_EQUAL:
+        return equal_hash(key, &budget);
+    case HT_STRING:
+        return string_hash(key);
+    default:
+        if (!integer_value(apply_procedure(t->hash, CONS(key, NIL)), &n))
+            error1("ERROR: %s: Hash is not an integer.\n", "hash-table");
+        return hash_mix((unsigned)n);
+    }
+}
+
+static bool same_key(struct hashtable *t, SCM x, SCM y) {
+    if (EQ(x, y))
+        return true;
+    switch (t->kind) {
+    case HT_EQ:
+        return false;
+    case HT_EQV:
+        return eqv(x, y);
+    case HT_EQUAL:
+        return equal(x, y);
+    case HT_STRING:
+        return string_equal(x, y);
+    default:
+        return NEQ(apply_procedure(t->equiv, CONS(x, CONS(y, NIL))),
+                   boolean_false);
+    }
+}
+
+static struct hash_entry *alloc_entries(long size) {
+    struct hash_entry *e;
+    if ((e = calloc((size_t)size, sizeof(struct hash_entry))) == NULL)
+        fatal_error("malloc: hash table");
+    return e;
+}
+
+/* The smallest table size that holds N entries at most half full */
+static long table_size(long n) {
+    long size = HT_MIN_SIZE;
+    while (size < 2 * n)
+        size *= 2;
+    return size;
+}
+
+static SCM new_table(int kind, long n, SCM equiv, SCM hash) {
+    struct hashtable *t;
+    if ((t = malloc(sizeof(struct hashtable))) == NULL)
+        fatal_error("malloc: hash table");
+    t->kind = kind;
+    t->size = table_size(n);
+    t->count = t->used = 0;
+    t->entries = alloc_entries(t->size);
+    t->equiv = equiv;
+    t->hash = hash;
+    return mk_hashtable(t);
+}
+
+/* The index of the entry of KEY, whose hash is H, in T, or -1 */
+static long find_entry(struct hashtable *t, SCM key, unsigned h) {
+    long i;
+
+    for (i = h & (t->size - 1); ; i = (i + 1) & (t->size - 1)) {
+        struct hash_entry *e = &t->entries[i];
+        if (e->key == NULL) {
+            if (e->value == NULL)
+                return -1;
+        }
+        else if (e->hash == h && same_key(t, e->key, key))
+            return i;
+    }
+}
+
+/* Moves the live entries of T into a new array of SIZE slots */
+static void rehash(struct hashtable *t, long size) {
+    struct hash_entry *old = t->entries;
+    long n = t->size, i, j;
+
+    t->entries = alloc_entries(size);
+    t->size = size;
+    for (i = 0; i < n; i++) {
+        if (old[i].key == NULL)
+            continue;
+        for (j = old[i].hash & (size - 1); t->entries[j].key != NULL;
+             j = (j + 1) & (size - 1))
+            ;
+        t->entries[j] = old[i];
+    }
+    t->used = t->count;
+    free(old);
+}
+
+/* Stores VALUE under KEY, whose hash is H, in T */
+static void put_entry(struct hashtable *t, SCM key, unsigned h, SCM value) {
+    long i = find_entry(t, key, h);
+    struct hash_entry *e;
+
+    if (i >= 0) {
+        t->entries[i].value = value;
+        return;
+    }
+    if ((t->used + 1) * 4 > t->size * 3)
+        rehash(t, table_size(t->count + 1));
+    for (i = h & (t->size - 1); t->entries[i].key != NULL;
+         i = (i + 1) & (t->size - 1))
+        ;
+    e = &t->entries[i];
+    if (e->value == NULL)
+        t->used++;
+    t->count++;
+    e->key = key;
+    e->value = value;
+    e->hash = h;
+}
+
+static struct hashtable *table_arg(char *fname, SCM x, int argno) {
+    if (!IS_HASHTABLE(x))
+        wta_error(fname, argno);
+    return HASHTABLE(x);
+}
+
+/* The hash of KEY in T, checking that it is a string for a string
+   table */
+static unsigned table_key_hash(char *fname, struct hashtable *t, SCM key) {
+    if (t->kind == HT_STRING && !IS_STRING(key))
+        wta_error(fname, 2);
+    return key_hash(t, key);
+}
+
+/* The index of the entry of KEY in TABLE, argument 1 of FNAME, or -1 */
+static long lookup(char *fname, SCM table, SCM key) {
+    struct hashtable *t = table_arg(fname, table, 1);
+    return find_entry(t, key, table_key_hash(fname, t, key));
+}
+
+static void set_entry(char *fname, SCM table, SCM key, SCM value) {
+    struct hashtable *t = table_arg(fname, table, 1);
+    put_entry(t, key, table_key_hash(fname, t, key), value);
+}
+
+/* The kind of a table whose keys are compared with EQUIV */
+static int table_kind(SCM equiv) {
+    if (EQ(equiv, SYM_VALUE(mk_symbol("EQ?"))))
+        return HT_EQ;
+    if (EQ(equiv, SYM_VALUE(mk_symbol("EQV?"))))
+        return HT_EQV;
+    if (EQ(equiv, SYM_VALUE(mk_symbol("EQUAL?"))))
+        return HT_EQUAL;
+    if (EQ(equiv, SYM_VALUE(mk_symbol("STRING=?"))))
+        return HT_STRING;
+    return HT_GENERAL;
+}
+
+/* A new table for ARGS = ([equiv [hash]]) of FNAME, the first of
+   which is argument ARGNO, sized for N entries */
+static SCM make_table(char *fname, SCM args, int argno, long n) {
+    SCM equiv, hash = NULL;
+    int kind;
+
+    if (!IS_PAIR(args))
+        return new_table(HT_EQUAL, n, NULL, NULL);
+    equiv = CAR(args);
+    if (IS_PAIR(CDR(args)))
+        hash = SECOND(args);
+    kind = table_kind(equiv);
+    if (kind == HT_GENERAL && hash == NULL)
+        wna_error(fname, argno);
+    if (kind != HT_GENERAL)
+        hash = NULL;
+    return new_table(kind, n, kind == HT_GENERAL ? equiv : NULL, hash);
+}
+
+static long size_arg(char *fname, SCM x, int argno) {
+    if (!IS_FIXNUM(x) || FIXNUM(x) < 0)
+        wta_error(fname, argno);
+    return FIXNUM(x);
+}
+
+/* HASH-TABLE? x */
+SCM s_hash_tablep(SCM x) {
+    return IS_HASHTABLE(x) ? boolean_true : boolean_false;
+}
+
+/* MAKE-HASH-TABLE [equiv [hash [k]]] -- equal? by default */
+SCM s_make_hash_table(SCM args) {
+    int n = check_nargs("make-hash-table", args, 0, 3);
+    return make_table("make-hash-table", args, 1,
+                      n == 3 ? size_arg("make-hash-table", THIRD(args), 3)
+                      : 0);
+}
+
+static SCM make_kind_table(char *fname, int kind, SCM args) {
+    int n = check_nargs(fname, args, 0, 1);
+    return new_table(kind, n == 1 ? size_arg(fname, CAR(args), 1) : 0,
+                     NULL, NULL);
+}
+
+/* MAKE-EQ-HASH-TABLE [k] */
+SCM s_make_eq_hash_table(SCM args) {
+    return make_kind_table("make-eq-hash-table", HT_EQ, args);
+}
+
+/* MAKE-EQV-HASH-TABLE [k] */
+SCM s_make_eqv_hash_table(SCM args) {
+    return make_kind_table("make-eqv-hash-table", HT_EQV, args);
+}
+
+/* MAKE-EQUAL-HASH-TABLE [k] */
+SCM s_make_equal_hash_table(SCM args) {
+    return make_kind_table("make-equal-hash-table", HT_EQUAL, args);
+}
+
+/* MAKE-STRING-HASH-TABLE [k] */
+SCM s_make_string_hash_table(SCM args) {
+    return make_kind_table("make-string-hash-table", HT_STRING, args);
+}
+
+/* ALIST->HASH-TABLE alist [equiv [hash]] -- the first of duplicate
+   keys wins */
+SCM s_alist_to_hash_table(SCM args) {
+    SCM table, l;
+    long n = 0;
+
+    check_nargs("alist->hash-table", args, 1, 3);
+    for (l = CAR(args); IS_PAIR(l); l = CDR(l)) {
+        if (!IS_PAIR(CAR(l)))
+            wta_error("alist->hash-table", 1);
+        n++;
+    }
+    if (!IS_NULL(l))
+        wta_error("alist->hash-table", 1);
+    table = make_table("alist->hash-table", CDR(args), 2, n);
+    for (l = CAR(args); IS_PAIR(l); l = CDR(l))
+        if (lookup("alist->hash-table", table, CAAR(l)) < 0)
+            set_entry("alist->hash-table", table, CAAR(l), CDAR(l));
+    return table;
+}
+
+/* HASH-TABLE-REF table key [failure [success]] -- FAILURE is called
+   with no argument when KEY is missing, SUCCESS with the value */
+SCM s_hash_table_ref(SCM args) {
+    int n = check_nargs("hash-table-ref", args, 2, 4);
+    long i = lookup("hash-table-ref", FIRST(args), SECOND(args));
+
+    if (i < 0) {
+        if (n < 3)
+            error1("ERROR: %s: No such key.\n", "hash-table-ref");
+        return apply_procedure(THIRD(args), NIL);
+    }
+    if (n == 4)
+        return apply_procedure(FOURTH(args),
+                               CONS(HASHTABLE(FIRST(args))->entries[i].value,
+                                    NIL));
+    return HASHTABLE(FIRST(args))->entries[i].value;
+}
+
+/* HASH-TABLE-REF/DEFAULT table key default */
+SCM s_hash_table_ref_default(SCM table, SCM key, SCM dflt) {
+    long i = lookup("hash-table-ref/default", table, key);
+    return i < 0 ? dflt : HASHTABLE(table)->entries[i].value;
+}
+
+/* HASH-TABLE-SET! table key value */
+SCM s_hash_table_set(SCM table, SCM key, SCM value) {
+    set_entry("hash-table-set!", table, key, value);
+    return unspecified_value;
+}
+
+/* HASH-TABLE-DELETE! table key */
+SCM s_hash_table_delete(SCM table, SCM key) {
+    long i = lookup("hash-table-delete!", table, key);
+    if (i >= 0) {
+        HASHTABLE(table)->entries[i].key = NULL;
+        HASHTABLE(table)->entries[i].value = NIL;
+        HASHTABLE(table)->count--;
+    }
+    return unspecified_value;
+}
+
+/* HASH-TABLE-CONTAINS? table key */
+SCM s_hash_table_contains(SCM table, SCM key) {
+    return lookup("hash-table-contains?", table, key) >= 0 ?
+        boolean_true : boolean_false;
+}
+
+/* HASH-TABLE-COUNT table */
+SCM s_hash_table_count(SCM table) {
+    return MK_FIXNUM(table_arg("hash-table-count", table, 1)->count);
+}
+
+/* HASH-TABLE-UPDATE! table key proc [failure] -- stores the value of
+   PROC applied to the value of KEY, or to that of FAILURE */
+SCM s_hash_table_update(SCM args) {
+    int n = check_nargs("hash-table-update!", args, 3, 4);
+    long i = lookup("hash-table-update!", FIRST(args), SECOND(args));
+    SCM x;
+
+    if (i < 0 && n < 4)
+        error1("ERROR: %s: No such key.\n", "hash-table-update!");
+    x = i >= 0 ? HASHTABLE(FIRST(args))->entries[i].value :
+        apply_procedure(FOURTH(args), NIL);
+    x = apply_procedure(THIRD(args), CONS(x, NIL));
+    set_entry("hash-table-update!", FIRST(args), SECOND(args), x);
+    return unspecified_value;
+}
+
+/* HASH-TABLE-UPDATE!/DEFAULT table key proc default */
+SCM s_hash_table_update_default(SCM args) {
+    long i;
+    SCM x;
+
+    check_nargs("hash-table-update!/default", args, 4, 4);
+    i = lookup("hash-table-update!/default", FIRST(args), SECOND(args));
+    x = i >= 0 ? HASHTABLE(FIRST(args))->entries[i].value : FOURTH(args);
+    x = apply_procedure(THIRD(args), CONS(x, NIL));
+    set_entry("hash-table-update!/default", FIRST(args), SECOND(args), x);
+    return unspecified_value;
+}
+
+/* HASH-TABLE-WALK table proc -- PROC is called with each key and
+   value */
+SCM s_hash_table_walk(SCM table, SCM proc) {
+    struct hashtable *t = table_arg("hash-table-walk", table, 1);
+    long i;
+
+    for (i = 0; i < t->size; i++)
+        if (t->entries[i].key != NULL)
+            apply_procedure(proc, CONS(t->entries[i].key,
+                                       CONS(t->entries[i].value, NIL)));
+    return unspecified_value;
+}
+
+enum { LIST_KEYS, LIST_VALUES, LIST_PAIRS };
+
+static SCM table_to_list(char *fname, SCM table, int what) {
+    struct hashtable *t = table_arg(fname, table, 1);
+    SCM l = NIL;
+    long i;
+
+    for (i = 0; i < t->size; i++) {
+        struct hash_entry *e = &t->entries[i];
+        if (e->key == NULL)
+            continue;
+        l = CONS(what == LIST_KEYS ? e->key :
+                 what == LIST_VALUES ? e->value :
+                 CONS(e->key, e->value), l);
+    }
+    return l;
+}
+
+/* HASH-TABLE-KEYS table */
+SCM s_hash_table_keys(SCM table) {
+    return table_to_list("hash-table-keys", table, LIST_KEYS);
+}
+
+/* HASH-TABLE-VALUES table */
+SCM s_hash_table_values(SCM table) {
+    return table_to_list("hash-table-values", table, LIST_VALUES);
+}
+
+/* HASH-TABLE->ALIST table */
+SCM s_hash_table_to_alist(SCM table) {
+    return table_to_list("hash-table->alist", table, LIST_PAIRS);
+}
+
+/* HASH-TABLE-COPY table */
+SCM s_hash_table_copy(SCM table) {
+    struct hashtable *t = table_arg("hash-table-copy", table, 1);
+    SCM copy = new_table(t->kind, 0, t->equiv, t->hash);
+    struct hashtable *c = HASHTABLE(copy);
+
+    free(c->entries);
+    c->entries = alloc_entries(t->size);
+    memcpy(c->entries, t->entries, t->size * sizeof(struct hash_entry));
+    c->size = t->size;
+    c->count = t->count;
+    c->used = t->used;
+    return copy;
+}
+
+/* HASH-TABLE-CLEAR! table */
+SCM s_hash_table_clear(SCM table) {
+    struct hashtable *t = table_arg("hash-table-clear!", table, 1);
+    free(t->entries);
+    t->size = HT_MIN_SIZE;
+    t->count = t->used = 0;
+    t->entries = alloc_entries(t->size);
+    return unspecified_value;
+}
+
+/* H as a fixnum, below the optional bound in ARGS of FNAME */
+static SCM hash_value(char *fname, unsigned h, SCM args) {
+    if (IS_PAIR(CDR(args))) {
+        SCM bound = SECOND(args);
+        if (!IS_FIXNUM(bound) || FIXNUM(bound) <= 0)
+            wta_error(fname, 2);
+        return MK_FIXNUM(h % (unsigned)FIXNUM(bound));
+    }
+    return MK_FIXNUM(h & FIXNUM_MAX);
+}
+
+/* EQUAL-HASH x [bound], also HASH */
+SCM s_equal_hash(SCM args) {
+    int budget = EQUAL_HASH_BUDGET;
+    check_nargs("equal-hash", args, 1, 2);
+    return hash_value("equal-hash", equal_hash(CAR(args), &budget), args);
+}
+
+/* EQV-HASH x [bound] */
+SCM s_eqv_hash(SCM args) {
+    check_nargs("eqv-hash", args, 1, 2);
+    return hash_value("eqv-hash", eqv_hash(CAR(args)), args);
+}
+
+/* EQ-HASH x [bound], also HASH-BY-IDENTITY */
+SCM s_eq_hash(SCM args) {
+    check_nargs("eq-hash", args, 1, 2);
+    return hash_value("eq-hash", eq_hash(CAR(args)), args);
+}
+
+/* STRING-HASH string [bound] */
+SCM s_string_hash(SCM args) {
+    check_nargs("string-hash", args, 1, 2);
+    if (!IS_STRING(CAR(args)))
+        wta_error("string-hash", 1);
+    return hash_value("string-hash", string_hash(CAR(args)), args);
+}
+
+void init_hashtable_subrs(void) {
+    mk_subr("HASH-TABLE?", (SCM (*)(void))s_hash_tablep, 1);
+    SET_FLAG(mk_subr("MAKE-HASH-TABLE",
+                     (SCM (*)(void))s_make_hash_table, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("MAKE-EQ-HASH-TABLE",
+                     (SCM (*)(void))s_make_eq_hash_table, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("MAKE-EQV-HASH-TABLE",
+                     (SCM (*)(void))s_make_eqv_hash_table, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("MAKE-EQUAL-HASH-TABLE",
+                     (SCM (*)(void))s_make_equal_hash_table, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("MAKE-STRING-HASH-TABLE",
+                     (SCM (*)(void))s_make_string_hash_table, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("ALIST->HASH-TABLE",
+                     (SCM (*)(void))s_alist_to_hash_table, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("HASH-TABLE-REF",
+                     (SCM (*)(void))s_hash_table_ref, -1),
+             FLAG_STACK_ARGS);
+    mk_subr("HASH-TABLE-REF/DEFAULT",
+            (SCM (*)(void))s_hash_table_ref_default, 3);
+    mk_subr("HASH-TABLE-SET!", (SCM (*)(void))s_hash_table_set, 3);
+    mk_subr("HASH-TABLE-DELETE!", (SCM (*)(void))s_hash_table_delete, 2);
+    mk_subr("HASH-TABLE-CONTAINS?",
+            (SCM (*)(void))s_hash_table_contains, 2);
+    mk_subr("HASH-TABLE-EXISTS?",
+            (SCM (*)(void))s_hash_table_contains, 2);
+    mk_subr("HASH-TABLE-COUNT", (SCM (*)(void))s_hash_table_count, 1);
+    mk_subr("HASH-TABLE-SIZE", (SCM (*)(void))s_hash_table_count, 1);
+    SET_FLAG(mk_subr("HASH-TABLE-UPDATE!",
+                     (SCM (*)(void))s_hash_table_update, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("HASH-TABLE-UPDATE!/DEFAULT",
+                     (SCM (*)(void))s_hash_table_update_default, -1),
+             FLAG_STACK_ARGS);
+    mk_subr("HASH-TABLE-WALK", (SCM (*)(void))s_hash_table_walk, 2);
+    mk_subr("HASH-TABLE-KEYS", (SCM (*)(void))s_hash_table_keys, 1);
+    mk_subr("HASH-TABLE-VALUES", (SCM (*)(void))s_hash_table_values, 1);
+    mk_subr("HASH-TABLE->ALIST", (SCM (*)(void))s_hash_table_to_alist, 1);
+    mk_subr("HASH-TABLE-COPY", (SCM (*)(void))s_hash_table_copy, 1);
+    mk_subr("HASH-TABLE-CLEAR!", (SCM (*)(void))s_hash_table_clear, 1);
+    SET_FLAG(mk_subr("EQUAL-HASH", (SCM (*)(void))s_equal_hash, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("HASH", (SCM (*)(void))s_equal_hash, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("EQV-HASH", (SCM (*)(void))s_eqv_hash, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("EQ-HASH", (SCM (*)(void))s_eq_hash, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("HASH-BY-IDENTITY", (SCM (*)(void))s_eq_hash, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("STRING-HASH", (SCM (*)(void))s_string_hash, -1),
+             FLAG_STACK_ARGS);
+}
@@ -23,36 +23,8 @@
 (define (scheme-implementation-type) 'tscheme)
 (define (scheme-implementation-version) "Apr. 18, 2013")
 
-(define (caar x) (car (car x)))
-(define (cadr x) (car (cdr x)))
-(define (cdar x) (cdr (car x)))
-(define (cddr x) (cdr (cdr x)))
-
-(define (caaar x) (car (caar x)))
-(define (caadr x) (car (cadr x)))
-(define (cadar x) (car (cdar x)))
-(define (caddr x) (car (cddr x)))
-(define (cdaar x) (cdr (caar x)))
-(define (cdadr x) (cdr (cadr x)))
-(define (cddar x) (cdr (cdar x)))
-(define (cdddr x) (cdr (cddr x)))
-
-(define (caaaar x) (car (caaar x)))
-(define (caaadr x) (car (caadr x)))
-(define (caadar x) (car (cadar x)))
-(define (caaddr x) (car (caddr x)))
-(define (cadaar x) (car (cdaar x)))
-(define (cadadr x) (car (cdadr x)))
-(define (caddar x) (car (cddar x)))
-(define (cadddr x) (car (cdddr x)))
-(define (cdaaar x) (cdr (caaar x)))
-(define (cdaadr x) (cdr (caadr x)))
-(define (cdadar x) (cdr (cadar x)))
-(define (cdaddr x) (cdr (caddr x)))
-(define (cddaar x) (cdr (cdaar x)))
-(define (cddadr x) (cdr (cdadr x)))
-(define (cdddar x) (cdr (cddar x)))
-(define (cddddr x) (cdr (cdddr x)))
+;;; The C[AD]+R combinations, MAP, FOR-EACH, APPEND, REVERSE, ASSOC,
+;;; EQUAL?, LIST*, BUTLAST and LAST are subrs (see subrs.c).
 
 (define first car)
 (define second cadr)
@@ -70,75 +42,8 @@
 	  (nth (cdr l) (-1+ n)))
       (error "nth: invalid argument")))
 
-(define (equal? x y)   ; abridged version of 'equal?'.
-  (cond ((eq? x y))
-	((and (pair? x) (pair? y)
-	      (equal? (car x) (car y))
-	      (equal? (cdr x) (cdr y))))
-	(else
-	 #f)))
-
-(define (assoc key alist)
-  (cond ((null? alist)
-	 #f)
-	((eq? key (caar alist))
-	 (car alist))
-	(else
-	 (assoc key (cdr alist)))))
-
-(define (vector? x) #f)
-
 (define (atom? x) (not (pair? x)))
 
-(define (append . args)
-  (define (append2 xs ys)
-    (if (null? xs)
-	ys
-	(cons (car xs) (append2 (cdr xs) ys))))
-  (let loop ((args args))
-    (if (null? args)
-	'()
-	(append2 (car args) (loop (cdr args))))))
-
-(define (reverse l)
-  (define (rev1 l a)
-    (if (null? l) a (rev1 (cdr l) (cons (car l) a))))
-  (rev1 l '()))
-
-(define (list* . args)
-  (if (null? args)
-      '()
-      (append (butlast args) (last args))))
-
-(define (butlast l)
-  (cond ((null? l)
-	 (error "butlast"))
-	((null? (cdr l))
-	 '())
-	(else
-	 (cons (car l) (butlast (cdr l))))))
-
-(define (last l)
-  (cond ((null? l)
-	 (error "last"))
-	((null? (cdr l))
-	 (car l))
-	(else
-	 (last (cdr l)))))
-
-(define (map1 f xs)
-  (if (null? xs)
-      '()
-      (cons (f (car xs)) (map1 f (cdr xs)))))
-
-(define (map f . args)
-  (if (null? (car args))
-      '()
-      (let ((args1 (map1 car args))
-	    (argsr (map1 cdr args)))
-	(cons (apply f args1)
-	      (apply map f argsr)))))
-
 (define (expand-quasiquote e)
   (cond ((and (atom? e) (not (symbol? e))) e)
 	((symbol? e) (list 'quote e))
@@ -182,6 +87,311 @@
 	(set! *gentemp-counter* (+ *gentemp-counter* 1))
 	s))))
 
+;;; Macros
+
+;;; (DEFINE-MACRO (name . args) . body) is handled by SYS:SIMPLIFY.
+;;; (DEFINE-SYNTAX name (SYNTAX-RULES (literal...) (pattern template)...))
+;;; is built on it; the patterns may use ... after a subpattern.  The
+;;; expansion is not hygienic: symbols of a template are inserted as
+;;; they are.
+
+(define-macro (define-syntax name rules)
+  (list 'sys:define-macro (list 'quote name) rules))
+
+(define-macro (syntax-rules literals . rules)
+  (list 'sys:syntax-rules (list 'quote literals) (list 'quote rules)))
+
+(define sys:sr-ellipsis (list '...))
+
+(define (sys:syntax-rules literals rules)
+  (lambda args
+    (let loop ((rules rules))
+      (if (null? rules)
+	  (error "syntax-rules: no matching rule")
+	  (let ((binds (sys:sr-match (cdaar rules) args literals '())))
+	    (if binds
+		(sys:sr-expand (cadar rules) binds)
+		(loop (cdr rules))))))))
+
+;; an alist of the pattern variables of PAT bound to the matching
+;; parts of X, or #f.  A variable under ... is bound to
+;; (sys:sr-ellipsis . matches).
+(define (sys:sr-match pat x literals binds)
+  (cond ((not binds)
+	 #f)
+	((symbol? pat)
+	 (cond ((memq pat literals) (and (eq? pat x) binds))
+	       ((eq? pat '_) binds)
+	       (else (cons (cons pat x) binds))))
+	((and (pair? pat) (pair? (cdr pat)) (eq? (cadr pat) '...))
+	 (let loop ((x x)
+		    (n (- (sys:sr-length x) (sys:sr-length (cddr pat))))
+		    (matches '()))
+	   (if (< n 1)
+	       (and (= n 0)
+		    (sys:sr-match (cddr pat) x literals
+				  (sys:sr-bind-ellipsis (car pat) literals
+							(reverse matches)
+							binds)))
+	       (let ((m (sys:sr-match (car pat) (car x) literals '())))
+		 (and m (loop (cdr x) (-1+ n) (cons m matches)))))))
+	((pair? pat)
+	 (and (pair? x)
+	      (sys:sr-match (cdr pat) (cdr x) literals
+			    (sys:sr-match (car pat) (car x) literals binds))))
+	((null? pat)
+	 (and (null? x) binds))
+	(else
+	 (and (equal? pat x) binds))))
+
+(define (sys:sr-length x)
+  (let loop ((x x) (n 0))
+    (if (pair? x) (loop (cdr x) (1+ n)) n)))
+
+(define (sys:sr-vars pat literals)
+  (cond ((symbol? pat)
+	 (if (or (memq pat literals) (memq pat '(... _))) '() (list pat)))
+	((pair? pat)
+	 (append (sys:sr-vars (car pat) literals)
+		 (sys:sr-vars (cdr pat) literals)))
+	(else '())))
+
+(define (sys:sr-bind-ellipsis pat literals matches binds)
+  (let loop ((vars (sys:sr-vars pat literals)) (binds binds))
+    (if (null? vars)
+	binds
+	(loop (cdr vars)
+	      (cons (list* (car vars)
+			   sys:sr-ellipsis
+			   (map1 (lambda (m) (cdr (assq (car vars) m)))
+				 matches))
+		    binds)))))
+
+(define (sys:sr-expand tmpl binds)
+  (cond ((symbol? tmpl)
+	 (let ((b (assq tmpl binds)))
+	   (if b (cdr b) tmpl)))
+	((and (pair? tmpl) (pair? (cdr tmpl)) (eq? (cadr tmpl) '...))
+	 (append (sys:sr-expand-ellipsis (car tmpl) binds)
+		 (sys:sr-expand (cddr tmpl) binds)))
+	((pair? tmpl)
+	 (cons (sys:sr-expand (car tmpl) binds)
+	       (sys:sr-expand (cdr tmpl) binds)))
+	(else tmpl)))
+
+;; the expansions of TMPL for each match of the ellipsis variables
+;; in it
+(define (sys:sr-expand-ellipsis tmpl binds)
+  (let loop ((vars (sys:sr-vars tmpl '())) (evars '()))
+    (cond ((pair? vars)
+	   (let ((b (assq (car vars) binds)))
+	     (loop (cdr vars)
+		   (if (and b (pair? (cdr b)) (eq? (cadr b) sys:sr-ellipsis))
+		       (cons b evars)
+		       evars))))
+	  ((null? evars)
+	   (error "syntax-rules: no pattern variable before ..."))
+	  (else
+	   (let each ((vals (map1 cddr evars)))
+	     (if (pair? (car vals))
+		 (cons (sys:sr-expand tmpl
+				      (sys:sr-rebind evars (map1 car vals)
+						     binds))
+		       (each (map1 cdr vals)))
+		 '()))))))
+
+(define (sys:sr-rebind evars vals binds)
+  (if (null? evars)
+      binds
+      (sys:sr-rebind (cdr evars) (cdr vals)
+		     (cons (cons (caar evars) (car vals)) binds))))
+
+;;; Multiple values
+
+;;; (RECEIVE formals expr . body) binds formals to the values of expr,
+;;; which VALUES leaves in a register area (see eval.c).
+
+(define-macro (receive formals expr . body)
+  (let loop ((f formals) (i 0) (binds '()))
+    (if (pair? f)
+	(loop (cdr f) (1+ i) (cons (list (car f) (list 'sys:value-ref i)) binds))
+	(list 'begin
+	      (list 'sys:values-check expr i (symbol? f))
+	      (list* 'let
+		     (reverse (if (symbol? f)
+				  (cons (list f (list 'sys:values-rest i)) binds)
+				  binds))
+		     body)))))
+
+(define-macro (let*-values bindings . body)
+  (if (null? bindings)
+      (list* 'let '() body)
+      (list 'receive (caar bindings) (cadar bindings)
+	    (list* 'let*-values (cdr bindings) body))))
+
+;; Each expression sees none of the variables: the values are first
+;; bound to temporaries.
+(define-macro (let-values bindings . body)
+  (if (and (pair? bindings) (null? (cdr bindings)))
+      (list* 'receive (caar bindings) (cadar bindings) body)
+      (let loop ((bs bindings) (renames '()))
+	(if (null? bs)
+	    (list* 'let renames body)
+	    (let ((r (sys:rename-formals (caar bs))))
+	      (list 'receive (car r) (cadar bs)
+		    (loop (cdr bs) (append (cdr r) renames))))))))
+
+;; (renamed-formals . ((var temp)...))
+(define (sys:rename-formals f)
+  (cond ((pair? f)
+	 (let ((t (gentemp)) (r (sys:rename-formals (cdr f))))
+	   (cons (cons t (car r)) (cons (list (car f) t) (cdr r)))))
+	((symbol? f)
+	 (let ((t (gentemp)))
+	   (cons t (list (list f t)))))
+	(else
+	 (cons '() '()))))
+
+;;; Records
+
+;;; (DEFINE-RECORD-TYPE type constructor predicate (field accessor
+;;; [modifier])...) defines TYPE and record procedures made by the
+;;; SYS:RECORD-* subrs (see record.c).  CONSTRUCTOR is (name field...),
+;;; a bare name taking all the fields, or #f, as may be PREDICATE.
+
+(define-macro (define-record-type type constructor predicate . specs)
+  (let ((fields (map car specs))
+	(make (lambda (name maker . args)
+		(list 'define name
+		      (list* maker type (list 'quote name) args)))))
+    (list* 'begin
+	   (list 'define type
+		 (list 'sys:make-record-type (list 'quote type)
+		       (list 'quote fields)))
+	   (append
+	    (cond ((pair? constructor)
+		   (list (make (car constructor) 'sys:record-constructor
+			       (list 'quote (cdr constructor)))))
+		  (constructor
+		   (list (make constructor 'sys:record-constructor
+			       (list 'quote fields))))
+		  (else
+		   '()))
+	    (if predicate
+		(list (make predicate 'sys:record-predicate))
+		'())
+	    (apply append
+		   (map (lambda (spec)
+			  (cons (make (cadr spec) 'sys:record-accessor
+				      (list 'quote (car spec)))
+				(if (pair? (cddr spec))
+				    (list (make (caddr spec) 'sys:record-modifier
+						(list 'quote (car spec))))
+				    '())))
+			specs))))))
+
+;;; Streams
+
+;;; A stream is the empty list or a pair whose cdr is a promise for
+;;; the rest, as made by (CONS-STREAM a b).  The procedures below run
+;;; in constant space over a stream nobody else holds on to, so
+;;; (stream-for-each f (read-stream port)) processes an input of any
+;;; length.
+
+(define the-empty-stream '())
+(define stream-nil '())
+(define (stream-null? s) (null? s))
+(define empty-stream? stream-null?)
+
+(define (stream-pair? s) (and (pair? s) (promise? (cdr s))))
+
+(define (stream-car s) (car s))
+(define (stream-cdr s) (force (cdr s)))
+
+(define (stream . elements) (list->stream elements))
+
+(define (list->stream l)
+  (if (pair? l)
+      (cons-stream (car l) (list->stream (cdr l)))
+      the-empty-stream))
+
+(define (stream->list s)
+  (reverse (stream-fold (lambda (x acc) (cons x acc)) '() s)))
+
+(define (stream-head s n)
+  (if (< n 1)
+      '()
+      (cons (stream-car s) (stream-head (stream-cdr s) (-1+ n)))))
+
+(define (stream-tail s n)
+  (if (< n 1)
+      s
+      (stream-tail (stream-cdr s) (-1+ n))))
+
+(define (stream-ref s n)
+  (stream-car (stream-tail s n)))
+
+(define (stream-map f s)
+  (if (stream-pair? s)
+      (cons-stream (f (stream-car s)) (stream-map f (stream-cdr s)))
+      the-empty-stream))
+
+(define (stream-filter pred s)
+  (cond ((not (stream-pair? s))
+	 the-empty-stream)
+	((pred (stream-car s))
+	 (cons-stream (stream-car s) (stream-filter pred (stream-cdr s))))
+	(else
+	 (stream-filter pred (stream-cdr s)))))
+
+(define (stream-for-each f s)
+  (if (stream-pair? s)
+      (begin
+	(f (stream-car s))
+	(stream-for-each f (stream-cdr s)))))
+
+(define (stream-fold f acc s)
+  (if (stream-pair? s)
+      (stream-fold f (f (stream-car s) acc) (stream-cdr s))
+      acc))
+
+(define (stream-append s1 s2)
+  (if (stream-pair? s1)
+      (cons-stream (stream-car s1) (stream-append (stream-cdr s1) s2))
+      s2))
+
+;; the data read from PORT, read as the stream is walked
+(define (read-stream port)
+  (let ((x (read port)))
+    (if (eof-object? x)
+	the-empty-stream
+	(cons-stream x (read-stream port)))))
+
+;;; Escapes and exceptions
+
+;;; An escape continuation is only valid while CALL/EC has not
+;;; returned; calling it unwinds the stack in one step (see error.c).
+
+(define (call/ec f)
+  (let ((tag (list 'call/ec)))
+    (sys:catch tag (lambda () (f (lambda vals (sys:throw tag vals)))))))
+
+(define call-with-escape-continuation call/ec)
+
+;; (GUARD (var clause...) . body): the clauses are those of COND and
+;; are evaluated after the stack has been unwound to the GUARD.  When
+;; none applies, the object is raised again from there.
+(define-macro (guard spec . body)
+  (let ((var (car spec)) (clauses (cdr spec)))
+    (list 'sys:guard
+	  (list* 'lambda '() body)
+	  (list 'lambda (list var)
+		(cons 'cond
+		      (if (and (pair? clauses) (eq? (car (last clauses)) 'else))
+			  clauses
+			  (append clauses
+				  (list (list 'else (list 'raise var))))))))))
+
 (define *prompt* "> ")
 (define *default-prompt* "> ")
 
@@ -196,7 +406,7 @@
            (display "Bye!")
            (newline))
           (else
-           (write (sys:eval (sys:simplify input) '()))
+           (write (sys:eval (sys:compile input) '()))
            (newline)
            (sys:toplevel)))))
 
@@ -212,12 +422,12 @@
               (display "done.")
               (newline))
 	    (begin
-              (sys:eval (sys:simplify e) '())
+              (sys:eval (sys:compile e) '())
               ;; (display ".")
               (loop (read inport))))))))
 
 (define (eval x)
-  (sys:eval (sys:simplify x) '()))
+  (sys:eval (sys:compile x) '()))
 
 ;;; -*- EOF -*-
 
@@ -1,74 +1,126 @@
 (DEFINE SCHEME-IMPLEMENTATION-TYPE (LAMBDA () (QUOTE TSCHEME)))
 (DEFINE SCHEME-IMPLEMENTATION-VERSION (LAMBDA () "Apr. 18, 2013"))
-(DEFINE CAAR (LAMBDA (X) (CAR (CAR X))))
-(DEFINE CADR (LAMBDA (X) (CAR (CDR X))))
-(DEFINE CDAR (LAMBDA (X) (CDR (CAR X))))
-(DEFINE CDDR (LAMBDA (X) (CDR (CDR X))))
-(DEFINE CAAAR (LAMBDA (X) (CAR (CAAR X))))
-(DEFINE CAADR (LAMBDA (X) (CAR (CADR X))))
-(DEFINE CADAR (LAMBDA (X) (CAR (CDAR X))))
-(DEFINE CADDR (LAMBDA (X) (CAR (CDDR X))))
-(DEFINE CDAAR (LAMBDA (X) (CDR (CAAR X))))
-(DEFINE CDADR (LAMBDA (X) (CDR (CADR X))))
-(DEFINE CDDAR (LAMBDA (X) (CDR (CDAR X))))
-(DEFINE CDDDR (LAMBDA (X) (CDR (CDDR X))))
-(DEFINE CAAAAR (LAMBDA (X) (CAR (CAAAR X))))
-(DEFINE CAAADR (LAMBDA (X) (CAR (CAADR X))))
-(DEFINE CAADAR (LAMBDA (X) (CAR (CADAR X))))
-(DEFINE CAADDR (LAMBDA (X) (CAR (CADDR X))))
-(DEFINE CADAAR (LAMBDA (X) (CAR (CDAAR X))))
-(DEFINE CADADR (LAMBDA (X) (CAR (CDADR X))))
-(DEFINE CADDAR (LAMBDA (X) (CAR (CDDAR X))))
-(DEFINE CADDDR (LAMBDA (X) (CAR (CDDDR X))))
-(DEFINE CDAAAR (LAMBDA (X) (CDR (CAAAR X))))
-(DEFINE CDAADR (LAMBDA (X) (CDR (CAADR X))))
-(DEFINE CDADAR (LAMBDA (X) (CDR (CADAR X))))
-(DEFINE CDADDR (LAMBDA (X) (CDR (CADDR X))))
-(DEFINE CDDAAR (LAMBDA (X) (CDR (CDAAR X))))
-(DEFINE CDDADR (LAMBDA (X) (CDR (CDADR X))))
-(DEFINE CDDDAR (LAMBDA (X) (CDR (CDDAR X))))
-(DEFINE CDDDDR (LAMBDA (X) (CDR (CDDDR X))))
 (DEFINE FIRST CAR)
 (DEFINE SECOND CADR)
 (DEFINE THIRD CADDR)
 (DEFINE FOURTH CADDDR)
-(DEFINE FIFTH (LAMBDA (X) (CAR (CDDDDR X))))
-(DEFINE SIXTH (LAMBDA (X) (CADR (CDDDDR X))))
-(DEFINE SEVENTH (LAMBDA (X) (CADDR (CDDDDR X))))
-(DEFINE EIGHTH (LAMBDA (X) (CADDDR (CDDDDR X))))
-(DEFINE NTH (LAMBDA (L N) (IF (PAIR? L) (IF (< N 1) (CAR L) (NTH (CDR L) (-1+ N))) (ERROR "nth: invalid argument"))))
-(DEFINE EQUAL? (LAMBDA (X Y) (COND ((EQ? X Y)) ((AND (PAIR? X) (PAIR? Y) (EQUAL? (CAR X) (CAR Y)) (EQUAL? (CDR X) (CDR Y)))) (ELSE #f))))
-(DEFINE ASSOC (LAMBDA (KEY ALIST) (COND ((NULL? ALIST) #f) ((EQ? KEY (CAAR ALIST)) (CAR ALIST)) (ELSE (ASSOC KEY (CDR ALIST))))))
-(DEFINE VECTOR? (LAMBDA (X) #f))
+(DEFINE FIFTH (LAMBDA (X) (CAR (CDR (CDR (CDR (CDR X)))))))
+(DEFINE SIXTH (LAMBDA (X) (CAR (CDR (CDR (CDR (CDR (CDR X))))))))
+(DEFINE SEVENTH (LAMBDA (X) (CAR (CDR (CDR (CDR (CDR (CDR (CDR X)))))))))
+(DEFINE EIGHTH (LAMBDA (X) (CAR (CDR (CDR (CDR (CDR (CDR (CDR (CDR X))))))))))
+(DEFINE NTH (LAMBDA (L N) (IF (PAIR? L) (IF (< N 1) (SYS:CAR L) (NTH (SYS:CDR L) (-1+ N))) (ERROR "nth: invalid argument"))))
 (DEFINE ATOM? (LAMBDA (X) (NOT (PAIR? X))))
-(DEFINE APPEND (LAMBDA ARGS (LETREC ((APPEND2 (LAMBDA (XS YS) (IF (NULL? XS) YS (CONS (CAR XS) (APPEND2 (CDR XS) YS)))))) (LETREC ((LOOP (LAMBDA (ARGS) (IF (NULL? ARGS) (QUOTE ()) (APPEND2 (CAR ARGS) (LOOP (CDR ARGS))))))) (LOOP ARGS)))))
-(DEFINE REVERSE (LAMBDA (L) (LETREC ((REV1 (LAMBDA (L A) (IF (NULL? L) A (REV1 (CDR L) (CONS (CAR L) A)))))) (REV1 L (QUOTE ())))))
-(DEFINE LIST* (LAMBDA ARGS (IF (NULL? ARGS) (QUOTE ()) (APPEND (BUTLAST ARGS) (LAST ARGS)))))
-(DEFINE BUTLAST (LAMBDA (L) (COND ((NULL? L) (ERROR "butlast")) ((NULL? (CDR L)) (QUOTE ())) (ELSE (CONS (CAR L) (BUTLAST (CDR L)))))))
-(DEFINE LAST (LAMBDA (L) (COND ((NULL? L) (ERROR "last")) ((NULL? (CDR L)) (CAR L)) (ELSE (LAST (CDR L))))))
-(DEFINE MAP1 (LAMBDA (F XS) (IF (NULL? XS) (QUOTE ()) (CONS (F (CAR XS)) (MAP1 F (CDR XS))))))
-(DEFINE MAP (LAMBDA (F . ARGS) (IF (NULL? (CAR ARGS)) (QUOTE ()) (LET ((ARGS1 (MAP1 CAR ARGS)) (ARGSR (MAP1 CDR ARGS))) (CONS (APPLY F ARGS1) (APPLY MAP F ARGSR))))))
-(DEFINE EXPAND-QUASIQUOTE (LAMBDA (E) (COND ((AND (ATOM? E) (NOT (SYMBOL? E))) E) ((SYMBOL? E) (LIST (QUOTE QUOTE) E)) (ELSE (LETREC ((LOOP (LAMBDA (L A B) (COND ((NULL? L) (CONS (QUOTE APPEND) (REVERSE (CONS (CONS (QUOTE LIST) (REVERSE B)) A)))) (ELSE (IF (PAIR? (CAR L)) (CASE (CAAR L) ((UNQUOTE) (LOOP (CDR L) A (CONS (CADAR L) B))) ((UNQUOTE-SPLICING) (LOOP (CDR L) (CONS (CADAR L) (CONS (CONS (QUOTE LIST) (REVERSE B)) A)) (QUOTE ()))) (ELSE (LOOP (CDR L) A (CONS (EXPAND-QUASIQUOTE (CAR L)) B)))) (LOOP (CDR L) A (CONS (EXPAND-QUASIQUOTE (CAR L)) B)))))))) (LOOP E (QUOTE ()) (QUOTE ())))))))
+(DEFINE EXPAND-QUASIQUOTE (LAMBDA (E) (COND ((AND (ATOM? E) (NOT (SYMBOL? E))) E) ((SYMBOL? E) (LIST (QUOTE QUOTE) E)) (ELSE (LET LOOP ((L E) (A (QUOTE ())) (B (QUOTE ()))) (COND ((NULL? L) (CONS (QUOTE APPEND) (REVERSE (CONS (CONS (QUOTE LIST) (REVERSE B)) A)))) (ELSE (IF (PAIR? (CAR L)) (CASE (CAR (CAR L)) ((UNQUOTE) (LOOP (CDR L) A (CONS (CAR (CDR (CAR L))) B))) ((UNQUOTE-SPLICING) (LOOP (CDR L) (CONS (CAR (CDR (CAR L))) (CONS (CONS (QUOTE LIST) (REVERSE B)) A)) (QUOTE ()))) (ELSE (LOOP (CDR L) A (CONS (EXPAND-QUASIQUOTE (CAR L)) B)))) (LOOP (CDR L) A (CONS (EXPAND-QUASIQUOTE (CAR L)) B))))))))))
 (DEFINE CALL-WITH-INPUT-FILE (LAMBDA (INFILE F) (LET ((INPORT (OPEN-INPUT-FILE INFILE))) (F INPORT) (CLOSE-INPUT-PORT INPORT))))
 (DEFINE CALL-WITH-OUTPUT-FILE (LAMBDA (OUTFILE F) (LET ((OUTPORT (OPEN-OUTPUT-FILE OUTFILE))) (F OUTPORT) (CLOSE-OUTPUT-PORT OUTPORT))))
-(DEFINE GENTEMP (LET ((*GENTEMP-COUNTER* 0)) (LAMBDA () (LET ((S (STRING->SYMBOL (STRING-APPEND "SCM:" (NUMBER->STRING *GENTEMP-COUNTER*))))) (SET! *GENTEMP-COUNTER* (+ *GENTEMP-COUNTER* 1)) S))))
+(DEFINE GENTEMP (LET ((*GENTEMP-COUNTER* 0)) (SYS:LAMBDA (*GENTEMP-COUNTER*) () (LET ((S (STRING->SYMBOL (STRING-APPEND "SCM:" (NUMBER->STRING *GENTEMP-COUNTER*))))) (SET! *GENTEMP-COUNTER* (+ *GENTEMP-COUNTER* 1)) S))))
+(SYS:DEFINE-MACRO (QUOTE DEFINE-SYNTAX) (LAMBDA (NAME RULES) (LIST (QUOTE SYS:DEFINE-MACRO) (LIST (QUOTE QUOTE) NAME) RULES)))
+(SYS:DEFINE-MACRO (QUOTE SYNTAX-RULES) (LAMBDA (LITERALS . RULES) (LIST (QUOTE SYS:SYNTAX-RULES) (LIST (QUOTE QUOTE) LITERALS) (LIST (QUOTE QUOTE) RULES))))
+(DEFINE SYS:SR-ELLIPSIS (LIST (QUOTE ...)))
+(DEFINE SYS:SYNTAX-RULES (LAMBDA (LITERALS RULES) (SYS:LAMBDA (RULES LITERALS) ARGS (LET LOOP ((RULES RULES)) (IF (NULL? RULES) (ERROR "syntax-rules: no matching rule") (LET ((BINDS (SYS:SR-MATCH (CDR (CAR (CAR RULES))) ARGS LITERALS (QUOTE ())))) (IF BINDS (SYS:SR-EXPAND (CAR (CDR (CAR RULES))) BINDS) (LOOP (CDR RULES)))))))))
+(DEFINE SYS:SR-MATCH (LAMBDA (PAT X LITERALS BINDS) (COND ((NOT BINDS) #f) ((SYMBOL? PAT) (COND ((MEMQ PAT LITERALS) (AND (EQ? PAT X) BINDS)) ((EQ? PAT (QUOTE _)) BINDS) (ELSE (CONS (CONS PAT X) BINDS)))) ((AND (PAIR? PAT) (PAIR? (SYS:CDR PAT)) (EQ? (CAR (SYS:CDR PAT)) (QUOTE ...))) (LET LOOP ((X X) (N (- (SYS:SR-LENGTH X) (SYS:SR-LENGTH (CDR (SYS:CDR PAT))))) (MATCHES (QUOTE ()))) (IF (< N 1) (AND (= N 0) (SYS:SR-MATCH (CDR (SYS:CDR PAT)) X LITERALS (SYS:SR-BIND-ELLIPSIS (SYS:CAR PAT) LITERALS (REVERSE MATCHES) BINDS))) (LET ((M (SYS:SR-MATCH (SYS:CAR PAT) (CAR X) LITERALS (QUOTE ())))) (AND M (LOOP (CDR X) (-1+ N) (CONS M MATCHES))))))) ((PAIR? PAT) (AND (PAIR? X) (SYS:SR-MATCH (SYS:CDR PAT) (SYS:CDR X) LITERALS (SYS:SR-MATCH (SYS:CAR PAT) (SYS:CAR X) LITERALS BINDS)))) ((NULL? PAT) (AND (NULL? X) BINDS)) (ELSE (AND (EQUAL? PAT X) BINDS)))))
+(DEFINE SYS:SR-LENGTH (LAMBDA (X) (LET LOOP ((X X) (N 0)) (IF (PAIR? X) (LOOP (SYS:CDR X) (SYS:1+ N)) N))))
+(DEFINE SYS:SR-VARS (LAMBDA (PAT LITERALS) (COND ((SYMBOL? PAT) (IF (OR (MEMQ PAT LITERALS) (MEMQ PAT (QUOTE (... _)))) (QUOTE ()) (LIST PAT))) ((PAIR? PAT) (APPEND (SYS:SR-VARS (SYS:CAR PAT) LITERALS) (SYS:SR-VARS (SYS:CDR PAT) LITERALS))) (ELSE (QUOTE ())))))
+(DEFINE SYS:SR-BIND-ELLIPSIS (LAMBDA (PAT LITERALS MATCHES BINDS) (LET LOOP ((VARS (SYS:SR-VARS PAT LITERALS)) (BINDS BINDS)) (IF (NULL? VARS) BINDS (LOOP (CDR VARS) (CONS (LIST* (CAR VARS) SYS:SR-ELLIPSIS (MAP1 (SYS:LAMBDA (VARS) (M) (CDR (ASSQ (CAR VARS) M))) MATCHES)) BINDS))))))
+(DEFINE SYS:SR-EXPAND (LAMBDA (TMPL BINDS) (COND ((SYMBOL? TMPL) (LET ((B (ASSQ TMPL BINDS))) (IF B (CDR B) TMPL))) ((AND (PAIR? TMPL) (PAIR? (SYS:CDR TMPL)) (EQ? (CAR (SYS:CDR TMPL)) (QUOTE ...))) (APPEND (SYS:SR-EXPAND-ELLIPSIS (SYS:CAR TMPL) BINDS) (SYS:SR-EXPAND (CDR (SYS:CDR TMPL)) BINDS))) ((PAIR? TMPL) (CONS (SYS:SR-EXPAND (SYS:CAR TMPL) BINDS) (SYS:SR-EXPAND (SYS:CDR TMPL) BINDS))) (ELSE TMPL))))
+(DEFINE SYS:SR-EXPAND-ELLIPSIS (LAMBDA (TMPL BINDS) (LET LOOP ((VARS (SYS:SR-VARS TMPL (QUOTE ()))) (EVARS (QUOTE ()))) (COND ((PAIR? VARS) (LET ((B (ASSQ (SYS:CAR VARS) BINDS))) (LOOP (SYS:CDR VARS) (IF (AND B (PAIR? (CDR B)) (EQ? (CAR (CDR B)) SYS:SR-ELLIPSIS)) (CONS B EVARS) EVARS)))) ((NULL? EVARS) (ERROR "syntax-rules: no pattern variable before ...")) (ELSE (LET EACH ((VALS (MAP1 CDDR EVARS))) (IF (PAIR? (CAR VALS)) (CONS (SYS:SR-EXPAND TMPL (SYS:SR-REBIND EVARS (MAP1 CAR VALS) BINDS)) (EACH (MAP1 CDR VALS))) (QUOTE ()))))))))
+(DEFINE SYS:SR-REBIND (LAMBDA (EVARS VALS BINDS) (IF (NULL? EVARS) BINDS (SYS:SR-REBIND (CDR EVARS) (CDR VALS) (CONS (CONS (CAR (CAR EVARS)) (CAR VALS)) BINDS)))))
+(SYS:DEFINE-MACRO (QUOTE RECEIVE) (LAMBDA (FORMALS EXPR . BODY) (LET LOOP ((F FORMALS) (I 0) (BINDS (QUOTE ()))) (IF (PAIR? F) (LOOP (SYS:CDR F) (SYS:1+ I) (CONS (LIST (SYS:CAR F) (LIST (QUOTE SYS:VALUE-REF) I)) BINDS)) (LIST (QUOTE BEGIN) (LIST (QUOTE SYS:VALUES-CHECK) EXPR I (SYMBOL? F)) (LIST* (QUOTE LET) (REVERSE (IF (SYMBOL? F) (CONS (LIST F (LIST (QUOTE SYS:VALUES-REST) I)) BINDS) BINDS)) BODY))))))
+(SYS:DEFINE-MACRO (QUOTE LET*-VALUES) (LAMBDA (BINDINGS . BODY) (IF (NULL? BINDINGS) (LIST* (QUOTE LET) (QUOTE ()) BODY) (LIST (QUOTE RECEIVE) (CAR (CAR BINDINGS)) (CAR (CDR (CAR BINDINGS))) (LIST* (QUOTE LET*-VALUES) (CDR BINDINGS) BODY)))))
+(SYS:DEFINE-MACRO (QUOTE LET-VALUES) (LAMBDA (BINDINGS . BODY) (IF (AND (PAIR? BINDINGS) (NULL? (SYS:CDR BINDINGS))) (LIST* (QUOTE RECEIVE) (CAR (SYS:CAR BINDINGS)) (CAR (CDR (SYS:CAR BINDINGS))) BODY) (LET LOOP ((BS BINDINGS) (RENAMES (QUOTE ()))) (IF (NULL? BS) (LIST* (QUOTE LET) RENAMES BODY) (LET ((R (SYS:RENAME-FORMALS (CAR (CAR BS))))) (LIST (QUOTE RECEIVE) (CAR R) (CAR (CDR (CAR BS))) (LOOP (CDR BS) (APPEND (CDR R) RENAMES)))))))))
+(DEFINE SYS:RENAME-FORMALS (LAMBDA (F) (COND ((PAIR? F) (LET ((T (GENTEMP)) (R (SYS:RENAME-FORMALS (SYS:CDR F)))) (CONS (CONS T (CAR R)) (CONS (LIST (SYS:CAR F) T) (CDR R))))) ((SYMBOL? F) (LET ((T (GENTEMP))) (CONS T (LIST (LIST F T))))) (ELSE (CONS (QUOTE ()) (QUOTE ()))))))
+(SYS:DEFINE-MACRO (QUOTE DEFINE-RECORD-TYPE) (LAMBDA (TYPE CONSTRUCTOR PREDICATE . SPECS) (LET ((FIELDS (MAP CAR SPECS)) (MAKE (SYS:LAMBDA (TYPE) (NAME MAKER . ARGS) (LIST (QUOTE DEFINE) NAME (LIST* MAKER TYPE (LIST (QUOTE QUOTE) NAME) ARGS))))) (LIST* (QUOTE BEGIN) (LIST (QUOTE DEFINE) TYPE (LIST (QUOTE SYS:MAKE-RECORD-TYPE) (LIST (QUOTE QUOTE) TYPE) (LIST (QUOTE QUOTE) FIELDS))) (APPEND (COND ((PAIR? CONSTRUCTOR) (LIST (MAKE (SYS:CAR CONSTRUCTOR) (QUOTE SYS:RECORD-CONSTRUCTOR) (LIST (QUOTE QUOTE) (SYS:CDR CONSTRUCTOR))))) (CONSTRUCTOR (LIST (MAKE CONSTRUCTOR (QUOTE SYS:RECORD-CONSTRUCTOR) (LIST (QUOTE QUOTE) FIELDS)))) (ELSE (QUOTE ()))) (IF PREDICATE (LIST (MAKE PREDICATE (QUOTE SYS:RECORD-PREDICATE))) (QUOTE ())) (APPLY APPEND (MAP (SYS:LAMBDA (MAKE) (SPEC) (CONS (MAKE (CAR (CDR SPEC)) (QUOTE SYS:RECORD-ACCESSOR) (LIST (QUOTE QUOTE) (CAR SPEC))) (IF (PAIR? (CDR (CDR SPEC))) (LIST (MAKE (CAR (CDR (CDR SPEC))) (QUOTE SYS:RECORD-MODIFIER) (LIST (QUOTE QUOTE) (CAR SPEC)))) (QUOTE ())))) SPECS)))))))
+(DEFINE THE-EMPTY-STREAM (QUOTE ()))
+(DEFINE STREAM-NIL (QUOTE ()))
+(DEFINE STREAM-NULL? (LAMBDA (S) (NULL? S)))
+(DEFINE EMPTY-STREAM? STREAM-NULL?)
+(DEFINE STREAM-PAIR? (LAMBDA (S) (AND (PAIR? S) (PROMISE? (SYS:CDR S)))))
+(DEFINE STREAM-CAR (LAMBDA (S) (CAR S)))
+(DEFINE STREAM-CDR (LAMBDA (S) (FORCE (CDR S))))
+(DEFINE STREAM (LAMBDA ELEMENTS (LIST->STREAM ELEMENTS)))
+(DEFINE LIST->STREAM (LAMBDA (L) (IF (PAIR? L) (CONS (SYS:CAR L) (SYS:MAKE-PROMISE (QUOTE DELAY) (SYS:LAMBDA (L) () (LIST->STREAM (SYS:CDR L))))) THE-EMPTY-STREAM)))
+(DEFINE STREAM->LIST (LAMBDA (S) (REVERSE (STREAM-FOLD (SYS:LAMBDA () (X ACC) (CONS X ACC)) (QUOTE ()) S))))
+(DEFINE STREAM-HEAD (LAMBDA (S N) (IF (< N 1) (QUOTE ()) (CONS (STREAM-CAR S) (STREAM-HEAD (STREAM-CDR S) (-1+ N))))))
+(DEFINE STREAM-TAIL (LAMBDA (S N) (IF (< N 1) S (STREAM-TAIL (STREAM-CDR S) (-1+ N)))))
+(DEFINE STREAM-REF (LAMBDA (S N) (STREAM-CAR (STREAM-TAIL S N))))
+(DEFINE STREAM-MAP (LAMBDA (F S) (IF (STREAM-PAIR? S) (CONS (F (STREAM-CAR S)) (SYS:MAKE-PROMISE (QUOTE DELAY) (SYS:LAMBDA (F S) () (STREAM-MAP F (STREAM-CDR S))))) THE-EMPTY-STREAM)))
+(DEFINE STREAM-FILTER (LAMBDA (PRED S) (COND ((NOT (STREAM-PAIR? S)) THE-EMPTY-STREAM) ((PRED (STREAM-CAR S)) (CONS (STREAM-CAR S) (SYS:MAKE-PROMISE (QUOTE DELAY) (SYS:LAMBDA (PRED S) () (STREAM-FILTER PRED (STREAM-CDR S)))))) (ELSE (STREAM-FILTER PRED (STREAM-CDR S))))))
+(DEFINE STREAM-FOR-EACH (LAMBDA (F S) (IF (STREAM-PAIR? S) (BEGIN (F (STREAM-CAR S)) (STREAM-FOR-EACH F (STREAM-CDR S))))))
+(DEFINE STREAM-FOLD (LAMBDA (F ACC S) (IF (STREAM-PAIR? S) (STREAM-FOLD F (F (STREAM-CAR S) ACC) (STREAM-CDR S)) ACC)))
+(DEFINE STREAM-APPEND (LAMBDA (S1 S2) (IF (STREAM-PAIR? S1) (CONS (STREAM-CAR S1) (SYS:MAKE-PROMISE (QUOTE DELAY) (SYS:LAMBDA (S1 S2) () (STREAM-APPEND (STREAM-CDR S1) S2)))) S2)))
+(DEFINE READ-STREAM (LAMBDA (PORT) (LET ((X (READ PORT))) (IF (EOF-OBJECT? X) THE-EMPTY-STREAM (CONS X (SYS:MAKE-PROMISE (QUOTE DELAY) (SYS:LAMBDA (PORT) () (READ-STREAM PORT))))))))
+(DEFINE CALL/EC (LAMBDA (F) (LET ((TAG (LIST (QUOTE CALL/EC)))) (SYS:CATCH TAG (SYS:LAMBDA (F TAG) () (F (SYS:LAMBDA (TAG) VALS (SYS:THROW TAG VALS))))))))
+(DEFINE CALL-WITH-ESCAPE-CONTINUATION CALL/EC)
+(SYS:DEFINE-MACRO (QUOTE GUARD) (LAMBDA (SPEC . BODY) (LET ((VAR (CAR SPEC)) (CLAUSES (CDR SPEC))) (LIST (QUOTE SYS:GUARD) (LIST* (QUOTE LAMBDA) (QUOTE ()) BODY) (LIST (QUOTE LAMBDA) (LIST VAR) (CONS (QUOTE COND) (IF (AND (PAIR? CLAUSES) (EQ? (CAR (LAST CLAUSES)) (QUOTE ELSE))) CLAUSES (APPEND CLAUSES (LIST (LIST (QUOTE ELSE) (LIST (QUOTE RAISE) VAR)))))))))))
 (DEFINE *PROMPT* "> ")
 (DEFINE *DEFAULT-PROMPT* "> ")
 (DEFINE SYS:PROMPT-AND-READ (LAMBDA ARGS (DISPLAY (IF (NULL? ARGS) *DEFAULT-PROMPT* (CAR ARGS))) (READ)))
-(DEFINE SYS:TOPLEVEL (LAMBDA () (DISPLAY *PROMPT*) (LET ((INPUT (READ))) (COND ((OR (EOF-OBJECT? INPUT) (EQ? INPUT (QUOTE BYE))) (DISPLAY "Bye!") (NEWLINE)) (ELSE (WRITE (SYS:EVAL (SYS:SIMPLIFY INPUT) (QUOTE ()))) (NEWLINE) (SYS:TOPLEVEL))))))
-(DEFINE LOAD (LAMBDA (FILE) (CALL-WITH-INPUT-FILE FILE (LAMBDA (INPORT) (DISPLAY "Loading ") (WRITE FILE) (DISPLAY " ... ") (LETREC ((LOOP (LAMBDA (E) (IF (EOF-OBJECT? E) (BEGIN (DISPLAY "done.") (NEWLINE)) (BEGIN (SYS:EVAL (SYS:SIMPLIFY E) (QUOTE ())) (LOOP (READ INPORT))))))) (LOOP (READ INPORT)))))))
-(DEFINE EVAL (LAMBDA (X) (SYS:EVAL (SYS:SIMPLIFY X) (QUOTE ()))))
-(DEFINE MAP1 (LAMBDA (F XS) (IF (NULL? XS) (QUOTE ()) (CONS (F (CAR XS)) (MAP1 F (CDR XS))))))
-(DEFINE LIST* (LAMBDA ARGS (IF (NULL? ARGS) (QUOTE ()) (APPEND (BUTLAST ARGS) (LAST ARGS)))))
-(DEFINE BUTLAST (LAMBDA (L) (COND ((NULL? L) (ERROR "butlast")) ((NULL? (CDR L)) (QUOTE ())) (ELSE (CONS (CAR L) (BUTLAST (CDR L)))))))
-(DEFINE LAST (LAMBDA (L) (COND ((NULL? L) (ERROR "last")) ((NULL? (CDR L)) (CAR L)) (ELSE (LAST (CDR L))))))
-(DEFINE SYS:SIMPLIFY (LAMBDA (EXP) (COND ((BOOLEAN? EXP) EXP) ((NUMBER? EXP) EXP) ((CHAR? EXP) EXP) ((STRING? EXP) EXP) ((SYMBOL? EXP) EXP) ((PAIR? EXP) (LET ((OP (CAR EXP)) (ARGS (CDR EXP))) (COND ((EQ? OP (QUOTE QUOTE)) EXP) ((EQ? OP (QUOTE LAMBDA)) (LIST* (QUOTE LAMBDA) (CAR ARGS) (SYS:SIMPLIFY-BODY (CDR ARGS)))) ((EQ? OP (QUOTE LET)) (IF (SYMBOL? (CAR ARGS)) (LIST (QUOTE LETREC) (LIST (LIST (CAR ARGS) (LIST* (QUOTE LAMBDA) (SYS:LET-VARS (CADR ARGS)) (SYS:SIMPLIFY-BODY (CDDR ARGS))))) (LIST* (CAR ARGS) (MAP1 SYS:SIMPLIFY (SYS:LET-EXPS (CADR ARGS))))) (LIST* (QUOTE LET) (SYS:SIMPLIFY-LET-BSPECS (CAR ARGS)) (SYS:SIMPLIFY-BODY (CDR ARGS))))) ((EQ? OP (QUOTE LET*)) (SYS:SIMPLIFY-LET* (CAR ARGS) (CDR ARGS))) ((EQ? OP (QUOTE LETREC)) (LIST* (QUOTE LETREC) (SYS:SIMPLIFY-LET-BSPECS (CAR ARGS)) (SYS:SIMPLIFY-BODY (CDR ARGS)))) ((EQ? OP (QUOTE IF)) (LIST* (QUOTE IF) (MAP1 SYS:SIMPLIFY ARGS))) ((EQ? OP (QUOTE COND)) (LIST* (QUOTE COND) (MAP1 (LAMBDA (CLAUSE) (LIST* (IF (EQ? (CAR CLAUSE) (QUOTE ELSE)) (QUOTE ELSE) (SYS:SIMPLIFY (CAR CLAUSE))) (MAP1 SYS:SIMPLIFY (CDR CLAUSE)))) ARGS))) ((EQ? OP (QUOTE CASE)) (LIST* (QUOTE CASE) (SYS:SIMPLIFY (CAR ARGS)) (MAP1 (LAMBDA (CLAUSE) (LIST* (CAR CLAUSE) (MAP1 SYS:SIMPLIFY (CDR CLAUSE)))) (CDR ARGS)))) ((EQ? OP (QUOTE AND)) (LIST* (QUOTE AND) (MAP1 SYS:SIMPLIFY ARGS))) ((EQ? OP (QUOTE OR)) (LIST* (QUOTE OR) (MAP1 SYS:SIMPLIFY ARGS))) ((EQ? OP (QUOTE DO))) ((EQ? OP (QUOTE BEGIN)) (LIST* (QUOTE BEGIN) (SYS:SIMPLIFY-BODY ARGS))) ((EQ? OP (QUOTE SET!)) (LIST (QUOTE SET!) (CAR ARGS) (SYS:SIMPLIFY (CADR ARGS)))) ((EQ? OP (QUOTE DEFINE)) (IF (PAIR? (CAR ARGS)) (LIST (QUOTE DEFINE) (CAAR ARGS) (LIST* (QUOTE LAMBDA) (CDAR ARGS) (SYS:SIMPLIFY-BODY (CDR ARGS)))) (LIST (QUOTE DEFINE) (CAR ARGS) (SYS:SIMPLIFY (CADR ARGS))))) ((EQ? OP (QUOTE QUASIQUOTE)) (SYS:EXPAND-QUASIQUOTE (CAR ARGS))) (ELSE (MAP1 SYS:SIMPLIFY EXP))))) (ELSE (ERROR "Unknown expression type.")))))
-(DEFINE SYS:SIMPLIFY-LET-BSPECS (LAMBDA (BSPECS) (MAP1 (LAMBDA (BSPEC) (LIST (CAR BSPEC) (SYS:SIMPLIFY (CADR BSPEC)))) BSPECS)))
+(DEFINE SYS:TOPLEVEL (LAMBDA () (DISPLAY *PROMPT*) (LET ((INPUT (READ))) (COND ((OR (EOF-OBJECT? INPUT) (EQ? INPUT (QUOTE BYE))) (DISPLAY "Bye!") (NEWLINE)) (ELSE (WRITE (SYS:EVAL (SYS:COMPILE INPUT) (QUOTE ()))) (NEWLINE) (SYS:TOPLEVEL))))))
+(DEFINE LOAD (LAMBDA (FILE) (CALL-WITH-INPUT-FILE FILE (SYS:LAMBDA (FILE) (INPORT) (DISPLAY "Loading ") (WRITE FILE) (DISPLAY " ... ") (LET LOOP ((E (READ INPORT))) (IF (EOF-OBJECT? E) (BEGIN (DISPLAY "done.") (NEWLINE)) (BEGIN (SYS:EVAL (SYS:COMPILE E) (QUOTE ())) (LOOP (READ INPORT)))))))))
+(DEFINE EVAL (LAMBDA (X) (SYS:EVAL (SYS:COMPILE X) (QUOTE ()))))
+(DEFINE SYS:SIMPLIFY/SCHEME (LAMBDA (EXP) (COND ((BOOLEAN? EXP) EXP) ((NUMBER? EXP) EXP) ((CHAR? EXP) EXP) ((STRING? EXP) EXP) ((VECTOR? EXP) EXP) ((BYTEVECTOR? EXP) EXP) ((S32VECTOR? EXP) EXP) ((HASH-TABLE? EXP) EXP) ((MAP? EXP) EXP) ((SET? EXP) EXP) ((RECORD? EXP) EXP) ((SYMBOL? EXP) EXP) ((PAIR? EXP) (LET ((OP (SYS:CAR EXP)) (ARGS (SYS:CDR EXP))) (COND ((EQ? OP (QUOTE QUOTE)) EXP) ((EQ? OP (QUOTE LAMBDA)) (LIST* (QUOTE LAMBDA) (CAR ARGS) (SYS:SIMPLIFY-BODY (CDR ARGS)))) ((EQ? OP (QUOTE LET)) (IF (SYMBOL? (CAR ARGS)) (LIST* (QUOTE LET) (CAR ARGS) (SYS:SIMPLIFY-LET-BSPECS (CAR (CDR ARGS))) (SYS:SIMPLIFY-BODY (CDR (CDR ARGS)))) (LIST* (QUOTE LET) (SYS:SIMPLIFY-LET-BSPECS (CAR ARGS)) (SYS:SIMPLIFY-BODY (CDR ARGS))))) ((EQ? OP (QUOTE LET*)) (SYS:SIMPLIFY-LET* (CAR ARGS) (CDR ARGS))) ((EQ? OP (QUOTE LETREC)) (LIST* (QUOTE LETREC) (SYS:SIMPLIFY-LET-BSPECS (CAR ARGS)) (SYS:SIMPLIFY-BODY (CDR ARGS)))) ((EQ? OP (QUOTE IF)) (LIST* (QUOTE IF) (MAP1 SYS:SIMPLIFY/SCHEME ARGS))) ((EQ? OP (QUOTE COND)) (LIST* (QUOTE COND) (MAP1 (SYS:LAMBDA () (CLAUSE) (LIST* (IF (EQ? (CAR CLAUSE) (QUOTE ELSE)) (QUOTE ELSE) (SYS:SIMPLIFY/SCHEME (CAR CLAUSE))) (MAP1 SYS:SIMPLIFY/SCHEME (CDR CLAUSE)))) ARGS))) ((EQ? OP (QUOTE CASE)) (LIST* (QUOTE CASE) (SYS:SIMPLIFY/SCHEME (CAR ARGS)) (MAP1 (SYS:LAMBDA () (CLAUSE) (LIST* (CAR CLAUSE) (MAP1 SYS:SIMPLIFY/SCHEME (CDR CLAUSE)))) (CDR ARGS)))) ((EQ? OP (QUOTE AND)) (LIST* (QUOTE AND) (MAP1 SYS:SIMPLIFY/SCHEME ARGS))) ((EQ? OP (QUOTE OR)) (LIST* (QUOTE OR) (MAP1 SYS:SIMPLIFY/SCHEME ARGS))) ((EQ? OP (QUOTE DO)) (LIST* (QUOTE DO) (MAP1 (SYS:LAMBDA () (SPEC) (MAP1 SYS:SIMPLIFY/SCHEME SPEC)) (CAR ARGS)) (MAP1 SYS:SIMPLIFY/SCHEME (CAR (CDR ARGS))) (MAP1 SYS:SIMPLIFY/SCHEME (CDR (CDR ARGS))))) ((EQ? OP (QUOTE BEGIN)) (LIST* (QUOTE BEGIN) (SYS:SIMPLIFY-BODY ARGS))) ((EQ? OP (QUOTE SET!)) (LIST (QUOTE SET!) (CAR ARGS) (SYS:SIMPLIFY/SCHEME (CAR (CDR ARGS))))) ((EQ? OP (QUOTE DEFINE)) (IF (PAIR? (CAR ARGS)) (LIST (QUOTE DEFINE) (CAR (CAR ARGS)) (LIST* (QUOTE LAMBDA) (CDR (CAR ARGS)) (SYS:SIMPLIFY-BODY (CDR ARGS)))) (LIST (QUOTE DEFINE) (CAR ARGS) (SYS:SIMPLIFY/SCHEME (CAR (CDR ARGS)))))) ((EQ? OP (QUOTE DEFINE-MACRO)) (IF (PAIR? (CAR ARGS)) (LIST (QUOTE SYS:DEFINE-MACRO) (LIST (QUOTE QUOTE) (CAR (CAR ARGS))) (LIST* (QUOTE LAMBDA) (CDR (CAR ARGS)) (SYS:SIMPLIFY-BODY (CDR ARGS)))) (LIST (QUOTE SYS:DEFINE-MACRO) (LIST (QUOTE QUOTE) (CAR ARGS)) (SYS:SIMPLIFY/SCHEME (CAR (CDR ARGS)))))) ((OR (EQ? OP (QUOTE DELAY)) (EQ? OP (QUOTE DELAY-FORCE))) (SYS:SIMPLIFY-DELAY OP (CAR ARGS))) ((EQ? OP (QUOTE CONS-STREAM)) (LIST (QUOTE CONS) (SYS:SIMPLIFY/SCHEME (CAR ARGS)) (SYS:SIMPLIFY-DELAY (QUOTE DELAY) (CAR (CDR ARGS))))) ((EQ? OP (QUOTE QUASIQUOTE)) (SYS:EXPAND-QUASIQUOTE (CAR ARGS))) ((AND (SYMBOL? OP) (ASSQ OP SYS:*MACROS*)) (SYS:SIMPLIFY/SCHEME (SYS:MACROEXPAND EXP))) (ELSE (MAP1 SYS:SIMPLIFY/SCHEME EXP))))) (ELSE (ERROR "Unknown expression type.")))))
+(DEFINE SYS:SIMPLIFY-DELAY (LAMBDA (OP EXP) (LIST (QUOTE SYS:MAKE-PROMISE) (IF (EQ? OP (QUOTE DELAY)) (QUOTE (QUOTE DELAY)) #f) (LIST (QUOTE LAMBDA) (QUOTE ()) (SYS:SIMPLIFY/SCHEME EXP)))))
+(DEFINE SYS:SIMPLIFY-LET-BSPECS (LAMBDA (BSPECS) (MAP1 (SYS:LAMBDA () (BSPEC) (LIST (CAR BSPEC) (SYS:SIMPLIFY/SCHEME (CAR (CDR BSPEC))))) BSPECS)))
 (DEFINE SYS:LET-VARS (LAMBDA (BSPECS) (MAP1 CAR BSPECS)))
 (DEFINE SYS:LET-EXPS (LAMBDA (BSPECS) (MAP1 CADR BSPECS)))
-(DEFINE SYS:SIMPLIFY-LET* (LAMBDA (BSPECS BODY) (IF (NULL? BSPECS) (SYS:SIMPLIFY-BODY BODY) (LIST* (QUOTE LET) (LIST (LIST (CAAR BSPECS) (SYS:SIMPLIFY (CADAR BSPECS)))) (IF (NULL? (CDR BSPECS)) (SYS:SIMPLIFY-BODY BODY) (LIST (SYS:SIMPLIFY-LET* (CDR BSPECS) BODY)))))))
-(DEFINE SYS:SIMPLIFY-BODY (LAMBDA (BODY) (LETREC ((SYS:SIMPLIFY-BODY-DEFINE (LAMBDA (BODY BSPECS) (COND ((NULL? BODY) (QUOTE ())) ((AND (LIST? (CAR BODY)) (NOT (NULL? (CAR BODY))) (EQ? (CAR (CAR BODY)) (QUOTE DEFINE))) (LET ((VAR (IF (PAIR? (CADR (CAR BODY))) (CAADR (CAR BODY)) (CADR (CAR BODY)))) (EXP (IF (PAIR? (CADR (CAR BODY))) (LIST* (QUOTE LAMBDA) (CDADR (CAR BODY)) (SYS:SIMPLIFY-BODY (CDDR (CAR BODY)))) (SYS:SIMPLIFY (CADDR (CAR BODY)))))) (SYS:SIMPLIFY-BODY-DEFINE (CDR BODY) (CONS (LIST VAR EXP) BSPECS)))) (ELSE (IF (NULL? BSPECS) (SYS:SIMPLIFY-BODY-OTHERS BODY) (LIST (LIST* (QUOTE LETREC) (REVERSE BSPECS) (SYS:SIMPLIFY-BODY-OTHERS BODY)))))))) (SYS:SIMPLIFY-BODY-OTHERS (LAMBDA (BODY) (COND ((NULL? BODY) (QUOTE ())) ((AND (LIST? (CAR BODY)) (NOT (NULL? (CAR BODY))) (EQ? (CAR (CAR BODY)) (QUOTE DEFINE))) (ERROR "Invalid local define.")) (ELSE (CONS (SYS:SIMPLIFY (CAR BODY)) (SYS:SIMPLIFY-BODY-OTHERS (CDR BODY)))))))) (SYS:SIMPLIFY-BODY-DEFINE BODY (QUOTE ())))))
-(DEFINE SYS:EXPAND-QUASIQUOTE (LAMBDA (E) (COND ((AND (ATOM? E) (NOT (SYMBOL? E))) E) ((SYMBOL? E) (LIST (QUOTE QUOTE) E)) (ELSE (LETREC ((LOOP (LAMBDA (L A B) (COND ((NULL? L) (CONS (QUOTE APPEND) (REVERSE (CONS (CONS (QUOTE LIST) (REVERSE B)) A)))) (ELSE (IF (PAIR? (CAR L)) (CASE (CAAR L) ((UNQUOTE) (LOOP (CDR L) A (CONS (CADAR L) B))) ((UNQUOTE-SPLICING) (LOOP (CDR L) (CONS (CADAR L) (CONS (CONS (QUOTE LIST) (REVERSE B)) A)) (QUOTE ()))) (ELSE (LOOP (CDR L) A (CONS (SYS:EXPAND-QUASIQUOTE (CAR L)) B)))) (LOOP (CDR L) A (CONS (SYS:EXPAND-QUASIQUOTE (CAR L)) B)))))))) (LOOP E (QUOTE ()) (QUOTE ())))))))
-(DEFINE SYS:SIMPLIFY-ALL (LAMBDA (INPORT OUTPORT) (LETREC ((LOOP (LAMBDA (E) (IF (NOT (EOF-OBJECT? E)) (BEGIN (WRITE (SYS:SIMPLIFY E) OUTPORT) (NEWLINE OUTPORT) (LOOP (READ INPORT))))))) (LOOP (READ INPORT)))))
-(DEFINE SYS:SIMPLIFY-FILE (LAMBDA (INFILE OUTFILE) (CALL-WITH-INPUT-FILE INFILE (LAMBDA (INPORT) (CALL-WITH-OUTPUT-FILE OUTFILE (LAMBDA (OUTPORT) (SYS:SIMPLIFY-ALL INPORT OUTPORT)))))))
-(DEFINE SYS:MAKE-INIT (LAMBDA (OUTFILE) (DISPLAY "Making ") (DISPLAY OUTFILE) (NEWLINE) (CALL-WITH-OUTPUT-FILE OUTFILE (LAMBDA (OUTPORT) (CALL-WITH-INPUT-FILE "init-src.scm" (LAMBDA (INPORT) (SYS:SIMPLIFY-ALL INPORT OUTPORT))) (CALL-WITH-INPUT-FILE "simplify.scm" (LAMBDA (INPORT) (SYS:SIMPLIFY-ALL INPORT OUTPORT)))))))
+(DEFINE SYS:SIMPLIFY-LET* (LAMBDA (BSPECS BODY) (IF (NULL? BSPECS) (SYS:SIMPLIFY-BODY BODY) (LIST* (QUOTE LET) (LIST (LIST (CAR (CAR BSPECS)) (SYS:SIMPLIFY/SCHEME (CAR (CDR (CAR BSPECS)))))) (IF (NULL? (CDR BSPECS)) (SYS:SIMPLIFY-BODY BODY) (LIST (SYS:SIMPLIFY-LET* (CDR BSPECS) BODY)))))))
+(DEFINE SYS:SIMPLIFY-BODY (LAMBDA (BODY) (LETREC ((SYS:SIMPLIFY-BODY-DEFINE (SYS:LAMBDA (SYS:SIMPLIFY-BODY-DEFINE SYS:SIMPLIFY-BODY-OTHERS) (BODY BSPECS) (COND ((NULL? BODY) (QUOTE ())) ((AND (LIST? (CAR BODY)) (NOT (NULL? (CAR BODY))) (EQ? (CAR (CAR BODY)) (QUOTE DEFINE))) (LET ((VAR (IF (PAIR? (CAR (CDR (CAR BODY)))) (CAR (CAR (CDR (CAR BODY)))) (CAR (CDR (CAR BODY))))) (EXP (IF (PAIR? (CAR (CDR (CAR BODY)))) (LIST* (QUOTE LAMBDA) (CDR (CAR (CDR (CAR BODY)))) (SYS:SIMPLIFY-BODY (CDR (CDR (CAR BODY))))) (SYS:SIMPLIFY/SCHEME (CAR (CDR (CDR (CAR BODY)))))))) (SYS:SIMPLIFY-BODY-DEFINE (CDR BODY) (CONS (LIST VAR EXP) BSPECS)))) (ELSE (IF (NULL? BSPECS) (SYS:SIMPLIFY-BODY-OTHERS BODY) (LIST (LIST* (QUOTE LETREC) (REVERSE BSPECS) (SYS:SIMPLIFY-BODY-OTHERS BODY)))))))) (SYS:SIMPLIFY-BODY-OTHERS (SYS:LAMBDA (SYS:SIMPLIFY-BODY-OTHERS) (BODY) (COND ((NULL? BODY) (QUOTE ())) ((AND (LIST? (CAR BODY)) (NOT (NULL? (CAR BODY))) (EQ? (CAR (CAR BODY)) (QUOTE DEFINE))) (ERROR "Invalid local define.")) (ELSE (CONS (SYS:SIMPLIFY/SCHEME (CAR BODY)) (SYS:SIMPLIFY-BODY-OTHERS (CDR BODY)))))))) (SYS:SIMPLIFY-BODY-DEFINE (SYS:EXPAND-BODY BODY) (QUOTE ())))))
+(DEFINE SYS:EXPAND-BODY (LAMBDA (BODY) (LETREC ((DEFINE? (SYS:LAMBDA () (X) (AND (LIST? X) (NOT (NULL? X)) (EQ? (CAR X) (QUOTE DEFINE))))) (DEFINE-BEGIN? (SYS:LAMBDA (DEFINE? DEFINE-BEGIN?) (X) (AND (LIST? X) (PAIR? X) (EQ? (SYS:CAR X) (QUOTE BEGIN)) (PAIR? (SYS:CDR X)) (LET LOOP ((L (SYS:CDR X))) (OR (NULL? L) (LET ((D (SYS:MACROEXPAND (CAR L)))) (AND (OR (DEFINE? D) (DEFINE-BEGIN? D)) (LOOP (CDR L))))))))) (SPLICE (SYS:LAMBDA (DEFINE-BEGIN? SPLICE) (L) (COND ((NULL? L) (QUOTE ())) ((DEFINE-BEGIN? (CAR L)) (APPEND (SPLICE (CDR (CAR L))) (SPLICE (CDR L)))) (ELSE (CONS (CAR L) (SPLICE (CDR L)))))))) (LET LOOP ((L BODY) (SPLICED #f)) (IF (PAIR? L) (LOOP (SYS:CDR L) (OR (DEFINE-BEGIN? (SYS:MACROEXPAND (SYS:CAR L))) SPLICED)) (IF SPLICED (SPLICE BODY) BODY))))))
+(DEFINE SYS:EXPAND-QUASIQUOTE (LAMBDA (E) (COND ((AND (ATOM? E) (NOT (SYMBOL? E))) E) ((SYMBOL? E) (LIST (QUOTE QUOTE) E)) (ELSE (LET LOOP ((L E) (A (QUOTE ())) (B (QUOTE ()))) (COND ((NULL? L) (CONS (QUOTE APPEND) (REVERSE (CONS (CONS (QUOTE LIST) (REVERSE B)) A)))) (ELSE (IF (PAIR? (CAR L)) (CASE (CAR (CAR L)) ((UNQUOTE) (LOOP (CDR L) A (CONS (CAR (CDR (CAR L))) B))) ((UNQUOTE-SPLICING) (LOOP (CDR L) (CONS (CAR (CDR (CAR L))) (CONS (CONS (QUOTE LIST) (REVERSE B)) A)) (QUOTE ()))) (ELSE (LOOP (CDR L) A (CONS (SYS:EXPAND-QUASIQUOTE (CAR L)) B)))) (LOOP (CDR L) A (CONS (SYS:EXPAND-QUASIQUOTE (CAR L)) B))))))))))
+(DEFINE *OPTIMIZE* #t)
+(DEFINE SYS:FOLD-NUMERIC (QUOTE ((+ 2) (- 2) (* 2) (/ 2) (1+ 1) (-1+ 1) (ZERO? 1) (= 2) (< 2) (<= 2) (> 2) (>= 2))))
+(DEFINE SYS:FOLD-ANY (QUOTE ((NOT 1) (NULL? 1) (PAIR? 1) (NUMBER? 1) (BOOLEAN? 1) (CHAR? 1) (STRING? 1) (SYMBOL? 1) (VECTOR? 1) (BYTEVECTOR? 1) (S32VECTOR? 1) (FIXNUM? 1) (FLONUM? 1) (BIGNUM? 1))))
+(DEFINE SYS:INLINE-CXR (QUOTE ((CAAR CAR CAR) (CADR CAR CDR) (CDAR CDR CAR) (CDDR CDR CDR) (CAAAR CAR CAR CAR) (CAADR CAR CAR CDR) (CADAR CAR CDR CAR) (CADDR CAR CDR CDR) (CDAAR CDR CAR CAR) (CDADR CDR CAR CDR) (CDDAR CDR CDR CAR) (CDDDR CDR CDR CDR) (CAAAAR CAR CAR CAR CAR) (CAAADR CAR CAR CAR CDR) (CAADAR CAR CAR CDR CAR) (CAADDR CAR CAR CDR CDR) (CADAAR CAR CDR CAR CAR) (CADADR CAR CDR CAR CDR) (CADDAR CAR CDR CDR CAR) (CADDDR CAR CDR CDR CDR) (CDAAAR CDR CAR CAR CAR) (CDAADR CDR CAR CAR CDR) (CDADAR CDR CAR CDR CAR) (CDADDR CDR CAR CDR CDR) (CDDAAR CDR CDR CAR CAR) (CDDADR CDR CDR CAR CDR) (CDDDAR CDR CDR CDR CAR) (CDDDDR CDR CDR CDR CDR) (FIRST CAR) (SECOND CAR CDR) (THIRD CAR CDR CDR) (FOURTH CAR CDR CDR CDR))))
+(DEFINE SYS:ORIGINAL-SUBRS (LAMBDA (NAMES) (MAP1 (SYS:LAMBDA () (NAME) (CONS NAME (SYS:EVAL NAME (QUOTE ())))) NAMES)))
+(DEFINE SYS:BUILTINS (SYS:ORIGINAL-SUBRS (APPEND (QUOTE (CAR CDR)) (MAP1 CAR SYS:FOLD-NUMERIC) (MAP1 CAR SYS:FOLD-ANY) (MAP1 CAR SYS:INLINE-CXR))))
+(DEFINE SYS:BUILTIN? (LAMBDA (OP ENV) (AND (SYMBOL? OP) (NOT (ASSQ OP ENV)) (LET ((ENTRY (ASSQ OP SYS:BUILTINS))) (AND ENTRY (EQ? (SYS:EVAL OP (QUOTE ())) (CDR ENTRY)))))))
+(DEFINE SYS:LENGTH (LAMBDA (L) (IF (PAIR? L) (LENGTH L) 0)))
+(DEFINE SYS:OPTIMIZE (LAMBDA (EXP ENV) (COND ((SYMBOL? EXP) (LET ((BINDING (ASSQ EXP ENV))) (IF (AND BINDING (CDR BINDING)) (CAR (CDR BINDING)) EXP))) ((NOT (PAIR? EXP)) EXP) (ELSE (LET ((OP (SYS:CAR EXP)) (ARGS (SYS:CDR EXP))) (COND ((EQ? OP (QUOTE QUOTE)) EXP) ((EQ? OP (QUOTE LAMBDA)) (LIST* (QUOTE LAMBDA) (CAR ARGS) (SYS:OPTIMIZE-BODY (CDR ARGS) (SYS:OPT-BIND (SYS:PARAM-VARS (CAR ARGS) (QUOTE ())) ENV)))) ((EQ? OP (QUOTE LET)) (IF (SYMBOL? (CAR ARGS)) (LIST* (QUOTE LET) (CAR ARGS) (SYS:OPTIMIZE-BSPECS (CAR (CDR ARGS)) ENV) (SYS:OPTIMIZE-BODY (CDR (CDR ARGS)) (SYS:OPT-BIND (CONS (CAR ARGS) (SYS:LET-VARS (CAR (CDR ARGS)))) ENV))) (SYS:OPTIMIZE-LET (SYS:OPTIMIZE-BSPECS (CAR ARGS) ENV) (CDR ARGS) ENV))) ((EQ? OP (QUOTE LETREC)) (LET ((ENV (SYS:OPT-BIND (SYS:LET-VARS (CAR ARGS)) ENV))) (LIST* (QUOTE LETREC) (SYS:OPTIMIZE-BSPECS (CAR ARGS) ENV) (SYS:OPTIMIZE-BODY (CDR ARGS) ENV)))) ((EQ? OP (QUOTE DO)) (LET ((INNER (SYS:OPT-BIND (SYS:LET-VARS (CAR ARGS)) ENV))) (LIST* (QUOTE DO) (MAP1 (SYS:LAMBDA (ENV INNER) (SPEC) (LIST* (CAR SPEC) (SYS:OPTIMIZE (CAR (CDR SPEC)) ENV) (SYS:OPTIMIZE-LIST (CDR (CDR SPEC)) INNER))) (CAR ARGS)) (SYS:OPTIMIZE-LIST (CAR (CDR ARGS)) INNER) (SYS:OPTIMIZE-LIST (CDR (CDR ARGS)) INNER)))) ((EQ? OP (QUOTE IF)) (SYS:OPTIMIZE-IF (SYS:OPTIMIZE-LIST ARGS ENV) ENV)) ((EQ? OP (QUOTE COND)) (CONS (QUOTE COND) (SYS:OPTIMIZE-CLAUSES ARGS ENV))) ((EQ? OP (QUOTE CASE)) (LIST* (QUOTE CASE) (SYS:OPTIMIZE (CAR ARGS) ENV) (MAP1 (SYS:LAMBDA (ENV) (CLAUSE) (CONS (CAR CLAUSE) (SYS:OPTIMIZE-BODY (CDR CLAUSE) ENV))) (CDR ARGS)))) ((EQ? OP (QUOTE BEGIN)) (LET ((BODY (SYS:OPTIMIZE-BODY ARGS ENV))) (IF (AND (PAIR? BODY) (NULL? (SYS:CDR BODY))) (SYS:CAR BODY) (CONS (QUOTE BEGIN) BODY)))) ((OR (EQ? OP (QUOTE AND)) (EQ? OP (QUOTE OR))) (CONS OP (SYS:OPTIMIZE-LIST ARGS ENV))) ((OR (EQ? OP (QUOTE SET!)) (EQ? OP (QUOTE DEFINE))) (LIST OP (CAR ARGS) (SYS:OPTIMIZE (CAR (CDR ARGS)) ENV))) ((AND (PAIR? OP) (EQ? (SYS:CAR OP) (QUOTE LAMBDA)) (LIST? (CAR (SYS:CDR OP))) (= (SYS:LENGTH (CAR (SYS:CDR OP))) (SYS:LENGTH ARGS))) (SYS:OPTIMIZE-LET (SYS:OPTIMIZE-BSPECS (SYS:MAKE-BSPECS (CAR (SYS:CDR OP)) ARGS) ENV) (CDR (SYS:CDR OP)) ENV)) (ELSE (SYS:OPTIMIZE-CALL (SYS:OPTIMIZE-LIST EXP ENV) ENV))))))))
+(DEFINE SYS:OPTIMIZE-LIST (LAMBDA (EXPS ENV) (MAP1 (SYS:LAMBDA (ENV) (EXP) (SYS:OPTIMIZE EXP ENV)) EXPS)))
+(DEFINE SYS:OPTIMIZE-BODY (LAMBDA (BODY ENV) (COND ((NOT (PAIR? BODY)) BODY) ((NULL? (SYS:CDR BODY)) (LIST (SYS:OPTIMIZE (SYS:CAR BODY) ENV))) (ELSE (LET ((EXP (SYS:OPTIMIZE (SYS:CAR BODY) ENV))) (IF (SYS:PURE? EXP ENV) (SYS:OPTIMIZE-BODY (SYS:CDR BODY) ENV) (CONS EXP (SYS:OPTIMIZE-BODY (SYS:CDR BODY) ENV))))))))
+(DEFINE SYS:OPTIMIZE-BSPECS (LAMBDA (BSPECS ENV) (MAP1 (SYS:LAMBDA (ENV) (BSPEC) (LIST (CAR BSPEC) (SYS:OPTIMIZE (CAR (CDR BSPEC)) ENV))) BSPECS)))
+(DEFINE SYS:MAKE-BSPECS (LAMBDA (VARS EXPS) (IF (NULL? VARS) (QUOTE ()) (CONS (LIST (CAR VARS) (CAR EXPS)) (SYS:MAKE-BSPECS (CDR VARS) (CDR EXPS))))))
+(DEFINE SYS:OPT-BIND (LAMBDA (VARS ENV) (IF (NULL? VARS) ENV (CONS (CONS (CAR VARS) #f) (SYS:OPT-BIND (CDR VARS) ENV)))))
+(DEFINE SYS:OPTIMIZE-LET (LAMBDA (BSPECS BODY ENV) (IF (SYS:MENTIONS? (QUOTE THE-ENVIRONMENT) BODY) (LIST* (QUOTE LET) BSPECS (SYS:OPTIMIZE-BODY BODY (SYS:OPT-BIND (SYS:LET-VARS BSPECS) ENV))) (LET ((INNER (LET LOOP ((L BSPECS) (INNER ENV)) (COND ((NULL? L) INNER) ((AND (SYS:CONSTANT? (CAR (CDR (CAR L)))) (NOT (SYS:ASSIGNED? (CAR (CAR L)) BODY))) (LOOP (CDR L) (CONS (LIST (CAR (CAR L)) (CAR (CDR (CAR L)))) INNER))) (ELSE (LOOP (CDR L) (CONS (CONS (CAR (CAR L)) #f) INNER))))))) (LET ((BODY (SYS:OPTIMIZE-BODY BODY INNER))) (LET ((BSPECS (LET LOOP ((L BSPECS)) (COND ((NULL? L) (QUOTE ())) ((AND (SYS:PURE? (CAR (CDR (CAR L))) ENV) (NOT (SYS:MENTIONS? (CAR (CAR L)) BODY))) (LOOP (CDR L))) (ELSE (CONS (CAR L) (LOOP (CDR L)))))))) (COND ((PAIR? BSPECS) (LIST* (QUOTE LET) BSPECS BODY)) ((NULL? (CDR BODY)) (CAR BODY)) (ELSE (CONS (QUOTE BEGIN) BODY)))))))))
+(DEFINE SYS:OPTIMIZE-IF (LAMBDA (EXPS ENV) (LET ((TEST (CAR EXPS))) (COND ((SYS:CONSTANT? TEST) (COND ((SYS:CONSTANT-VALUE TEST) (CAR (CDR EXPS))) ((PAIR? (CDR (CDR EXPS))) (CAR (CDR (CDR EXPS)))) (ELSE (CONS (QUOTE IF) EXPS)))) ((AND (PAIR? (CDR (CDR EXPS))) (PAIR? TEST) (EQ? (SYS:CAR TEST) (QUOTE NOT)) (SYS:BUILTIN? (QUOTE NOT) ENV) (PAIR? (SYS:CDR TEST)) (NULL? (CDR (SYS:CDR TEST)))) (LIST (QUOTE IF) (CAR (SYS:CDR TEST)) (CAR (CDR (CDR EXPS))) (CAR (CDR EXPS)))) (ELSE (CONS (QUOTE IF) EXPS))))))
+(DEFINE SYS:OPTIMIZE-CLAUSES (LAMBDA (CLAUSES ENV) (IF (NULL? CLAUSES) (QUOTE ()) (LET ((CLAUSE (CAR CLAUSES))) (IF (EQ? (CAR CLAUSE) (QUOTE ELSE)) (LIST (CONS (QUOTE ELSE) (SYS:OPTIMIZE-BODY (CDR CLAUSE) ENV))) (LET ((TEST (SYS:OPTIMIZE (CAR CLAUSE) ENV))) (COND ((NOT (SYS:CONSTANT? TEST)) (CONS (CONS TEST (SYS:OPTIMIZE-LIST (CDR CLAUSE) ENV)) (SYS:OPTIMIZE-CLAUSES (CDR CLAUSES) ENV))) ((NOT (SYS:CONSTANT-VALUE TEST)) (SYS:OPTIMIZE-CLAUSES (CDR CLAUSES) ENV)) ((NULL? (CDR CLAUSE)) (LIST (LIST (QUOTE ELSE) TEST))) (ELSE (LIST (CONS (QUOTE ELSE) (SYS:OPTIMIZE-BODY (CDR CLAUSE) ENV)))))))))))
+(DEFINE SYS:OPTIMIZE-CALL (LAMBDA (EXP ENV) (LET ((OP (CAR EXP)) (ARGS (CDR EXP))) (IF (SYS:BUILTIN? OP ENV) (LET ((CXR (ASSQ OP SYS:INLINE-CXR)) (NUMERIC (ASSQ OP SYS:FOLD-NUMERIC)) (ANY (ASSQ OP SYS:FOLD-ANY))) (COND ((AND CXR (PAIR? ARGS) (NULL? (SYS:CDR ARGS)) (SYS:BUILTIN? (QUOTE CAR) ENV) (SYS:BUILTIN? (QUOTE CDR) ENV)) (LET LOOP ((OPS (CDR CXR))) (IF (NULL? OPS) (SYS:CAR ARGS) (LIST (CAR OPS) (LOOP (CDR OPS)))))) ((AND NUMERIC (= (SYS:LENGTH ARGS) (CAR (CDR NUMERIC))) (SYS:ALL? NUMBER? ARGS) (NOT (AND (EQ? OP (QUOTE /)) (= (CAR (CDR ARGS)) 0)))) (SYS:FOLD EXP)) ((AND ANY (= (SYS:LENGTH ARGS) (CAR (CDR ANY))) (SYS:ALL? SYS:CONSTANT? ARGS)) (SYS:FOLD EXP)) (ELSE EXP))) EXP))))
+(DEFINE SYS:FOLD (LAMBDA (EXP) (LET ((VALUE (SYS:EVAL EXP (QUOTE ())))) (IF (OR (PAIR? VALUE) (NULL? VALUE) (SYMBOL? VALUE)) (LIST (QUOTE QUOTE) VALUE) VALUE))))
+(DEFINE SYS:ALL? (LAMBDA (PRED L) (OR (NULL? L) (AND (PRED (CAR L)) (SYS:ALL? PRED (CDR L))))))
+(DEFINE SYS:CONSTANT? (LAMBDA (EXP) (OR (NUMBER? EXP) (BOOLEAN? EXP) (CHAR? EXP) (STRING? EXP) (VECTOR? EXP) (BYTEVECTOR? EXP) (S32VECTOR? EXP) (HASH-TABLE? EXP) (MAP? EXP) (SET? EXP) (RECORD? EXP) (AND (PAIR? EXP) (EQ? (SYS:CAR EXP) (QUOTE QUOTE))))))
+(DEFINE SYS:CONSTANT-VALUE (LAMBDA (EXP) (IF (PAIR? EXP) (CAR (SYS:CDR EXP)) EXP)))
+(DEFINE SYS:PURE? (LAMBDA (EXP ENV) (OR (SYS:CONSTANT? EXP) (AND (SYMBOL? EXP) (ASSQ EXP ENV) #t) (AND (PAIR? EXP) (EQ? (SYS:CAR EXP) (QUOTE LAMBDA))))))
+(DEFINE SYS:ASSIGNED-VARS (LAMBDA (EXP ACC) (COND ((NOT (PAIR? EXP)) ACC) ((AND (OR (EQ? (SYS:CAR EXP) (QUOTE SET!)) (EQ? (SYS:CAR EXP) (QUOTE DEFINE))) (PAIR? (SYS:CDR EXP))) (SYS:ASSIGNED-VARS (CDR (SYS:CDR EXP)) (CONS (CAR (SYS:CDR EXP)) ACC))) (ELSE (SYS:ASSIGNED-VARS (SYS:CDR EXP) (SYS:ASSIGNED-VARS (SYS:CAR EXP) ACC))))))
+(DEFINE SYS:ASSIGNED? (LAMBDA (VAR EXP) (AND (MEMQ VAR (SYS:ASSIGNED-VARS EXP (QUOTE ()))) #t)))
+(DEFINE SYS:UNCHECKED-SUBRS (QUOTE ((CAR SYS:CAR PAIR) (CDR SYS:CDR PAIR) (ZERO? SYS:ZERO? FIXNUM) (1+ SYS:1+ FIXNUM) (-1+ SYS:-1+ FIXNUM) (+ SYS:+ FIXNUM FIXNUM) (- SYS:- FIXNUM FIXNUM) (* SYS:* FIXNUM FIXNUM) (= SYS:= FIXNUM FIXNUM) (< SYS:< FIXNUM FIXNUM) (<= SYS:<= FIXNUM FIXNUM) (> SYS:> FIXNUM FIXNUM) (>= SYS:>= FIXNUM FIXNUM))))
+(DEFINE SYS:FIXNUM-VALUED-SUBRS (QUOTE (LENGTH VECTOR-LENGTH BYTEVECTOR-LENGTH BYTEVECTOR-U8-REF S32VECTOR-LENGTH S32VECTOR-REF SYS:+ SYS:- SYS:* SYS:1+ SYS:-1+)))
+(DEFINE SYS:FIXNUM-PRESERVING-SUBRS (QUOTE (+ - * / 1+ -1+)))
+(SET! SYS:BUILTINS (APPEND (SYS:ORIGINAL-SUBRS (APPEND (QUOTE (CONS LIST PAIR? FIXNUM?)) (MAP1 CAR SYS:UNCHECKED-SUBRS) SYS:FIXNUM-VALUED-SUBRS SYS:FIXNUM-PRESERVING-SUBRS)) SYS:BUILTINS))
+(DEFINE SYS:SPECIALIZE (LAMBDA (EXP TENV) (COND ((SYMBOL? EXP) (LET ((BINDING (ASSQ EXP TENV))) (IF (AND BINDING (SYS:LOOP-BINDING? BINDING)) (SET-CAR! (CDR (CDR BINDING)) (QUOTE ESCAPED))) EXP)) ((NOT (PAIR? EXP)) EXP) (ELSE (LET ((OP (SYS:CAR EXP)) (ARGS (SYS:CDR EXP))) (COND ((EQ? OP (QUOTE QUOTE)) EXP) ((EQ? OP (QUOTE LAMBDA)) (LET ((VARS (SYS:PARAM-VARS (CAR ARGS) (QUOTE ())))) (LIST* (QUOTE LAMBDA) (CAR ARGS) (SYS:SPECIALIZE-BODY (CDR ARGS) (SYS:TYPE-BIND VARS (MAP1 (SYS:LAMBDA () (V) #f) VARS) (CDR ARGS) TENV))))) ((EQ? OP (QUOTE LET)) (IF (SYMBOL? (CAR ARGS)) (SYS:SPECIALIZE-NAMED-LET (CAR ARGS) (CAR (CDR ARGS)) (CDR (CDR ARGS)) TENV) (LIST* (QUOTE LET) (SYS:SPECIALIZE-BSPECS (CAR ARGS) TENV) (SYS:SPECIALIZE-BODY (CDR ARGS) (SYS:TYPE-BIND (SYS:LET-VARS (CAR ARGS)) (SYS:TYPES-OF (SYS:LET-EXPS (CAR ARGS)) TENV) (CDR ARGS) TENV))))) ((EQ? OP (QUOTE LETREC)) (LET ((VARS (SYS:LET-VARS (CAR ARGS)))) (LET ((TENV (SYS:TYPE-BIND VARS (MAP1 (SYS:LAMBDA () (V) #f) VARS) (QUOTE ()) TENV))) (LIST* (QUOTE LETREC) (SYS:SPECIALIZE-BSPECS (CAR ARGS) TENV) (SYS:SPECIALIZE-BODY (CDR ARGS) TENV))))) ((EQ? OP (QUOTE DO)) (SYS:SPECIALIZE-DO (CAR ARGS) (CAR (CDR ARGS)) (CDR (CDR ARGS)) TENV)) ((EQ? OP (QUOTE IF)) (LET ((TEST (CAR ARGS))) (LIST* (QUOTE IF) (SYS:SPECIALIZE TEST TENV) (SYS:SPECIALIZE (CAR (CDR ARGS)) (SYS:REFINE (SYS:FACTS TEST #t TENV) TENV)) (SYS:SPECIALIZE-BODY (CDR (CDR ARGS)) (SYS:REFINE (SYS:FACTS TEST #f TENV) TENV))))) ((EQ? OP (QUOTE COND)) (CONS (QUOTE COND) (SYS:SPECIALIZE-CLAUSES ARGS TENV))) ((EQ? OP (QUOTE CASE)) (LIST* (QUOTE CASE) (SYS:SPECIALIZE (CAR ARGS) TENV) (MAP1 (SYS:LAMBDA (TENV) (CLAUSE) (CONS (CAR CLAUSE) (SYS:SPECIALIZE-BODY (CDR CLAUSE) TENV))) (CDR ARGS)))) ((OR (EQ? OP (QUOTE AND)) (EQ? OP (QUOTE OR))) (CONS OP (LET LOOP ((L ARGS) (TENV TENV)) (IF (NULL? L) (QUOTE ()) (CONS (SYS:SPECIALIZE (CAR L) TENV) (LOOP (CDR L) (SYS:REFINE (SYS:FACTS (CAR L) (EQ? OP (QUOTE AND)) TENV) TENV))))))) ((EQ? OP (QUOTE BEGIN)) (CONS (QUOTE BEGIN) (SYS:SPECIALIZE-BODY ARGS TENV))) ((OR (EQ? OP (QUOTE SET!)) (EQ? OP (QUOTE DEFINE))) (LIST OP (CAR ARGS) (SYS:SPECIALIZE (CAR (CDR ARGS)) TENV))) ((AND (SYMBOL? OP) (ASSQ OP TENV) (SYS:LOOP-BINDING? (ASSQ OP TENV))) (SYS:NOTE-LOOP-CALL (ASSQ OP TENV) ARGS TENV) (CONS OP (SYS:SPECIALIZE-BODY ARGS TENV))) (ELSE (LET ((EXP (SYS:SPECIALIZE-BODY EXP TENV)) (ENTRY (AND (SYS:BUILTIN? OP TENV) (ASSQ OP SYS:UNCHECKED-SUBRS)))) (IF (AND ENTRY (EQUAL? (CDR (CDR ENTRY)) (SYS:TYPES-OF ARGS TENV))) (CONS (CAR (CDR ENTRY)) (CDR EXP)) EXP)))))))))
+(DEFINE SYS:SPECIALIZE-BODY (LAMBDA (BODY TENV) (MAP1 (SYS:LAMBDA (TENV) (EXP) (SYS:SPECIALIZE EXP TENV)) BODY)))
+(DEFINE SYS:SPECIALIZE-BSPECS (LAMBDA (BSPECS TENV) (MAP1 (SYS:LAMBDA (TENV) (BSPEC) (CONS (CAR BSPEC) (SYS:SPECIALIZE-BODY (CDR BSPEC) TENV))) BSPECS)))
+(DEFINE SYS:SPECIALIZE-CLAUSES (LAMBDA (CLAUSES TENV) (IF (NULL? CLAUSES) (QUOTE ()) (LET ((CLAUSE (CAR CLAUSES))) (IF (EQ? (CAR CLAUSE) (QUOTE ELSE)) (LIST (CONS (QUOTE ELSE) (SYS:SPECIALIZE-BODY (CDR CLAUSE) TENV))) (CONS (CONS (SYS:SPECIALIZE (CAR CLAUSE) TENV) (SYS:SPECIALIZE-BODY (CDR CLAUSE) (SYS:REFINE (SYS:FACTS (CAR CLAUSE) #t TENV) TENV))) (SYS:SPECIALIZE-CLAUSES (CDR CLAUSES) (SYS:REFINE (SYS:FACTS (CAR CLAUSE) #f TENV) TENV))))))))
+(DEFINE SYS:SPECIALIZE-NAMED-LET (LAMBDA (NAME BSPECS BODY TENV) (LET ((VARS (SYS:LET-VARS BSPECS)) (OUTER (SYS:TYPES-OF (SYS:LET-EXPS BSPECS) TENV))) (LET LOOP ((TYPES (IF (SYS:ASSIGNED? NAME BODY) (MAP1 (SYS:LAMBDA () (V) #f) VARS) OUTER))) (LET ((RECORD (LIST NAME (QUOTE *LOOP*) TYPES))) (LET ((BODY1 (SYS:SPECIALIZE-BODY BODY (SYS:TYPE-BIND VARS TYPES BODY (CONS RECORD TENV))))) (LET ((FOUND (CAR (CDR (SYS:CDR RECORD))))) (COND ((OR (EQUAL? FOUND TYPES) (AND (EQ? FOUND (QUOTE ESCAPED)) (SYS:ALL? NOT TYPES))) (LIST* (QUOTE LET) NAME (SYS:SPECIALIZE-BSPECS BSPECS TENV) BODY1)) ((EQ? FOUND (QUOTE ESCAPED)) (LOOP (MAP1 (SYS:LAMBDA () (V) #f) VARS))) (ELSE (LOOP FOUND))))))))))
+(DEFINE SYS:SPECIALIZE-DO (LAMBDA (SPECS TEST-CLAUSE COMMANDS TENV) (LET ((VARS (SYS:LET-VARS SPECS)) (LOOP-BODY (LIST TEST-CLAUSE COMMANDS (MAP1 CDDR SPECS)))) (LET LOOP ((TYPES (SYS:TYPES-OF (SYS:LET-EXPS SPECS) TENV))) (LET ((INNER (SYS:TYPE-BIND VARS TYPES LOOP-BODY TENV))) (LET ((RUNNING (SYS:REFINE (SYS:FACTS (CAR TEST-CLAUSE) #f INNER) INNER))) (LET ((FOUND (SYS:MAP2 (SYS:LAMBDA (RUNNING) (SPEC TYPE) (IF (PAIR? (CDR (CDR SPEC))) (SYS:TYPE-JOIN TYPE (SYS:TYPE-OF (CAR (CDR (CDR SPEC))) RUNNING)) TYPE)) SPECS TYPES))) (IF (EQUAL? FOUND TYPES) (LIST* (QUOTE DO) (MAP1 (SYS:LAMBDA (TENV RUNNING) (SPEC) (LIST* (CAR SPEC) (SYS:SPECIALIZE (CAR (CDR SPEC)) TENV) (SYS:SPECIALIZE-BODY (CDR (CDR SPEC)) RUNNING))) SPECS) (CONS (SYS:SPECIALIZE (CAR TEST-CLAUSE) INNER) (SYS:SPECIALIZE-BODY (CDR TEST-CLAUSE) (SYS:REFINE (SYS:FACTS (CAR TEST-CLAUSE) #t INNER) INNER))) (SYS:SPECIALIZE-BODY COMMANDS RUNNING)) (LOOP FOUND)))))))))
+(DEFINE SYS:LOOP-BINDING? (LAMBDA (BINDING) (AND (PAIR? (CDR BINDING)) (EQ? (CAR (CDR BINDING)) (QUOTE *LOOP*)))))
+(DEFINE SYS:NOTE-LOOP-CALL (LAMBDA (BINDING ARGS TENV) (LET ((TYPES (CAR (CDR (CDR BINDING))))) (IF (NOT (EQ? TYPES (QUOTE ESCAPED))) (SET-CAR! (CDR (CDR BINDING)) (IF (= (SYS:LENGTH ARGS) (SYS:LENGTH TYPES)) (SYS:MAP2 SYS:TYPE-JOIN TYPES (SYS:TYPES-OF ARGS TENV)) (QUOTE ESCAPED)))))))
+(DEFINE SYS:TYPE-BIND (LAMBDA (VARS TYPES BODY TENV) (IF (NULL? VARS) TENV (LET LOOP ((VARS VARS) (TYPES TYPES) (ASSIGNED (SYS:ASSIGNED-VARS BODY (QUOTE ())))) (IF (NULL? VARS) TENV (CONS (CONS (CAR VARS) (IF (MEMQ (CAR VARS) ASSIGNED) (QUOTE SET!) (CAR TYPES))) (LOOP (CDR VARS) (CDR TYPES) ASSIGNED)))))))
+(DEFINE SYS:MAP2 (LAMBDA (F XS YS) (IF (NULL? XS) (QUOTE ()) (CONS (F (CAR XS) (CAR YS)) (SYS:MAP2 F (CDR XS) (CDR YS))))))
+(DEFINE SYS:TYPE-JOIN (LAMBDA (T1 T2) (AND (EQ? T1 T2) T1)))
+(DEFINE SYS:TYPES-OF (LAMBDA (EXPS TENV) (MAP1 (SYS:LAMBDA (TENV) (EXP) (SYS:TYPE-OF EXP TENV)) EXPS)))
+(DEFINE SYS:TYPE-OF (LAMBDA (EXP TENV) (COND ((NUMBER? EXP) (AND (FIXNUM? EXP) (QUOTE FIXNUM))) ((SYMBOL? EXP) (LET ((BINDING (ASSQ EXP TENV))) (AND BINDING (MEMQ (CDR BINDING) (QUOTE (FIXNUM PAIR))) (CDR BINDING)))) ((NOT (PAIR? EXP)) #f) ((EQ? (SYS:CAR EXP) (QUOTE QUOTE)) (COND ((PAIR? (CAR (SYS:CDR EXP))) (QUOTE PAIR)) ((FIXNUM? (CAR (SYS:CDR EXP))) (QUOTE FIXNUM)) (ELSE #f))) ((EQ? (SYS:CAR EXP) (QUOTE IF)) (AND (PAIR? (CDR (SYS:CDR EXP))) (PAIR? (CDR (CDR (SYS:CDR EXP)))) (SYS:TYPE-JOIN (SYS:TYPE-OF (CAR (CDR (SYS:CDR EXP))) TENV) (SYS:TYPE-OF (CAR (CDR (CDR (SYS:CDR EXP)))) TENV)))) ((SYS:BUILTIN? (SYS:CAR EXP) TENV) (COND ((MEMQ (SYS:CAR EXP) SYS:FIXNUM-VALUED-SUBRS) (QUOTE FIXNUM)) ((MEMQ (SYS:CAR EXP) SYS:FIXNUM-PRESERVING-SUBRS) (AND (SYS:ALL? (SYS:LAMBDA () (TYPE) (EQ? TYPE (QUOTE FIXNUM))) (SYS:TYPES-OF (SYS:CDR EXP) TENV)) (QUOTE FIXNUM))) ((EQ? (SYS:CAR EXP) (QUOTE CONS)) (QUOTE PAIR)) ((AND (EQ? (SYS:CAR EXP) (QUOTE LIST)) (PAIR? (SYS:CDR EXP))) (QUOTE PAIR)) (ELSE #f))) (ELSE #f))))
+(DEFINE SYS:FACTS (LAMBDA (TEST WHEN TENV) (IF (PAIR? TEST) (LET ((OP (SYS:CAR TEST)) (ARGS (SYS:CDR TEST))) (COND ((AND (EQ? OP (QUOTE NOT)) (SYS:BUILTIN? OP TENV)) (SYS:FACTS (CAR ARGS) (NOT WHEN) TENV)) ((AND WHEN (EQ? OP (QUOTE AND))) (SYS:FACTS-OF-ALL ARGS #t TENV)) ((AND (NOT WHEN) (EQ? OP (QUOTE OR))) (SYS:FACTS-OF-ALL ARGS #f TENV)) ((AND WHEN (MEMQ OP (QUOTE (PAIR? FIXNUM?))) (SYS:BUILTIN? OP TENV) (SYMBOL? (CAR ARGS))) (LIST (CONS (CAR ARGS) (IF (EQ? OP (QUOTE PAIR?)) (QUOTE PAIR) (QUOTE FIXNUM))))) (ELSE (QUOTE ())))) (QUOTE ()))))
+(DEFINE SYS:FACTS-OF-ALL (LAMBDA (TESTS WHEN TENV) (IF (NULL? TESTS) (QUOTE ()) (APPEND (SYS:FACTS (CAR TESTS) WHEN TENV) (SYS:FACTS-OF-ALL (CDR TESTS) WHEN TENV)))))
+(DEFINE SYS:REFINE (LAMBDA (FACTS TENV) (COND ((NULL? FACTS) TENV) ((LET ((BINDING (ASSQ (CAR (CAR FACTS)) TENV))) (AND BINDING (NOT (EQ? (CDR BINDING) (QUOTE SET!))) (NOT (SYS:LOOP-BINDING? BINDING)))) (CONS (CAR FACTS) (SYS:REFINE (CDR FACTS) TENV))) (ELSE (SYS:REFINE (CDR FACTS) TENV)))))
+(DEFINE SYS:COMPILE (LAMBDA (EXP) (SYS:CLOSE-LAMBDAS (IF *OPTIMIZE* (SYS:SPECIALIZE (SYS:OPTIMIZE (SYS:SIMPLIFY EXP) (QUOTE ())) (QUOTE ())) (SYS:SIMPLIFY EXP)) (QUOTE ()))))
+(DEFINE SYS:CLOSE-LAMBDAS (LAMBDA (EXP SCOPE) (IF (PAIR? EXP) (LET ((OP (SYS:CAR EXP)) (ARGS (SYS:CDR EXP))) (COND ((OR (EQ? OP (QUOTE QUOTE)) (EQ? OP (QUOTE SYS:LAMBDA))) EXP) ((EQ? OP (QUOTE LAMBDA)) (LET ((BODY (SYS:CLOSE-LAMBDAS-BODY (CDR ARGS) (SYS:PARAM-VARS (CAR ARGS) SCOPE)))) (IF (OR (NULL? SCOPE) (SYS:MENTIONS? (QUOTE THE-ENVIRONMENT) BODY)) (LIST* (QUOTE LAMBDA) (CAR ARGS) BODY) (LIST* (QUOTE SYS:LAMBDA) (SYS:FREE-VARS-IN (LIST* (QUOTE LAMBDA) (CAR ARGS) BODY) SCOPE) (CAR ARGS) BODY)))) ((EQ? OP (QUOTE LET)) (IF (SYMBOL? (CAR ARGS)) (LIST* (QUOTE LET) (CAR ARGS) (SYS:CLOSE-LAMBDAS-BSPECS (CAR (CDR ARGS)) SCOPE) (SYS:CLOSE-LAMBDAS-BODY (CDR (CDR ARGS)) (CONS (CAR ARGS) (APPEND (SYS:LET-VARS (CAR (CDR ARGS))) SCOPE)))) (LIST* (QUOTE LET) (SYS:CLOSE-LAMBDAS-BSPECS (CAR ARGS) SCOPE) (SYS:CLOSE-LAMBDAS-BODY (CDR ARGS) (APPEND (SYS:LET-VARS (CAR ARGS)) SCOPE))))) ((EQ? OP (QUOTE LETREC)) (LET ((SCOPE (APPEND (SYS:LET-VARS (CAR ARGS)) SCOPE))) (LIST* (QUOTE LETREC) (SYS:CLOSE-LAMBDAS-BSPECS (CAR ARGS) SCOPE) (SYS:CLOSE-LAMBDAS-BODY (CDR ARGS) SCOPE)))) ((EQ? OP (QUOTE DO)) (LET ((INNER (APPEND (SYS:LET-VARS (CAR ARGS)) SCOPE))) (LIST* (QUOTE DO) (MAP1 (SYS:LAMBDA (SCOPE INNER) (SPEC) (LIST* (CAR SPEC) (SYS:CLOSE-LAMBDAS (CAR (CDR SPEC)) SCOPE) (SYS:CLOSE-LAMBDAS-BODY (CDR (CDR SPEC)) INNER))) (CAR ARGS)) (SYS:CLOSE-LAMBDAS-BODY (CAR (CDR ARGS)) INNER) (SYS:CLOSE-LAMBDAS-BODY (CDR (CDR ARGS)) INNER)))) ((EQ? OP (QUOTE COND)) (LIST* (QUOTE COND) (MAP1 (SYS:LAMBDA (SCOPE) (CLAUSE) (IF (EQ? (CAR CLAUSE) (QUOTE ELSE)) (CONS (QUOTE ELSE) (SYS:CLOSE-LAMBDAS-BODY (CDR CLAUSE) SCOPE)) (SYS:CLOSE-LAMBDAS-BODY CLAUSE SCOPE))) ARGS))) ((EQ? OP (QUOTE CASE)) (LIST* (QUOTE CASE) (SYS:CLOSE-LAMBDAS (CAR ARGS) SCOPE) (MAP1 (SYS:LAMBDA (SCOPE) (CLAUSE) (CONS (CAR CLAUSE) (SYS:CLOSE-LAMBDAS-BODY (CDR CLAUSE) SCOPE))) (CDR ARGS)))) ((OR (EQ? OP (QUOTE SET!)) (EQ? OP (QUOTE DEFINE))) (LIST OP (CAR ARGS) (SYS:CLOSE-LAMBDAS (CAR (CDR ARGS)) SCOPE))) (ELSE (SYS:CLOSE-LAMBDAS-BODY EXP SCOPE)))) EXP)))
+(DEFINE SYS:CLOSE-LAMBDAS-BODY (LAMBDA (BODY SCOPE) (MAP1 (SYS:LAMBDA (SCOPE) (EXP) (SYS:CLOSE-LAMBDAS EXP SCOPE)) BODY)))
+(DEFINE SYS:CLOSE-LAMBDAS-BSPECS (LAMBDA (BSPECS SCOPE) (MAP1 (SYS:LAMBDA (SCOPE) (BSPEC) (CONS (CAR BSPEC) (SYS:CLOSE-LAMBDAS-BODY (CDR BSPEC) SCOPE))) BSPECS)))
+(DEFINE SYS:PARAM-VARS (LAMBDA (PARAMS VARS) (COND ((NULL? PARAMS) VARS) ((SYMBOL? PARAMS) (CONS PARAMS VARS)) (ELSE (CONS (CAR PARAMS) (SYS:PARAM-VARS (CDR PARAMS) VARS))))))
+(DEFINE SYS:MENTIONS? (LAMBDA (SYM TREE) (COND ((EQ? SYM TREE) #t) ((PAIR? TREE) (OR (SYS:MENTIONS? SYM (SYS:CAR TREE)) (SYS:MENTIONS? SYM (SYS:CDR TREE)))) (ELSE #f))))
+(DEFINE SYS:FREE-VARS-IN (LAMBDA (EXP SCOPE) (LET LOOP ((VARS (SYS:FREE-VARS EXP (QUOTE ()) (QUOTE ()))) (ACC (QUOTE ()))) (COND ((NULL? VARS) ACC) ((MEMQ (CAR VARS) SCOPE) (LOOP (CDR VARS) (CONS (CAR VARS) ACC))) (ELSE (LOOP (CDR VARS) ACC))))))
+(DEFINE SYS:FREE-VARS (LAMBDA (EXP BOUND ACC) (COND ((SYMBOL? EXP) (IF (OR (MEMQ EXP BOUND) (MEMQ EXP ACC)) ACC (CONS EXP ACC))) ((NOT (PAIR? EXP)) ACC) (ELSE (LET ((OP (SYS:CAR EXP)) (ARGS (SYS:CDR EXP))) (COND ((EQ? OP (QUOTE QUOTE)) ACC) ((EQ? OP (QUOTE LAMBDA)) (SYS:FREE-VARS-BODY (CDR ARGS) (SYS:PARAM-VARS (CAR ARGS) BOUND) ACC)) ((EQ? OP (QUOTE SYS:LAMBDA)) (SYS:FREE-VARS-BODY (CAR ARGS) BOUND ACC)) ((AND (EQ? OP (QUOTE LET)) (SYMBOL? (CAR ARGS))) (SYS:FREE-VARS-BODY (CDR (CDR ARGS)) (CONS (CAR ARGS) (APPEND (SYS:LET-VARS (CAR (CDR ARGS))) BOUND)) (SYS:FREE-VARS-BODY (SYS:LET-EXPS (CAR (CDR ARGS))) BOUND ACC))) ((EQ? OP (QUOTE LET)) (SYS:FREE-VARS-BODY (CDR ARGS) (APPEND (SYS:LET-VARS (CAR ARGS)) BOUND) (SYS:FREE-VARS-BODY (SYS:LET-EXPS (CAR ARGS)) BOUND ACC))) ((EQ? OP (QUOTE LETREC)) (LET ((BOUND (APPEND (SYS:LET-VARS (CAR ARGS)) BOUND))) (SYS:FREE-VARS-BODY (CDR ARGS) BOUND (SYS:FREE-VARS-BODY (SYS:LET-EXPS (CAR ARGS)) BOUND ACC)))) ((EQ? OP (QUOTE DO)) (LET ((INNER (APPEND (SYS:LET-VARS (CAR ARGS)) BOUND))) (SYS:FREE-VARS-BODY (APPEND (MAP1 CDDR (CAR ARGS)) (CDR ARGS)) INNER (SYS:FREE-VARS-BODY (SYS:LET-EXPS (CAR ARGS)) BOUND ACC)))) ((EQ? OP (QUOTE COND)) (SYS:FREE-VARS-BODY (MAP1 (SYS:LAMBDA () (CLAUSE) (IF (EQ? (CAR CLAUSE) (QUOTE ELSE)) (CONS (QUOTE BEGIN) (CDR CLAUSE)) (CONS (QUOTE BEGIN) CLAUSE))) ARGS) BOUND ACC)) ((EQ? OP (QUOTE CASE)) (SYS:FREE-VARS-BODY (MAP1 (SYS:LAMBDA () (CLAUSE) (CONS (QUOTE BEGIN) (CDR CLAUSE))) (CDR ARGS)) BOUND (SYS:FREE-VARS (CAR ARGS) BOUND ACC))) (ELSE (SYS:FREE-VARS-BODY EXP BOUND ACC))))))))
+(DEFINE SYS:FREE-VARS-BODY (LAMBDA (BODY BOUND ACC) (IF (PAIR? BODY) (SYS:FREE-VARS-BODY (SYS:CDR BODY) BOUND (SYS:FREE-VARS (SYS:CAR BODY) BOUND ACC)) ACC)))
+(DEFINE SYS:SIMPLIFY-ALL (LAMBDA (INPORT OUTPORT) (LET LOOP ((E (READ INPORT))) (IF (NOT (EOF-OBJECT? E)) (BEGIN (WRITE (SYS:COMPILE E) OUTPORT) (NEWLINE OUTPORT) (LOOP (READ INPORT)))))))
+(DEFINE SYS:SIMPLIFY-FILE (LAMBDA (INFILE OUTFILE) (CALL-WITH-INPUT-FILE INFILE (SYS:LAMBDA (OUTFILE) (INPORT) (CALL-WITH-OUTPUT-FILE OUTFILE (SYS:LAMBDA (INPORT) (OUTPORT) (SYS:SIMPLIFY-ALL INPORT OUTPORT)))))))
+(DEFINE SYS:MAKE-INIT (LAMBDA (OUTFILE) (DISPLAY "Making ") (DISPLAY OUTFILE) (NEWLINE) (CALL-WITH-OUTPUT-FILE OUTFILE (SYS:LAMBDA () (OUTPORT) (CALL-WITH-INPUT-FILE "init-src.scm" (SYS:LAMBDA (OUTPORT) (INPORT) (SYS:SIMPLIFY-ALL INPORT OUTPORT))) (CALL-WITH-INPUT-FILE "simplify.scm" (SYS:LAMBDA (OUTPORT) (INPORT) (SYS:SIMPLIFY-ALL INPORT OUTPORT)))))))
@@ -24,12 +24,16 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include <setjmp.h>
 
 #include "tscheme.h"
 
 static void do_write(SCM x, FILE *fp, int displayp);
 static void do_write_pair(SCM x, FILE *fp, int displayp);
+static void do_write_vector(SCM x, FILE *fp, int displayp);
+static void do_write_numvec(SCM x, FILE *fp);
 
 SCM s_open_input_file(SCM file) {
     SCM port;
@@ -38,7 +42,7 @@ SCM s_open_input_file(SCM file) {
     if (!IS_STRING(file))
         wta_error("open-input-file", 1);
 
-    if ((fp = fopen(STR_DATA(file), "r"))) {
+    if ((fp = fopen(string_cstring(file), "r"))) {
         NEWCELL(port, T_PORT);
         PORT_NAME(port) = STR_DATA(file);
         PORT_FPTR(port) = fp;
@@ -57,7 +61,7 @@ SCM s_open_output_file(SCM file) {
     if (!IS_STRING(file))
         wta_error("open-output-file", 1);
 
-    if ((fp = fopen(STR_DATA(file), "w"))) {
+    if ((fp = fopen(string_cstring(file), "w"))) {
         NEWCELL(port, T_PORT);
         PORT_NAME(port) = STR_DATA(file);
         PORT_FPTR(port) = fp;
@@ -72,14 +76,20 @@ SCM s_open_output_file(SCM file) {
 SCM s_close_input_port(SCM port) {
     if (!IS_PORT(port))
         wta_error("close-input-port", 1);
-    fclose(PORT_FPTR(port));
+    if (PORT_FPTR(port) != NULL) {
+        fclose(PORT_FPTR(port));
+        PORT_FPTR(port) = NULL;
+    }
     return unspecified_value;
 }
 
 SCM s_close_output_port(SCM port) {
     if (!IS_PORT(port))
         wta_error("close-output-port", 1);
-    fclose(PORT_FPTR(port));
+    if (PORT_FPTR(port) != NULL) {
+        fclose(PORT_FPTR(port));
+        PORT_FPTR(port) = NULL;
+    }
     return unspecified_value;
 }
 
@@ -106,6 +116,8 @@ SCM n_newline(SCM args) {
         port = FIRST(args);
         if (!IS_PORT(port))
             wta_error("newline", 1);
+        if (PORT_FPTR(port) == NULL)
+            error1("Port %s is closed\n", PORT_NAME(port));
         fputc('\n', PORT_FPTR(port));
     }
     return unspecified_value;
@@ -121,7 +133,8 @@ SCM scm_write(SCM data, SCM port, int displayp) {
     FILE *fp;
     if (!IS_TYPE(port, T_PORT))
         wta_error((displayp ? "display" : "write"), 2);
-    fp = PORT_FPTR(port);
+    if ((fp = PORT_FPTR(port)) == NULL)
+        error1("Port %s is closed\n", PORT_NAME(port));
     do_write(data, fp, displayp);
     return unspecified_value;
 }
@@ -130,7 +143,7 @@ SCM s_load(SCM file) {
     if (!IS_STRING(file))
         wta_error("load", 1);
 
-    do_load(STR_DATA(file));
+    do_load(string_cstring(file));
     return unspecified_value;
 }
 
@@ -169,6 +182,18 @@ static void do_write(SCM x, FILE *fp, int displayp) {
     case T_FIXNUM:
         fprintf(fp, "%d", FIXNUM(x));
         break;
+    case T_BIGNUM: {
+        char *s = integer_to_string(x);
+        fputs(s, fp);
+        free(s);
+        break;
+    }
+    case T_FLONUM: {
+        char buf[FLONUM_BUF_SIZE];
+        format_flonum(buf, FLONUM(x));
+        fputs(buf, fp);
+        break;
+    }
     case T_BOOLEAN:
         if (EQ(x, boolean_true))
             fprintf(fp, "#t");
@@ -190,7 +215,8 @@ static void do_write(SCM x, FILE *fp, int displayp) {
         fprintf(fp, "%s", STR_DATA(SYM_PNAME(x)));
         break;
     case T_STRING:
-        fprintf(fp, (displayp ? "%s" : "\"%s\""), STR_DATA(x));
+        fprintf(fp, (displayp ? "%.*s" : "\"%.*s\""), (int)STR_DIM(x),
+                STR_DATA(x));
         break;
     case T_SUBR0:
     case T_SUBR1:
@@ -214,6 +240,36 @@ static void do_write(SCM x, FILE *fp, int displayp) {
     case T_EOF_VALUE:
         fprintf(fp, "#<eof>");
         break;
+    case T_PROMISE:
+        fprintf(fp, "#<promise %x>", (unsigned)x);
+        break;
+    case T_HASHTABLE:
+        fprintf(fp, "#<hash-table %x>", (unsigned)x);
+        break;
+    case T_MAP:
+        fprintf(fp, "#<map %ld>", MAP_COUNT(x));
+        break;
+    case T_SET:
+        fprintf(fp, "#<set %ld>", MAP_COUNT(x));
+        break;
+    case T_RECORD_TYPE:
+        fprintf(fp, "#<record-type %s>", STR_DATA(SYM_PNAME(RTD_NAME(x))));
+        break;
+    case T_RECORD:
+        fprintf(fp, "#<%s %x>", STR_DATA(SYM_PNAME(RTD_NAME(RECORD_RTD(x)))),
+                (unsigned)x);
+        break;
+    case T_RECORD_PROC:
+        fprintf(fp, "#<record-procedure %s>",
+                STR_DATA(SYM_PNAME(RECPROC_NAME(x))));
+        break;
+    case T_VECTOR:
+        do_write_vector(x, fp, displayp);
+        break;
+    case T_BYTEVECTOR:
+    case T_S32VECTOR:
+        do_write_numvec(x, fp);
+        break;
     case T_FREE_CELL:
         error0("Why free-cell comes here?");
         break;
@@ -244,6 +300,60 @@ static void do_write_pair(SCM x, FILE *fp, int displayp) {
     }
 }
 
+static void do_write_vector(SCM x, FILE *fp, int displayp) {
+    long i;
+    fputs("#(", fp);
+    for (i = 0; i < VECTOR_DIM(x); i++) {
+        if (i > 0)
+            fputc(' ', fp);
+        do_write(VECTOR_DATA(x)[i], fp, displayp);
+    }
+    fputc(')', fp);
+}
+
+static void do_write_numvec(SCM x, FILE *fp) {
+    long i;
+    fputs(IS_BYTEVECTOR(x) ? "#u8(" : "#s32(", fp);
+    for (i = 0; i < NUMVEC_DIM(x); i++) {
+        if (i > 0)
+            fputc(' ', fp);
+        fprintf(fp, "%d", IS_BYTEVECTOR(x) ? U8_DATA(x)[i] : S32_DATA(x)[i]);
+    }
+    fputc(')', fp);
+}
+
+/* Writes D into BUF with the fewest digits that read back as D, in
+   positional notation unless its exponent is large, and keeping a
+   decimal point so that it reads back as a flonum */
+void format_flonum(char *buf, double d) {
+    int prec, exp10;
+    char *e;
+
+    if (isnan(d)) {
+        strcpy(buf, "+nan.0");
+        return;
+    }
+    if (isinf(d)) {
+        strcpy(buf, d > 0 ? "+inf.0" : "-inf.0");
+        return;
+    }
+    for (prec = 0; prec < 16; prec++) {
+        sprintf(buf, "%.*e", prec, d);
+        if (strtod(buf, NULL) == d)
+            break;
+    }
+    sprintf(buf, "%.*e", prec, d);
+    e = strchr(buf, 'e');
+    exp10 = atoi(e + 1);
+    if (exp10 < -7 || exp10 >= 21) {
+        sprintf(e, "e%d", exp10);
+        return;
+    }
+    sprintf(buf, "%.*f", prec > exp10 ? prec - exp10 : 0, d);
+    if (strchr(buf, '.') == NULL)
+        strcat(buf, ".0");
+}
+
 SCM s_show_obarray(void) {
     int i;
     for (i = 0; i < obarray_dim; i++) {
@@ -261,13 +371,15 @@ void init_io_subrs(void) {
     mk_subr("OPEN-OUTPUT-FILE", (SCM (*)(void))s_open_output_file, 1);
     mk_subr("CLOSE-INPUT-PORT", (SCM (*)(void))s_close_input_port, 1);
     mk_subr("CLOSE-OUTPUT-PORT", (SCM (*)(void))s_close_output_port, 1);
-    mk_subr("WRITE", (SCM (*)(void))n_write, -1);
-    mk_subr("DISPLAY", (SCM (*)(void))n_display, -1);
-    mk_subr("NEWLINE", (SCM (*)(void))n_newline, -1);
+    SET_FLAG(mk_subr("WRITE", (SCM (*)(void))n_write, -1), FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("DISPLAY", (SCM (*)(void))n_display, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("NEWLINE", (SCM (*)(void))n_newline, -1),
+             FLAG_STACK_ARGS);
     mk_subr("EOF-OBJECT?", (SCM (*)(void))s_eof_objectp, 1);
     mk_subr("LOAD", (SCM (*)(void))s_load, 1);
     mk_subr("SHOW-OBARRAY", (SCM (*)(void))s_show_obarray, 0);
 
     /* For now, the following function is defined in a separate file */
-    mk_subr("READ", (SCM (*)(void))n_read, -1);
+    SET_FLAG(mk_subr("READ", (SCM (*)(void))n_read, -1), FLAG_STACK_ARGS);
 }
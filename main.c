@@ -39,13 +39,14 @@
 static char *init_file = INIT_FILE;
 static bool init_loaded = false;
 
+/* The interrupt is handled at the next safe point of the evaluator
+   (see eval.c). */
 void interrupt_handler(int sig) {
-    fprintf(stderr, "Interrupted\n");
-    longjmp(error_return, NON_FATAL);
+    request_interrupt();
 }
 
 void usage(char *me) {
-    fprintf(stderr, "usage: %s [-i init_file]\n", me);
+    fprintf(stderr, "usage: %s [-s] [-h num_cells] [-i init_file]\n", me);
     exit(EXIT_FAILURE);
 }
 
@@ -53,12 +54,20 @@ int main(int argc, char *argv[]) {
     int ch;
     SCM start;
     char *me = argv[0];
+    long heap_size = DEFAULT_NUMCELLS;
 
-    while ((ch = getopt(argc, argv, "i:")) != -1) {
+    while ((ch = getopt(argc, argv, "sh:i:")) != -1) {
         switch (ch) {
         case 'i':
             init_file = optarg;
             break;
+        case 's':
+            stack_eval_mode = YES;
+            break;
+        case 'h':
+            if ((heap_size = atol(optarg)) <= 0)
+                usage(me);
+            break;
         default:
             usage(me);
         }
@@ -68,9 +77,19 @@ int main(int argc, char *argv[]) {
 
     stack_start = (SCM)&start;
 
-    init_storage(DEFAULT_NUMCELLS);
+    init_storage((unsigned)heap_size);
     init_subrs();
     init_io_subrs();
+    init_simplify_subrs();
+    init_error_subrs();
+    init_vector_subrs();
+    init_bytevector_subrs();
+    init_hashtable_subrs();
+    init_hamt_subrs();
+    init_record_subrs();
+    init_sort_subrs();
+    init_string_subrs();
+    init_eval();
 
     printf(BANNER);
 
@@ -78,6 +97,9 @@ int main(int argc, char *argv[]) {
     case FATAL:
         exit(EXIT_FAILURE);
     case NON_FATAL:
+        reset_eval_stack();
+        reset_handlers();
+        set_eval_deadline(NO_DEADLINE);
         if (!init_loaded) {
             fprintf(stderr, "Error in init file.\n");
             exit(EXIT_FAILURE);
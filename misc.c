@@ -36,6 +36,13 @@ int memq(SCM key, SCM list) {
     }
     return 0;
 }
+
+int memv(SCM key, SCM list) {
+    for (; IS_PAIR(list); list = CDR(list))
+        if (eqv(key, CAR(list)))
+            return 1;
+    return 0;
+}
     
 SCM map1(SCM (*f)(SCM), SCM list) {
     SCM l = list;
@@ -44,10 +51,11 @@ SCM map1(SCM (*f)(SCM), SCM list) {
         p = CONS(f(CAR(l)), NIL);
         h = p;
         l = CDR(l);
-        while (!IS_NULL(l)) {
+        while (IS_PAIR(l)) {
             SCM n = CONS(f(CAR(l)), NIL);
             CDR(p) = n;
             p = n;
+            l = CDR(l);
         }
         return h;
     }
@@ -41,15 +41,51 @@ SCM mk_pair(SCM car, SCM cdr) {
 
 /* strings */
 
-SCM mk_string(char *string, long dim) {
-    char *newstr;
-    if ((newstr = (char *)malloc ((unsigned)dim+1)) == NULL)
+/* The body of a string owning a copy of the DIM characters at
+   STRING, or DIM unset ones if STRING is NULL */
+struct string *mk_string_body(char *string, long dim) {
+    struct string *body;
+    if ((body = malloc(sizeof(struct string) + dim + 1)) == NULL)
         fatal_error("malloc: mk_string");
-    strcpy(newstr, string);
+    body->data = body->chars;
+    body->hash = 0;
+    body->base = NULL;
+    if (string != NULL)
+        memcpy(body->chars, string, dim);
+    body->chars[dim] = '\0';
+    return body;
+}
+
+SCM mk_string(char *string, long dim) {
+    struct string *body = mk_string_body(string, dim);
     SCM x;
     NEWCELL(x, T_STRING);
     STR_DIM(x) = dim;
-    STR_DATA(x) = newstr;
+    STR_BODY(x) = body;
+    return x;
+}
+
+/* A string of the DIM characters at DATA in the buffer of BASE */
+SCM mk_string_slice(SCM base, char *data, long dim) {
+    struct string *body;
+    SCM x;
+    if ((body = malloc(sizeof(struct string))) == NULL)
+        fatal_error("malloc: mk_string_slice");
+    body->data = data;
+    body->hash = 0;
+    body->base = base;
+    NEWCELL(x, T_STRING);
+    STR_DIM(x) = dim;
+    STR_BODY(x) = body;
+    return x;
+}
+
+/* characters */
+
+SCM mk_character(int c) {
+    SCM x;
+    NEWCELL(x, T_CHARACTER);
+    CHARACTER(x) = c;
     return x;
 }
 
@@ -120,11 +156,129 @@ SCM mk_fsubr(char *name, SCM (*fun)(void)) {
 
 /* Closures */
 
-SCM mk_closure(SCM args, SCM code, SCM env) {
+/* CODE is (args . body), usually the cdr of the lambda form itself */
+SCM mk_closure(SCM code, SCM env) {
     SCM closure;
     NEWCELL(closure, T_CLOSURE);
-    CLOSURE_CODE(closure) = mk_pair(args, code);
+    CLOSURE_CODE(closure) = code;
     CLOSURE_ENV(closure) = env;
     return closure;
 }
 
+/* Promises */
+
+SCM mk_promise(SCM state, SCM x) {
+    SCM promise, box = CONS(state, x);
+    NEWCELL(promise, T_PROMISE);
+    PROMISE_BOX(promise) = box;
+    return promise;
+}
+
+/* Flonums */
+
+SCM mk_flonum(double d) {
+    SCM x;
+    NEWCELL(x, T_FLONUM);
+    FLONUM(x) = d;
+    return x;
+}
+
+/* Bignums: DIGITS is a malloc'ed array that the bignum takes over */
+
+SCM mk_bignum(long size, unsigned int *digits) {
+    SCM x;
+    NEWCELL(x, T_BIGNUM);
+    BIG_SIZE(x) = size;
+    BIG_DIGITS(x) = digits;
+    return x;
+}
+
+/* Hash tables: TABLE is malloc'ed, and taken over as digits are */
+
+SCM mk_hashtable(struct hashtable *table) {
+    SCM x;
+    NEWCELL(x, T_HASHTABLE);
+    HASHTABLE(x) = table;
+    return x;
+}
+
+/* HAMT nodes: SLOTS is a malloc'ed array taken over by the node */
+
+SCM mk_hamt_node(unsigned bitmap, SCM *slots) {
+    SCM x;
+    NEWCELL(x, T_HAMT_NODE);
+    HAMT_BITMAP(x) = bitmap;
+    HAMT_SLOTS(x) = slots;
+    return x;
+}
+
+/* Persistent maps and sets: TYPE is T_MAP or T_SET */
+
+SCM mk_map(int type, long count, SCM root) {
+    SCM x;
+    NEWCELL(x, type);
+    MAP_COUNT(x) = count;
+    MAP_ROOT(x) = root;
+    return x;
+}
+
+/* Records */
+
+SCM mk_record_type(SCM name, SCM fields) {
+    SCM x;
+    NEWCELL(x, T_RECORD_TYPE);
+    RTD_NAME(x) = name;
+    RTD_FIELDS(x) = fields;
+    return x;
+}
+
+/* A record of type RTD, whose fields are unspecified */
+SCM mk_record(SCM rtd) {
+    SCM x, *fields = NULL;
+    long i, n = RTD_NFIELDS(rtd);
+    if (n > 0 && (fields = (SCM *)malloc(n * sizeof(SCM))) == NULL)
+        fatal_error("malloc: mk_record");
+    for (i = 0; i < n; i++)
+        fields[i] = unspecified_value;
+    NEWCELL(x, T_RECORD);
+    RECORD_RTD(x) = rtd;
+    RECORD_FIELDS(x) = fields;
+    return x;
+}
+
+SCM mk_record_proc(SCM rtd, SCM info) {
+    SCM x;
+    NEWCELL(x, T_RECORD_PROC);
+    RECPROC_RTD(x) = rtd;
+    RECPROC_INFO(x) = info;
+    return x;
+}
+
+/* Vectors */
+
+SCM mk_vector(long dim, SCM fill) {
+    SCM vec, *data = NULL;
+    long i;
+    if (dim > 0 && (data = (SCM *)malloc(dim * sizeof(SCM))) == NULL)
+        fatal_error("malloc: mk_vector");
+    for (i = 0; i < dim; i++)
+        data[i] = fill;
+    NEWCELL(vec, T_VECTOR);
+    VECTOR_DIM(vec) = dim;
+    VECTOR_DATA(vec) = data;
+    return vec;
+}
+
+/* A bytevector or s32vector of DIM zeros */
+SCM mk_numvec(int type, long dim) {
+    SCM vec;
+    void *data = NULL;
+    if (dim > 0 &&
+        (data = calloc((size_t)dim, type == T_BYTEVECTOR ? 1 : sizeof(int)))
+        == NULL)
+        fatal_error("malloc: mk_numvec");
+    NEWCELL(vec, type);
+    NUMVEC_DIM(vec) = dim;
+    NUMVEC_DATA(vec) = data;
+    return vec;
+}
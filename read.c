@@ -26,6 +26,7 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <math.h>
 #include <setjmp.h>
 
 #include "tscheme.h"
@@ -35,7 +36,7 @@ static SCM do_readparen(FILE *fp);
 static SCM do_readstring(FILE *fp);
 static SCM do_readtoken(FILE *fp);
 static int skip_spaces(FILE *f, char *eoferr);
-static int is_number_str(char *s);
+static int same_ci(char *s, char *upper);
 
 static char strbuf[STRBUF_SIZE];
 
@@ -49,6 +50,8 @@ SCM n_read(SCM args) {
 SCM scm_read(SCM port) {
     if (!IS_PORT(port))
         wta_error("read", 1);
+    if (PORT_FPTR(port) == NULL)
+        error1("Port %s is closed\n", PORT_NAME(port));
     return do_read(PORT_FPTR(port));
 }
 
@@ -80,6 +83,18 @@ static SCM do_readr(FILE *fp) {
         case 'f':
         case 'F':
             return boolean_false;
+        case '(':
+            return s_list_to_vector(do_readparen(fp));
+        case 'u':
+        case 'U':
+            if (getc(fp) != '8' || getc(fp) != '(')
+                error0("syntax");
+            return s_list_to_bytevector(do_readparen(fp));
+        case 's':
+        case 'S':
+            if (getc(fp) != '3' || getc(fp) != '2' || getc(fp) != '(')
+                error0("syntax");
+            return s_list_to_s32vector(do_readparen(fp));
         case '\\': 
             if ((c = getc(fp)) == EOF)
                 error0("unexpected EOF");
@@ -165,6 +180,7 @@ static SCM do_readstring(FILE *fp) {
 static SCM do_readtoken(FILE *fp) {
     char c;
     int i = 0;
+    SCM x;
     while ((c = getc(fp)) != EOF) {
         if (i >= STRBUF_SIZE)
             fatal_error("I/O buffer size exceeded");
@@ -180,8 +196,8 @@ static SCM do_readtoken(FILE *fp) {
         case '\n':
             ungetc(c,fp);
             strbuf[i] = '\0';
-            if (is_number_str(strbuf))
-                return (SCM)MK_FIXNUM(atoi(strbuf));
+            if ((x = parse_number(strbuf)) != NULL)
+                return x;
             else
                 return mk_symbol(strbuf);
         default:
@@ -217,16 +233,47 @@ static int skip_spaces(FILE *f, char *eoferr) {
     return 0; /* dummy */
 }
 
-static int is_number_str(char *s) {
+/* The number written as S, or NULL if S is not the syntax of a
+   number: an integer, a decimal with an optional exponent, which is
+   read as a flonum, or one of +inf.0, -inf.0 and +nan.0 */
+SCM parse_number(char *s) {
     char *p = s;
-    if (p[0] == '-')
+    int digits = 0, flonump = 0;
+
+    if ((p[0] == '+' || p[0] == '-') && same_ci(p + 1, "INF.0"))
+        return mk_flonum(p[0] == '-' ? -HUGE_VAL : HUGE_VAL);
+    if ((p[0] == '+' || p[0] == '-') && same_ci(p + 1, "NAN.0"))
+        return mk_flonum(NAN);
+    if (p[0] == '+' || p[0] == '-')
         p++;
-    if (p[0] == '\0')
-        return 0;
-    while (p[0] != '\0') {
-        if (p[0] < '0' || p[0] > '9')
-            return 0;
+    for (; isdigit((unsigned char)p[0]); p++)
+        digits++;
+    if (p[0] == '.') {
+        flonump = 1;
+        for (p++; isdigit((unsigned char)p[0]); p++)
+            digits++;
+    }
+    if (digits == 0)
+        return NULL;
+    if (p[0] == 'e' || p[0] == 'E') {
+        flonump = 1;
         p++;
+        if (p[0] == '+' || p[0] == '-')
+            p++;
+        if (!isdigit((unsigned char)p[0]))
+            return NULL;
+        while (isdigit((unsigned char)p[0]))
+            p++;
     }
-    return 1;
+    if (p[0] != '\0')
+        return NULL;
+    return flonump ? mk_flonum(strtod(s, NULL)) : parse_integer(s);
+}
+
+/* Whether S equals UPPER, ignoring the case of S */
+static int same_ci(char *s, char *upper) {
+    for (; *upper != '\0'; s++, upper++)
+        if (toupper((unsigned char)*s) != *upper)
+            return 0;
+    return *s == '\0';
 }
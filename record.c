@@ -0,0 +1,162 @@
+/*
+ * Tscheme: A Tiny Scheme Interpreter
+ * Copyright (c) 1995-2013 Takuo WATANABE (Tokyo Institute of Technology)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <setjmp.h>
+
+#include "tscheme.h"
+
+/* Records
+
+   DEFINE-RECORD-TYPE (init-src.scm) makes a record type and its
+   procedures with the SYS:RECORD-* subrs below.  The procedures are
+   record procedures, which the evaluators apply to the values of
+   their arguments without consing a list: a predicate or an accessor
+   checks the type of its argument and indexes its fields directly.
+
+   The info of a record procedure is (name . spec), where spec is the
+   vector of the indices of the fields a constructor takes, or a
+   fixnum holding the kind of the other procedures in its low bits
+   and the index of the field above. */
+
+enum { RP_PREDICATE, RP_ACCESSOR, RP_MODIFIER };
+
+#define RP_KIND_BITS 2
+#define RP_SPEC(kind, i) MK_FIXNUM(((i) << RP_KIND_BITS) | (kind))
+#define RP_KIND(spec)    (FIXNUM(spec) & ((1 << RP_KIND_BITS) - 1))
+#define RP_INDEX(spec)   (FIXNUM(spec) >> RP_KIND_BITS)
+
+#define RP_SNAME(p) STR_DATA(SYM_PNAME(RECPROC_NAME(p)))
+
+/* Applies the record procedure PROC to the N values in VALS */
+SCM apply_record_proc(SCM proc, SCM *vals, int n) {
+    SCM spec = CDR(RECPROC_INFO(proc)), rtd = RECPROC_RTD(proc), r;
+    int kind;
+    long i;
+
+    if (IS_VECTOR(spec)) {
+        if (n != VECTOR_DIM(spec))
+            wna_error(RP_SNAME(proc), n);
+        r = mk_record(rtd);
+        for (i = 0; i < n; i++)
+            RECORD_FIELDS(r)[FIXNUM(VECTOR_DATA(spec)[i])] = vals[i];
+        return r;
+    }
+    kind = RP_KIND(spec);
+    if (n != (kind == RP_MODIFIER ? 2 : 1))
+        wna_error(RP_SNAME(proc), n);
+    r = vals[0];
+    if (kind == RP_PREDICATE)
+        return IS_RECORD(r) && EQ(RECORD_RTD(r), rtd) ?
+            boolean_true : boolean_false;
+    if (!IS_RECORD(r) || NEQ(RECORD_RTD(r), rtd))
+        wta_error(RP_SNAME(proc), 1);
+    if (kind == RP_ACCESSOR)
+        return RECORD_FIELDS(r)[RP_INDEX(spec)];
+    RECORD_FIELDS(r)[RP_INDEX(spec)] = vals[1];
+    return unspecified_value;
+}
+
+static SCM rtd_arg(char *fname, SCM rtd) {
+    if (!IS_RECORD_TYPE(rtd))
+        wta_error(fname, 1);
+    return rtd;
+}
+
+/* The index of the field named FIELD in RTD, argument ARGNO of FNAME */
+static long field_index(char *fname, SCM rtd, SCM field, int argno) {
+    long i;
+    for (i = 0; i < RTD_NFIELDS(rtd); i++)
+        if (EQ(VECTOR_DATA(RTD_FIELDS(rtd))[i], field))
+            return i;
+    wta_error(fname, argno);
+    return -1;
+}
+
+/* SYS:MAKE-RECORD-TYPE name fields */
+SCM s_sys_make_record_type(SCM name, SCM fields) {
+    SCM l;
+    if (!IS_SYMBOL(name))
+        wta_error("sys:make-record-type", 1);
+    for (l = fields; IS_PAIR(l); l = CDR(l))
+        if (!IS_SYMBOL(CAR(l)))
+            wta_error("sys:make-record-type", 2);
+    if (!IS_NULL(l))
+        wta_error("sys:make-record-type", 2);
+    return mk_record_type(name, s_list_to_vector(fields));
+}
+
+/* SYS:RECORD-CONSTRUCTOR rtd name fields -- FIELDS are those the
+   constructor takes, in order */
+SCM s_sys_record_constructor(SCM rtd, SCM name, SCM fields) {
+    SCM spec, l;
+    long i = 0;
+
+    rtd_arg("sys:record-constructor", rtd);
+    spec = s_list_to_vector(fields);
+    for (l = fields; IS_PAIR(l); l = CDR(l))
+        VECTOR_DATA(spec)[i++] =
+            MK_FIXNUM(field_index("sys:record-constructor", rtd, CAR(l), 3));
+    return mk_record_proc(rtd, CONS(name, spec));
+}
+
+/* SYS:RECORD-PREDICATE rtd name */
+SCM s_sys_record_predicate(SCM rtd, SCM name) {
+    rtd_arg("sys:record-predicate", rtd);
+    return mk_record_proc(rtd, CONS(name, RP_SPEC(RP_PREDICATE, 0)));
+}
+
+/* SYS:RECORD-ACCESSOR rtd name field */
+SCM s_sys_record_accessor(SCM rtd, SCM name, SCM field) {
+    long i = field_index("sys:record-accessor",
+                         rtd_arg("sys:record-accessor", rtd), field, 3);
+    return mk_record_proc(rtd, CONS(name, RP_SPEC(RP_ACCESSOR, i)));
+}
+
+/* SYS:RECORD-MODIFIER rtd name field */
+SCM s_sys_record_modifier(SCM rtd, SCM name, SCM field) {
+    long i = field_index("sys:record-modifier",
+                         rtd_arg("sys:record-modifier", rtd), field, 3);
+    return mk_record_proc(rtd, CONS(name, RP_SPEC(RP_MODIFIER, i)));
+}
+
+/* RECORD? x */
+SCM s_recordp(SCM x) {
+    return IS_RECORD(x) ? boolean_true : boolean_false;
+}
+
+void init_record_subrs(void) {
+    mk_subr("SYS:MAKE-RECORD-TYPE",
+            (SCM (*)(void))s_sys_make_record_type, 2);
+    mk_subr("SYS:RECORD-CONSTRUCTOR",
+            (SCM (*)(void))s_sys_record_constructor, 3);
+    mk_subr("SYS:RECORD-PREDICATE",
+            (SCM (*)(void))s_sys_record_predicate, 2);
+    mk_subr("SYS:RECORD-ACCESSOR",
+            (SCM (*)(void))s_sys_record_accessor, 3);
+    mk_subr("SYS:RECORD-MODIFIER",
+            (SCM (*)(void))s_sys_record_modifier, 3);
+    mk_subr("RECORD?", (SCM (*)(void))s_recordp, 1);
+}
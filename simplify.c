@@ -0,0 +1,426 @@
+/*
+ * Tscheme: A Tiny Scheme Interpreter
+ * Copyright (c) 1995-2013 Takuo WATANABE (Tokyo Institute of Technology)
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* A native version of the expression simplifier SYS:SIMPLIFY of
+   simplify.scm.  It applies the same rewrite rules and produces the
+   same output; the Scheme version remains as the reference, under the
+   name SYS:SIMPLIFY/SCHEME. */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <setjmp.h>
+
+#include "tscheme.h"
+
+static SCM sym_append, sym_list, sym_cons, sym_define_macro,
+    sym_sys_define_macro, sym_sys_macros, sym_delay_force, sym_cons_stream,
+    sym_sys_make_promise;
+
+long stat_macro_expansions;
+
+static SCM simplify(SCM exp);
+static SCM simplify_body(SCM body);
+
+static SCM checked_car(SCM x) {
+    if (!IS_PAIR(x))
+        wta_error("car", 1);
+    return CAR(x);
+}
+
+static SCM checked_cdr(SCM x) {
+    if (!IS_PAIR(x))
+        wta_error("cdr", 1);
+    return CDR(x);
+}
+
+#define SCAR(x)  checked_car(x)
+#define SCDR(x)  checked_cdr(x)
+#define SCADR(x) checked_car(checked_cdr(x))
+#define SCDDR(x) checked_cdr(checked_cdr(x))
+
+static SCM list2(SCM x, SCM y) {
+    return CONS(x, CONS(y, NIL));
+}
+
+static SCM list3(SCM x, SCM y, SCM z) {
+    return CONS(x, CONS(y, CONS(z, NIL)));
+}
+
+static SCM reverse(SCM l) {
+    SCM r = NIL;
+    for (; IS_PAIR(l); l = CDR(l))
+        r = CONS(CAR(l), r);
+    return r;
+}
+
+/* a proper list whose car is DEFINE */
+static bool is_define(SCM x) {
+    SCM p;
+    if (!IS_PAIR(x) || NEQ(CAR(x), sym_define))
+        return false;
+    for (p = x; IS_PAIR(p); p = CDR(p))
+        ;
+    return IS_NULL(p);
+}
+
+static SCM simplify_spec(SCM spec) {
+    return map1(simplify, spec);
+}
+
+static SCM simplify_bspec(SCM bspec) {
+    return list2(SCAR(bspec), simplify(SCADR(bspec)));
+}
+
+static SCM simplify_cond_clause(SCM clause) {
+    SCM test = SCAR(clause);
+    if (NEQ(test, sym_else))
+        test = simplify(test);
+    return CONS(test, map1(simplify, SCDR(clause)));
+}
+
+static SCM simplify_case_clause(SCM clause) {
+    return CONS(SCAR(clause), map1(simplify, SCDR(clause)));
+}
+
+/* (LET* ((var1 init1) (var2 init2)...) . body) =>
+   (LET ((var1 init1)) (LET ((var2 init2)) (... . body)...)) */
+static SCM simplify_let_star(SCM bspecs, SCM body) {
+    SCM bspec, rest;
+    if (IS_NULL(bspecs))
+        return simplify_body(body);
+    bspec = list2(SCAR(SCAR(bspecs)), simplify(SCADR(CAR(bspecs))));
+    if (IS_NULL(SCDR(bspecs)))
+        rest = simplify_body(body);
+    else
+        rest = CONS(simplify_let_star(CDR(bspecs), body), NIL);
+    return CONS(sym_let, CONS(CONS(bspec, NIL), rest));
+}
+
+/* Macros
+
+   SYS:*MACROS* is an alist from macro names to expanders.  A use
+   (name . args) is replaced in place by the value of (expander .
+   args), so every use is expanded once, however many times the code
+   containing it is simplified or run.  Macros are not hygienic, and
+   they are looked up by name only: a local variable does not shadow
+   a macro. */
+
+static SCM macro_entry(SCM name) {
+    SCM l;
+    for (l = SYM_VALUE(sym_sys_macros); IS_PAIR(l); l = CDR(l))
+        if (IS_PAIR(CAR(l)) && EQ(CAAR(l), name))
+            return CAR(l);
+    return boolean_false;
+}
+
+static SCM macro_expander(SCM x) {
+    SCM m;
+    if (!IS_PAIR(x) || !IS_SYMBOL(CAR(x)))
+        return boolean_false;
+    m = macro_entry(CAR(x));
+    return IS_PAIR(m) ? CDR(m) : boolean_false;
+}
+
+/* Expands the macro use FORM in place until its head is no longer a
+   macro.  A non-pair expansion x is stored as (BEGIN x). */
+static SCM expand_macro_uses(SCM form) {
+    SCM expander, x;
+    while (NEQ(expander = macro_expander(form), boolean_false)) {
+        x = apply_procedure(expander, CDR(form));
+        stat_macro_expansions++;
+        if (IS_PAIR(x)) {
+            CAR(form) = CAR(x);
+            CDR(form) = CDR(x);
+        }
+        else {
+            CAR(form) = sym_begin;
+            CDR(form) = CONS(x, NIL);
+        }
+    }
+    return form;
+}
+
+/* a non-empty (BEGIN define...), as a macro may expand to; the
+   elements may be such BEGINs too */
+static bool is_define_begin(SCM x) {
+    SCM p, d;
+    if (!IS_PAIR(x) || NEQ(CAR(x), sym_begin) || !IS_PAIR(CDR(x)))
+        return false;
+    for (p = CDR(x); IS_PAIR(p); p = CDR(p)) {
+        d = expand_macro_uses(CAR(p));
+        if (!is_define(d) && !is_define_begin(d))
+            return false;
+    }
+    return IS_NULL(p);
+}
+
+/* Pushes the elements of BODY onto R, splicing in the defines of
+   each (BEGIN define...) */
+static SCM splice_body(SCM body, SCM r) {
+    for (; IS_PAIR(body); body = CDR(body)) {
+        if (is_define_begin(CAR(body)))
+            r = splice_body(CDR(CAR(body)), r);
+        else
+            r = CONS(CAR(body), r);
+    }
+    return r;
+}
+
+/* Expands the macro uses in BODY and splices in the defines of its
+   (BEGIN define...) elements. */
+static SCM expand_body(SCM body) {
+    SCM l;
+    bool spliced = false;
+
+    for (l = body; IS_PAIR(l); l = CDR(l))
+        if (is_define_begin(expand_macro_uses(CAR(l))))
+            spliced = true;
+    return spliced ? reverse(splice_body(body, NIL)) : body;
+}
+
+/* Internal defines at the head of BODY become a LETREC */
+static SCM simplify_body(SCM body) {
+    SCM bspecs = NIL, others = NIL, p = NIL, x;
+
+    body = expand_body(body);
+    for (; !IS_NULL(body) && is_define(SCAR(body)); body = CDR(body)) {
+        SCM def = CAR(body), var, exp;
+        if (IS_PAIR(SCADR(def))) {
+            var = CAR(CADR(def));
+            exp = CONS(sym_lambda,
+                       CONS(CDR(CADR(def)), simplify_body(SCDDR(def))));
+        }
+        else {
+            var = CADR(def);
+            exp = simplify(SCADR(SCDR(def)));
+        }
+        bspecs = CONS(list2(var, exp), bspecs);
+    }
+    for (; !IS_NULL(body); body = CDR(body)) {
+        if (is_define(SCAR(body)))
+            error0("ERROR: sys:simplify: Invalid local define.\n");
+        x = CONS(simplify(CAR(body)), NIL);
+        if (IS_NULL(others))
+            others = x;
+        else
+            CDR(p) = x;
+        p = x;
+    }
+    if (IS_NULL(bspecs))
+        return others;
+    return CONS(CONS(sym_letrec, CONS(reverse(bspecs), others)), NIL);
+}
+
+static SCM expand_quasiquote(SCM e) {
+    SCM l, a = NIL, b = NIL;
+
+    if (IS_SYMBOL(e))
+        return list2(sym_quote, e);
+    if (!IS_PAIR(e))
+        return e;
+    for (l = e; !IS_NULL(l); l = SCDR(l)) {
+        SCM x = SCAR(l);
+        if (IS_PAIR(x) && EQ(CAR(x), sym_unquote))
+            b = CONS(SCADR(x), b);
+        else if (IS_PAIR(x) && EQ(CAR(x), sym_unquote_splicing)) {
+            a = CONS(SCADR(x), CONS(CONS(sym_list, reverse(b)), a));
+            b = NIL;
+        }
+        else
+            b = CONS(expand_quasiquote(x), b);
+    }
+    return CONS(sym_append,
+                reverse(CONS(CONS(sym_list, reverse(b)), a)));
+}
+
+/* (DELAY exp) => (SYS:MAKE-PROMISE 'DELAY (LAMBDA () exp))
+   (DELAY-FORCE exp) => (SYS:MAKE-PROMISE #f (LAMBDA () exp)) */
+static SCM mk_delay(SCM op, SCM exp) {
+    return list3(sym_sys_make_promise,
+                 EQ(op, sym_delay) ? list2(sym_quote, sym_delay)
+                                   : boolean_false,
+                 list3(sym_lambda, NIL, simplify(exp)));
+}
+
+/* The parts of a form are simplified from left to right, as macro
+   expanders may have side effects. */
+static SCM simplify(SCM exp) {
+    SCM op, args, x, y;
+
+    switch (TYPE(exp)) {
+    case T_BOOLEAN:
+    case T_FIXNUM:
+    case T_CHARACTER:
+    case T_STRING:
+    case T_VECTOR:
+    case T_BYTEVECTOR:
+    case T_S32VECTOR:
+    case T_FLONUM:
+    case T_BIGNUM:
+    case T_HASHTABLE:
+    case T_MAP:
+    case T_SET:
+    case T_RECORD_TYPE:
+    case T_RECORD:
+    case T_RECORD_PROC:
+    case T_SYMBOL:
+        return exp;
+    case T_PAIR:
+        break;
+    default:
+        error0("ERROR: sys:simplify: Unknown expression type.\n");
+    }
+
+    op = CAR(exp);
+    args = CDR(exp);
+    if (EQ(op, sym_quote))
+        return exp;
+    else if (EQ(op, sym_lambda))
+        return CONS(sym_lambda, CONS(SCAR(args), simplify_body(SCDR(args))));
+    else if (EQ(op, sym_let)) {
+        if (IS_SYMBOL(SCAR(args))) {
+            /* (LET var ((var init)...) . body) is kept as it is: the
+               evaluator runs it as a loop */
+            x = map1(simplify_bspec, SCADR(args));
+            return CONS(sym_let,
+                        CONS(SCAR(args),
+                             CONS(x, simplify_body(SCDDR(args)))));
+        }
+        x = map1(simplify_bspec, SCAR(args));
+        return CONS(sym_let, CONS(x, simplify_body(SCDR(args))));
+    }
+    else if (EQ(op, sym_let_star))
+        return simplify_let_star(SCAR(args), SCDR(args));
+    else if (EQ(op, sym_letrec)) {
+        x = map1(simplify_bspec, SCAR(args));
+        return CONS(sym_letrec, CONS(x, simplify_body(SCDR(args))));
+    }
+    else if (EQ(op, sym_if) || EQ(op, sym_and) || EQ(op, sym_or))
+        return CONS(op, map1(simplify, args));
+    else if (EQ(op, sym_cond))
+        return CONS(sym_cond, map1(simplify_cond_clause, args));
+    else if (EQ(op, sym_case)) {
+        x = simplify(SCAR(args));
+        return CONS(sym_case, CONS(x, map1(simplify_case_clause, SCDR(args))));
+    }
+    else if (EQ(op, sym_do)) {
+        /* (DO ((var init step)...) (test expr...) command...) */
+        x = map1(simplify_spec, SCAR(args));
+        y = map1(simplify, SCADR(args));
+        return CONS(sym_do, CONS(x, CONS(y, map1(simplify, SCDDR(args)))));
+    }
+    else if (EQ(op, sym_begin))
+        return CONS(sym_begin, simplify_body(args));
+    else if (EQ(op, sym_set))
+        return list3(sym_set, SCAR(args), simplify(SCADR(args)));
+    else if (EQ(op, sym_define)) {
+        if (IS_PAIR(SCAR(args)))
+            /* (DEFINE (var . args) . body) =>
+               (DEFINE var (LAMBDA args . body)) */
+            return list3(sym_define,
+                         CAR(CAR(args)),
+                         CONS(sym_lambda,
+                              CONS(CDR(CAR(args)),
+                                   simplify_body(SCDR(args)))));
+        return list3(sym_define, SCAR(args), simplify(SCADR(args)));
+    }
+    else if (EQ(op, sym_define_macro)) {
+        if (IS_PAIR(SCAR(args)))
+            /* (DEFINE-MACRO (name . args) . body) =>
+               (SYS:DEFINE-MACRO 'name (LAMBDA args . body)) */
+            return list3(sym_sys_define_macro,
+                         list2(sym_quote, CAR(CAR(args))),
+                         CONS(sym_lambda,
+                              CONS(CDR(CAR(args)),
+                                   simplify_body(SCDR(args)))));
+        return list3(sym_sys_define_macro,
+                     list2(sym_quote, SCAR(args)),
+                     simplify(SCADR(args)));
+    }
+    else if (EQ(op, sym_delay) || EQ(op, sym_delay_force))
+        return mk_delay(op, SCAR(args));
+    else if (EQ(op, sym_cons_stream)) {
+        /* (CONS-STREAM a b) => (CONS a (DELAY b)) */
+        x = simplify(SCAR(args));
+        return list3(sym_cons, x, mk_delay(sym_delay, SCADR(args)));
+    }
+    else if (EQ(op, sym_quasiquote))
+        return expand_quasiquote(SCAR(args));
+    else if (NEQ(macro_expander(exp), boolean_false))
+        return simplify(expand_macro_uses(exp));
+    else
+        return map1(simplify, exp);
+}
+
+/* SYS:SIMPLIFY exp -- EXP is a toplevel form: the defines of a
+   (BEGIN define...), as DEFINE-RECORD-TYPE expands to, stay toplevel
+   defines instead of becoming a LETREC */
+SCM s_sys_simplify(SCM exp) {
+    SCM l, r = NIL;
+
+    if (!is_define_begin(expand_macro_uses(exp)))
+        return simplify(exp);
+    for (l = reverse(splice_body(CDR(exp), NIL)); IS_PAIR(l); l = CDR(l))
+        r = CONS(simplify(CAR(l)), r);
+    return CONS(sym_begin, reverse(r));
+}
+
+/* SYS:MACROEXPAND form -- expands a macro use in place */
+SCM s_sys_macroexpand(SCM form) {
+    return expand_macro_uses(form);
+}
+
+/* SYS:DEFINE-MACRO name expander */
+SCM s_sys_define_macro(SCM name, SCM expander) {
+    SCM m;
+    if (!IS_SYMBOL(name))
+        wta_error("sys:define-macro", 1);
+    if (!IS_CLOSURE(expander))
+        wta_error("sys:define-macro", 2);
+    m = macro_entry(name);
+    if (IS_PAIR(m))
+        CDR(m) = expander;
+    else
+        SYM_VALUE(sym_sys_macros) =
+            CONS(CONS(name, expander), SYM_VALUE(sym_sys_macros));
+    return name;
+}
+
+void init_simplify_subrs(void) {
+    sym_append = mk_symbol("APPEND");
+    sym_list = mk_symbol("LIST");
+    sym_cons = mk_symbol("CONS");
+    sym_delay_force = mk_symbol("DELAY-FORCE");
+    sym_cons_stream = mk_symbol("CONS-STREAM");
+    sym_sys_make_promise = mk_symbol("SYS:MAKE-PROMISE");
+    sym_define_macro = mk_symbol("DEFINE-MACRO");
+    sym_sys_define_macro = mk_symbol("SYS:DEFINE-MACRO");
+    sym_sys_macros = mk_symbol("SYS:*MACROS*");
+    SYM_VALUE(sym_sys_macros) = NIL;
+
+    mk_subr("SYS:SIMPLIFY", (SCM (*)(void))s_sys_simplify, 1);
+    mk_subr("SYS:MACROEXPAND", (SCM (*)(void))s_sys_macroexpand, 1);
+    mk_subr("SYS:DEFINE-MACRO", (SCM (*)(void))s_sys_define_macro, 2);
+}
+
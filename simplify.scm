@@ -22,42 +22,24 @@
 
 ;;; An expression simplifier
 
-;;; Utility functions
-
-(define (map1 f xs)
-  (if (null? xs)
-      '()
-      (cons (f (car xs)) (map1 f (cdr xs)))))
-
-(define (list* . args)
-  (if (null? args)
-      '()
-      (append (butlast args) (last args))))
-
-(define (butlast l)
-  (cond ((null? l)
-	 (error "butlast"))
-	((null? (cdr l))
-	 '())
-	(else
-	 (cons (car l) (butlast (cdr l))))))
-
-(define (last l)
-  (cond ((null? l)
-	 (error "last"))
-	((null? (cdr l))
-	 (car l))
-	(else
-	 (last (cdr l)))))
-
-
 ;;; Simplifier
 
-(define (sys:simplify exp)
+;;; SYS:SIMPLIFY is implemented in C (simplify.c); this is the
+;;; reference version, which must give the same results.  Macro uses
+;;; are expanded in place by SYS:MACROEXPAND, as in the C version.
+
+(define (sys:simplify/scheme exp)
   (cond ((boolean? exp) exp)
 	((number?  exp) exp)
 	((char?    exp) exp)
 	((string?  exp) exp)
+	((vector?  exp) exp)
+	((bytevector? exp) exp)
+	((s32vector? exp) exp)
+	((hash-table? exp) exp)
+	((map? exp) exp)
+	((set? exp) exp)
+	((record? exp) exp)
 	((symbol?  exp) exp)
 	((pair?    exp)
 	 (let ((op (car exp)) (args (cdr exp)))
@@ -69,16 +51,12 @@
 			 (sys:simplify-body (cdr args))))
 		 ((eq? op 'let)
 		  (if (symbol? (car args))
-		      ;; (LET var ((var init)...) . body) =>
-		      ;; (LETREC ((var (LAMBDA (var...) . body)))
-		      ;;   (var init...))
-		      (list 'letrec
-			    (list (list (car args)
-					(list* 'lambda
-					       (sys:let-vars (cadr args))
-					       (sys:simplify-body (cddr args)))))
-			    (list* (car args)
-				   (map1 sys:simplify (sys:let-exps (cadr args)))))
+		      ;; (LET var ((var init)...) . body) is kept as it
+		      ;; is: the evaluator runs it as a loop
+		      (list* 'let
+			     (car args)
+			     (sys:simplify-let-bspecs (cadr args))
+			     (sys:simplify-body (cddr args)))
 		      (list* 'let
 			     (sys:simplify-let-bspecs (car args))
 			     (sys:simplify-body (cdr args)))))
@@ -92,36 +70,42 @@
 			 (sys:simplify-let-bspecs (car args))
 			 (sys:simplify-body (cdr args))))
 		 ((eq? op 'if)
-		  (list* 'if (map1 sys:simplify args)))
+		  (list* 'if (map1 sys:simplify/scheme args)))
 		 ((eq? op 'cond)
 		  (list* 'cond
 			 (map1 (lambda (clause)
 				 (list*
 				  (if (eq? (car clause) 'else)
 				      'else
-				      (sys:simplify (car clause)))
-				  (map1 sys:simplify (cdr clause))))
+				      (sys:simplify/scheme (car clause)))
+				  (map1 sys:simplify/scheme (cdr clause))))
 			       args)))
 		 ((eq? op 'case)
 		  (list* 'case
-			 (sys:simplify (car args))
+			 (sys:simplify/scheme (car args))
 			 (map1 (lambda (clause)
 				 (list*
 				  (car clause)
-				  (map1 sys:simplify (cdr clause))))
+				  (map1 sys:simplify/scheme (cdr clause))))
 			       (cdr args))))
 		 ((eq? op 'and)
-		  (list* 'and (map1 sys:simplify args)))
+		  (list* 'and (map1 sys:simplify/scheme args)))
 		 ((eq? op 'or)
-		  (list* 'or (map1 sys:simplify args)))
-		 ((eq? op 'do))
+		  (list* 'or (map1 sys:simplify/scheme args)))
+		 ((eq? op 'do)
+		  ;; (DO ((var init step)...) (test expr...) command...)
+		  (list* 'do
+			 (map1 (lambda (spec) (map1 sys:simplify/scheme spec))
+			       (car args))
+			 (map1 sys:simplify/scheme (cadr args))
+			 (map1 sys:simplify/scheme (cddr args))))
 		 ((eq? op 'begin)
 		  (list* 'begin
 			 (sys:simplify-body args)))
 		 ((eq? op 'set!)
 		  (list 'set!
 			(car args)
-			(sys:simplify (cadr args))))
+			(sys:simplify/scheme (cadr args))))
 		 ((eq? op 'define)
 		  (if (pair? (car args))
 		      ;; (DEFINE (var . args) . body) =>
@@ -133,18 +117,46 @@
 				   (sys:simplify-body (cdr args))))
 		      (list 'define
 			    (car args)
-			    (sys:simplify (cadr args)))))
+			    (sys:simplify/scheme (cadr args)))))
+		 ((eq? op 'define-macro)
+		  (if (pair? (car args))
+		      ;; (DEFINE-MACRO (name . args) . body) =>
+		      ;; (SYS:DEFINE-MACRO 'name (LAMBDA args . body))
+		      (list 'sys:define-macro
+			    (list 'quote (caar args))
+			    (list* 'lambda
+				   (cdar args)
+				   (sys:simplify-body (cdr args))))
+		      (list 'sys:define-macro
+			    (list 'quote (car args))
+			    (sys:simplify/scheme (cadr args)))))
+		 ((or (eq? op 'delay) (eq? op 'delay-force))
+		  (sys:simplify-delay op (car args)))
+		 ((eq? op 'cons-stream)
+		  ;; (CONS-STREAM a b) => (CONS a (DELAY b))
+		  (list 'cons
+			(sys:simplify/scheme (car args))
+			(sys:simplify-delay 'delay (cadr args))))
 		 ((eq? op 'quasiquote)
 		  (sys:expand-quasiquote (car args)))
+		 ((and (symbol? op) (assq op sys:*macros*))
+		  (sys:simplify/scheme (sys:macroexpand exp)))
 		 (else
-		  (map1 sys:simplify exp)))))
+		  (map1 sys:simplify/scheme exp)))))
 	(else	
 	 (error "Unknown expression type."))))
 
+;; (DELAY exp) => (SYS:MAKE-PROMISE 'DELAY (LAMBDA () exp))
+;; (DELAY-FORCE exp) => (SYS:MAKE-PROMISE #f (LAMBDA () exp))
+(define (sys:simplify-delay op exp)
+  (list 'sys:make-promise
+	(if (eq? op 'delay) ''delay #f)
+	(list 'lambda '() (sys:simplify/scheme exp))))
+
 (define (sys:simplify-let-bspecs bspecs)
   (map1 (lambda (bspec)
 	  (list (car bspec)
-		(sys:simplify (cadr bspec))))
+		(sys:simplify/scheme (cadr bspec))))
 	bspecs))
 
 (define (sys:let-vars bspecs) (map1 car bspecs))
@@ -156,7 +168,7 @@
       (sys:simplify-body body)
       (list* 'let
 	     (list (list (caar bspecs)
-			 (sys:simplify (cadar bspecs))))
+			 (sys:simplify/scheme (cadar bspecs))))
 	     (if (null? (cdr bspecs))
 		 (sys:simplify-body body)
 		 (list (sys:simplify-let* (cdr bspecs) body))))))
@@ -175,7 +187,7 @@
 			  (list* 'lambda
 				 (cdadr (car body))
 				 (sys:simplify-body (cddr (car body))))
-			  (sys:simplify (caddr (car body))))))
+			  (sys:simplify/scheme (caddr (car body))))))
 	     (sys:simplify-body-define
 	      (cdr body)
 	      (cons (list var exp) bspecs))))
@@ -195,10 +207,33 @@
 		(eq? (car (car body)) 'define))
 	   (error "Invalid local define."))
 	  (else
-	   (cons (sys:simplify (car body))
+	   (cons (sys:simplify/scheme (car body))
 		 (sys:simplify-body-others (cdr body))))))
 
-  (sys:simplify-body-define body '()))
+  (sys:simplify-body-define (sys:expand-body body) '()))
+
+;; expands the macro uses in BODY and splices the defines of each
+;; (BEGIN define...) into it
+(define (sys:expand-body body)
+  (define (define? x)
+    (and (list? x) (not (null? x)) (eq? (car x) 'define)))
+  (define (define-begin? x)
+    (and (list? x) (pair? x) (eq? (car x) 'begin) (pair? (cdr x))
+	 (let loop ((l (cdr x)))
+	   (or (null? l)
+	       (let ((d (sys:macroexpand (car l))))
+		 (and (or (define? d) (define-begin? d))
+		      (loop (cdr l))))))))
+  (define (splice l)
+    (cond ((null? l) '())
+	  ((define-begin? (car l))
+	   (append (splice (cdar l)) (splice (cdr l))))
+	  (else (cons (car l) (splice (cdr l))))))
+  (let loop ((l body) (spliced #f))
+    (if (pair? l)
+	(loop (cdr l)
+	      (or (define-begin? (sys:macroexpand (car l))) spliced))
+	(if spliced (splice body) body))))
 
 (define (sys:expand-quasiquote e)
   (cond ((and (atom? e) (not (symbol? e))) e)
@@ -226,11 +261,832 @@
 			    (cons (sys:expand-quasiquote (car l)) b)))))))))
 
 
+;;; Optimizer
+
+;;; SYS:OPTIMIZE rewrites the output of SYS:SIMPLIFY: it folds
+;;; constant calls of the fixnum and predicate subrs, expands the
+;;; C[AD]+R family into CAR/CDR, turns ((LAMBDA (var...) . body)
+;;; exp...) into a LET, propagates constant LET bindings, drops unused
+;;; pure bindings and expressions, and decides IF and COND on constant
+;;; tests.  A call of a procedure it knows about is rewritten only
+;;; while the global binding of its name is still the original subr,
+;;; so that code compiled after a redefinition keeps the user's
+;;; meaning.  Set *OPTIMIZE* to #f to disable it.
+
+(define *optimize* #t)
+
+;;; (name nargs): subrs folded when all arguments are numbers
+(define sys:fold-numeric
+  '((+ 2) (- 2) (* 2) (/ 2) (1+ 1) (-1+ 1) (zero? 1)
+    (= 2) (< 2) (<= 2) (> 2) (>= 2)))
+
+;;; (name nargs): subrs folded when all arguments are constants
+(define sys:fold-any
+  '((not 1) (null? 1) (pair? 1) (number? 1) (boolean? 1)
+    (char? 1) (string? 1) (symbol? 1) (vector? 1)
+    (bytevector? 1) (s32vector? 1) (fixnum? 1) (flonum? 1)
+    (bignum? 1)))
+
+;;; (name op...): (name x) => (op... x)
+(define sys:inline-cxr
+  '((caar car car) (cadr car cdr) (cdar cdr car) (cddr cdr cdr)
+    (caaar car car car) (caadr car car cdr) (cadar car cdr car)
+    (caddr car cdr cdr) (cdaar cdr car car) (cdadr cdr car cdr)
+    (cddar cdr cdr car) (cdddr cdr cdr cdr)
+    (caaaar car car car car) (caaadr car car car cdr)
+    (caadar car car cdr car) (caaddr car car cdr cdr)
+    (cadaar car cdr car car) (cadadr car cdr car cdr)
+    (caddar car cdr cdr car) (cadddr car cdr cdr cdr)
+    (cdaaar cdr car car car) (cdaadr cdr car car cdr)
+    (cdadar cdr car cdr car) (cdaddr cdr car cdr cdr)
+    (cddaar cdr cdr car car) (cddadr cdr cdr car cdr)
+    (cdddar cdr cdr cdr car) (cddddr cdr cdr cdr cdr)
+    (first car) (second car cdr) (third car cdr cdr)
+    (fourth car cdr cdr cdr)))
+
+;;; (name . subr): the original values of the names above
+(define (sys:original-subrs names)
+  (map1 (lambda (name) (cons name (sys:eval name '()))) names))
+
+(define sys:builtins
+  (sys:original-subrs (append '(car cdr)
+			      (map1 car sys:fold-numeric)
+			      (map1 car sys:fold-any)
+			      (map1 car sys:inline-cxr))))
+
+;;; Whether OP is a name above that is neither bound in ENV nor
+;;; globally redefined
+(define (sys:builtin? op env)
+  (and (symbol? op)
+       (not (assq op env))
+       (let ((entry (assq op sys:builtins)))
+	 (and entry (eq? (sys:eval op '()) (cdr entry))))))
+
+;;; LENGTH, which rejects '()
+(define (sys:length l)
+  (if (pair? l) (length l) 0))
+
+;;; ENV is an alist of the local variables in scope: (var . #f), or
+;;; (var exp) when var is bound to the constant exp.
+
+(define (sys:optimize exp env)
+  (cond ((symbol? exp)
+	 (let ((binding (assq exp env)))
+	   (if (and binding (cdr binding))
+	       (cadr binding)
+	       exp)))
+	((not (pair? exp))
+	 exp)
+	(else
+	 (let ((op (car exp)) (args (cdr exp)))
+	   (cond ((eq? op 'quote)
+		  exp)
+		 ((eq? op 'lambda)
+		  (list* 'lambda
+			 (car args)
+			 (sys:optimize-body
+			  (cdr args)
+			  (sys:opt-bind (sys:param-vars (car args) '()) env))))
+		 ((eq? op 'let)
+		  (if (symbol? (car args))
+		      (list* 'let
+			     (car args)
+			     (sys:optimize-bspecs (cadr args) env)
+			     (sys:optimize-body
+			      (cddr args)
+			      (sys:opt-bind (cons (car args)
+						  (sys:let-vars (cadr args)))
+					    env)))
+		      (sys:optimize-let (sys:optimize-bspecs (car args) env)
+					(cdr args)
+					env)))
+		 ((eq? op 'letrec)
+		  (let ((env (sys:opt-bind (sys:let-vars (car args)) env)))
+		    (list* 'letrec
+			   (sys:optimize-bspecs (car args) env)
+			   (sys:optimize-body (cdr args) env))))
+		 ((eq? op 'do)
+		  (let ((inner (sys:opt-bind (sys:let-vars (car args)) env)))
+		    (list* 'do
+			   (map1 (lambda (spec)
+				   (list* (car spec)
+					  (sys:optimize (cadr spec) env)
+					  (sys:optimize-list (cddr spec) inner)))
+				 (car args))
+			   (sys:optimize-list (cadr args) inner)
+			   (sys:optimize-list (cddr args) inner))))
+		 ((eq? op 'if)
+		  (sys:optimize-if (sys:optimize-list args env) env))
+		 ((eq? op 'cond)
+		  (cons 'cond (sys:optimize-clauses args env)))
+		 ((eq? op 'case)
+		  (list* 'case
+			 (sys:optimize (car args) env)
+			 (map1 (lambda (clause)
+				 (cons (car clause)
+				       (sys:optimize-body (cdr clause) env)))
+			       (cdr args))))
+		 ((eq? op 'begin)
+		  (let ((body (sys:optimize-body args env)))
+		    (if (and (pair? body) (null? (cdr body)))
+			(car body)
+			(cons 'begin body))))
+		 ((or (eq? op 'and) (eq? op 'or))
+		  (cons op (sys:optimize-list args env)))
+		 ((or (eq? op 'set!) (eq? op 'define))
+		  (list op (car args) (sys:optimize (cadr args) env)))
+		 ((and (pair? op)
+		       (eq? (car op) 'lambda)
+		       (list? (cadr op))
+		       (= (sys:length (cadr op)) (sys:length args)))
+		  ;; ((LAMBDA (var...) . body) exp...) =>
+		  ;; (LET ((var exp)...) . body)
+		  (sys:optimize-let
+		   (sys:optimize-bspecs (sys:make-bspecs (cadr op) args) env)
+		   (cddr op)
+		   env))
+		 (else
+		  (sys:optimize-call (sys:optimize-list exp env) env)))))))
+
+(define (sys:optimize-list exps env)
+  (map1 (lambda (exp) (sys:optimize exp env)) exps))
+
+;;; A body drops the pure expressions whose values are not used
+(define (sys:optimize-body body env)
+  (cond ((not (pair? body))
+	 body)
+	((null? (cdr body))
+	 (list (sys:optimize (car body) env)))
+	(else
+	 (let ((exp (sys:optimize (car body) env)))
+	   (if (sys:pure? exp env)
+	       (sys:optimize-body (cdr body) env)
+	       (cons exp (sys:optimize-body (cdr body) env)))))))
+
+(define (sys:optimize-bspecs bspecs env)
+  (map1 (lambda (bspec)
+	  (list (car bspec) (sys:optimize (cadr bspec) env)))
+	bspecs))
+
+(define (sys:make-bspecs vars exps)
+  (if (null? vars)
+      '()
+      (cons (list (car vars) (car exps))
+	    (sys:make-bspecs (cdr vars) (cdr exps)))))
+
+(define (sys:opt-bind vars env)
+  (if (null? vars)
+      env
+      (cons (cons (car vars) #f) (sys:opt-bind (cdr vars) env))))
+
+;;; BSPECS have been optimized already, BODY has not
+(define (sys:optimize-let bspecs body env)
+  (if (sys:mentions? 'the-environment body)
+      (list* 'let
+	     bspecs
+	     (sys:optimize-body body
+				(sys:opt-bind (sys:let-vars bspecs) env)))
+      (let* ((inner (let loop ((l bspecs) (inner env))
+		      (cond ((null? l)
+			     inner)
+			    ((and (sys:constant? (cadar l))
+				  (not (sys:assigned? (caar l) body)))
+			     (loop (cdr l)
+				   (cons (list (caar l) (cadar l)) inner)))
+			    (else
+			     (loop (cdr l) (cons (cons (caar l) #f) inner))))))
+	     (body (sys:optimize-body body inner))
+	     (bspecs (let loop ((l bspecs))
+		       (cond ((null? l)
+			      '())
+			     ((and (sys:pure? (cadar l) env)
+				   (not (sys:mentions? (caar l) body)))
+			      (loop (cdr l)))
+			     (else
+			      (cons (car l) (loop (cdr l))))))))
+	(cond ((pair? bspecs)
+	       (list* 'let bspecs body))
+	      ((null? (cdr body))
+	       (car body))
+	      (else
+	       (cons 'begin body))))))
+
+(define (sys:optimize-if exps env)
+  (let ((test (car exps)))
+    (cond ((sys:constant? test)
+	   (cond ((sys:constant-value test)
+		  (cadr exps))
+		 ((pair? (cddr exps))
+		  (caddr exps))
+		 (else
+		  (cons 'if exps))))
+	  ((and (pair? (cddr exps))
+		(pair? test)
+		(eq? (car test) 'not)
+		(sys:builtin? 'not env)
+		(pair? (cdr test))
+		(null? (cddr test)))
+	   ;; (IF (NOT test) a b) => (IF test b a)
+	   (list 'if (cadr test) (caddr exps) (cadr exps)))
+	  (else
+	   (cons 'if exps)))))
+
+(define (sys:optimize-clauses clauses env)
+  (if (null? clauses)
+      '()
+      (let ((clause (car clauses)))
+	(if (eq? (car clause) 'else)
+	    (list (cons 'else (sys:optimize-body (cdr clause) env)))
+	    (let ((test (sys:optimize (car clause) env)))
+	      (cond ((not (sys:constant? test))
+		     (cons (cons test (sys:optimize-list (cdr clause) env))
+			   (sys:optimize-clauses (cdr clauses) env)))
+		    ((not (sys:constant-value test))
+		     (sys:optimize-clauses (cdr clauses) env))
+		    ((null? (cdr clause))
+		     (list (list 'else test)))
+		    (else
+		     (list (cons 'else
+				 (sys:optimize-body (cdr clause) env))))))))))
+
+;;; EXP is a call whose operator and operands have been optimized
+(define (sys:optimize-call exp env)
+  (let ((op (car exp)) (args (cdr exp)))
+    (if (sys:builtin? op env)
+	(let ((cxr (assq op sys:inline-cxr))
+	      (numeric (assq op sys:fold-numeric))
+	      (any (assq op sys:fold-any)))
+	  (cond ((and cxr
+		      (pair? args)
+		      (null? (cdr args))
+		      (sys:builtin? 'car env)
+		      (sys:builtin? 'cdr env))
+		 (let loop ((ops (cdr cxr)))
+		   (if (null? ops)
+		       (car args)
+		       (list (car ops) (loop (cdr ops))))))
+		((and numeric
+		      (= (sys:length args) (cadr numeric))
+		      (sys:all? number? args)
+		      (not (and (eq? op '/) (= (cadr args) 0))))
+		 (sys:fold exp))
+		((and any
+		      (= (sys:length args) (cadr any))
+		      (sys:all? sys:constant? args))
+		 (sys:fold exp))
+		(else
+		 exp)))
+	exp)))
+
+(define (sys:fold exp)
+  (let ((value (sys:eval exp '())))
+    (if (or (pair? value) (null? value) (symbol? value))
+	(list 'quote value)
+	value)))
+
+(define (sys:all? pred l)
+  (or (null? l)
+      (and (pred (car l)) (sys:all? pred (cdr l)))))
+
+(define (sys:constant? exp)
+  (or (number? exp)
+      (boolean? exp)
+      (char? exp)
+      (string? exp)
+      (vector? exp)
+      (bytevector? exp)
+      (s32vector? exp)
+      (hash-table? exp)
+      (map? exp)
+      (set? exp)
+      (record? exp)
+      (and (pair? exp) (eq? (car exp) 'quote))))
+
+(define (sys:constant-value exp)
+  (if (pair? exp) (cadr exp) exp))
+
+;;; Whether dropping EXP cannot change the behaviour of the program
+(define (sys:pure? exp env)
+  (or (sys:constant? exp)
+      (and (symbol? exp) (assq exp env) #t)
+      (and (pair? exp) (eq? (car exp) 'lambda))))
+
+;;; The variables that may be assigned in EXP, added to ACC
+;;; (shadowing is ignored)
+(define (sys:assigned-vars exp acc)
+  (cond ((not (pair? exp))
+	 acc)
+	((and (or (eq? (car exp) 'set!) (eq? (car exp) 'define))
+	      (pair? (cdr exp)))
+	 (sys:assigned-vars (cddr exp) (cons (cadr exp) acc)))
+	(else
+	 (sys:assigned-vars (cdr exp) (sys:assigned-vars (car exp) acc)))))
+
+(define (sys:assigned? var exp)
+  (and (memq var (sys:assigned-vars exp '())) #t))
+
+
+;;; Type specialization
+
+;;; SYS:SPECIALIZE replaces calls of CAR, CDR and the fixnum subrs by
+;;; their unchecked SYS: variants where the types of the arguments are
+;;; known.  Known types are FIXNUM (exact literals, variables tested
+;;; with FIXNUM? and results of arithmetic on fixnums) and PAIR
+;;; (results of CONS and variables tested with PAIR?).  Arithmetic on
+;;; fixnums may overflow into a bignum, so FIXNUM really means an
+;;; exact integer that is usually a fixnum; the SYS: arithmetic
+;;; variants take the generic path for bignums.  The variables of a
+;;; named let or DO get the types shared by their initial values and
+;;; by the arguments of every iteration, found by iterating to a fixed
+;;; point.  Assigned variables are never typed.
+
+;;; (name unchecked-name argument-type...)
+(define sys:unchecked-subrs
+  '((car sys:car pair) (cdr sys:cdr pair)
+    (zero? sys:zero? fixnum) (1+ sys:1+ fixnum) (-1+ sys:-1+ fixnum)
+    (+ sys:+ fixnum fixnum) (- sys:- fixnum fixnum)
+    (* sys:* fixnum fixnum) (= sys:= fixnum fixnum)
+    (< sys:< fixnum fixnum) (<= sys:<= fixnum fixnum)
+    (> sys:> fixnum fixnum) (>= sys:>= fixnum fixnum)))
+
+(define sys:fixnum-valued-subrs
+  '(length vector-length
+    bytevector-length bytevector-u8-ref s32vector-length s32vector-ref
+    sys:+ sys:- sys:* sys:1+ sys:-1+))
+
+;;; subrs whose value is a fixnum when their arguments are
+(define sys:fixnum-preserving-subrs
+  '(+ - * / 1+ -1+))
+
+;;; The names above are trusted under the same condition as in the
+;;; optimizer (see SYS:BUILTIN?)
+(set! sys:builtins
+      (append (sys:original-subrs
+	       (append '(cons list pair? fixnum?)
+		       (map1 car sys:unchecked-subrs)
+		       sys:fixnum-valued-subrs
+		       sys:fixnum-preserving-subrs))
+	      sys:builtins))
+
+;;; TENV is an alist of the local variables in scope: (var . type),
+;;; (var . set!) for an assigned variable, or (var *loop* types) for
+;;; the name of a named let whose calls are being collected.
+
+(define (sys:specialize exp tenv)
+  (cond ((symbol? exp)
+	 (let ((binding (assq exp tenv)))
+	   (if (and binding (sys:loop-binding? binding))
+	       ;; the procedure of the loop escapes
+	       (set-car! (cddr binding) 'escaped))
+	   exp))
+	((not (pair? exp))
+	 exp)
+	(else
+	 (let ((op (car exp)) (args (cdr exp)))
+	   (cond ((eq? op 'quote)
+		  exp)
+		 ((eq? op 'lambda)
+		  (let ((vars (sys:param-vars (car args) '())))
+		    (list* 'lambda
+			   (car args)
+			   (sys:specialize-body
+			    (cdr args)
+			    (sys:type-bind vars (map1 (lambda (v) #f) vars)
+					   (cdr args) tenv)))))
+		 ((eq? op 'let)
+		  (if (symbol? (car args))
+		      (sys:specialize-named-let (car args) (cadr args)
+						(cddr args) tenv)
+		      (list* 'let
+			     (sys:specialize-bspecs (car args) tenv)
+			     (sys:specialize-body
+			      (cdr args)
+			      (sys:type-bind (sys:let-vars (car args))
+					     (sys:types-of (sys:let-exps (car args))
+							   tenv)
+					     (cdr args)
+					     tenv)))))
+		 ((eq? op 'letrec)
+		  (let* ((vars (sys:let-vars (car args)))
+			 (tenv (sys:type-bind vars (map1 (lambda (v) #f) vars)
+					      '() tenv)))
+		    (list* 'letrec
+			   (sys:specialize-bspecs (car args) tenv)
+			   (sys:specialize-body (cdr args) tenv))))
+		 ((eq? op 'do)
+		  (sys:specialize-do (car args) (cadr args) (cddr args) tenv))
+		 ((eq? op 'if)
+		  (let ((test (car args)))
+		    (list* 'if
+			   (sys:specialize test tenv)
+			   (sys:specialize (cadr args)
+					   (sys:refine (sys:facts test #t tenv)
+						       tenv))
+			   (sys:specialize-body
+			    (cddr args)
+			    (sys:refine (sys:facts test #f tenv) tenv)))))
+		 ((eq? op 'cond)
+		  (cons 'cond (sys:specialize-clauses args tenv)))
+		 ((eq? op 'case)
+		  (list* 'case
+			 (sys:specialize (car args) tenv)
+			 (map1 (lambda (clause)
+				 (cons (car clause)
+				       (sys:specialize-body (cdr clause) tenv)))
+			       (cdr args))))
+		 ((or (eq? op 'and) (eq? op 'or))
+		  ;; each operand runs only if the previous ones were
+		  ;; true (AND) or false (OR)
+		  (cons op
+			(let loop ((l args) (tenv tenv))
+			  (if (null? l)
+			      '()
+			      (cons (sys:specialize (car l) tenv)
+				    (loop (cdr l)
+					  (sys:refine (sys:facts (car l)
+								 (eq? op 'and)
+								 tenv)
+						      tenv)))))))
+		 ((eq? op 'begin)
+		  (cons 'begin (sys:specialize-body args tenv)))
+		 ((or (eq? op 'set!) (eq? op 'define))
+		  (list op (car args) (sys:specialize (cadr args) tenv)))
+		 ((and (symbol? op)
+		       (assq op tenv)
+		       (sys:loop-binding? (assq op tenv)))
+		  (sys:note-loop-call (assq op tenv) args tenv)
+		  (cons op (sys:specialize-body args tenv)))
+		 (else
+		  (let ((exp (sys:specialize-body exp tenv))
+			(entry (and (sys:builtin? op tenv)
+				    (assq op sys:unchecked-subrs))))
+		    (if (and entry
+			     (equal? (cddr entry) (sys:types-of args tenv)))
+			(cons (cadr entry) (cdr exp))
+			exp))))))))
+
+(define (sys:specialize-body body tenv)
+  (map1 (lambda (exp) (sys:specialize exp tenv)) body))
+
+(define (sys:specialize-bspecs bspecs tenv)
+  (map1 (lambda (bspec)
+	  (cons (car bspec) (sys:specialize-body (cdr bspec) tenv)))
+	bspecs))
+
+(define (sys:specialize-clauses clauses tenv)
+  (if (null? clauses)
+      '()
+      (let ((clause (car clauses)))
+	(if (eq? (car clause) 'else)
+	    (list (cons 'else (sys:specialize-body (cdr clause) tenv)))
+	    (cons (cons (sys:specialize (car clause) tenv)
+			(sys:specialize-body
+			 (cdr clause)
+			 (sys:refine (sys:facts (car clause) #t tenv) tenv)))
+		  (sys:specialize-clauses
+		   (cdr clauses)
+		   (sys:refine (sys:facts (car clause) #f tenv) tenv)))))))
+
+(define (sys:specialize-named-let name bspecs body tenv)
+  (let ((vars (sys:let-vars bspecs))
+	(outer (sys:types-of (sys:let-exps bspecs) tenv)))
+    (let loop ((types (if (sys:assigned? name body)
+			  (map1 (lambda (v) #f) vars)
+			  outer)))
+      (let* ((record (list name '*loop* types))
+	     (body1 (sys:specialize-body
+		     body
+		     (sys:type-bind vars types body (cons record tenv))))
+	     (found (caddr record)))
+	(cond ((or (equal? found types)
+		   (and (eq? found 'escaped) (sys:all? not types)))
+	       (list* 'let name (sys:specialize-bspecs bspecs tenv) body1))
+	      ((eq? found 'escaped)
+	       (loop (map1 (lambda (v) #f) vars)))
+	      (else
+	       (loop found)))))))
+
+(define (sys:specialize-do specs test-clause commands tenv)
+  (let ((vars (sys:let-vars specs))
+	(loop-body (list test-clause commands (map1 cddr specs))))
+    (let loop ((types (sys:types-of (sys:let-exps specs) tenv)))
+      (let* ((inner (sys:type-bind vars types loop-body tenv))
+	     (running (sys:refine (sys:facts (car test-clause) #f inner)
+				  inner))
+	     (found (sys:map2 (lambda (spec type)
+				(if (pair? (cddr spec))
+				    (sys:type-join type
+						   (sys:type-of (caddr spec)
+								running))
+				    type))
+			    specs types)))
+	(if (equal? found types)
+	    (list* 'do
+		   (map1 (lambda (spec)
+			   (list* (car spec)
+				  (sys:specialize (cadr spec) tenv)
+				  (sys:specialize-body (cddr spec) running)))
+			 specs)
+		   (cons (sys:specialize (car test-clause) inner)
+			 (sys:specialize-body
+			  (cdr test-clause)
+			  (sys:refine (sys:facts (car test-clause) #t inner)
+				      inner)))
+		   (sys:specialize-body commands running))
+	    (loop found))))))
+
+(define (sys:loop-binding? binding)
+  (and (pair? (cdr binding)) (eq? (cadr binding) '*loop*)))
+
+;;; Joins the types of the arguments of a call of a loop procedure
+;;; into what is known of its variables
+(define (sys:note-loop-call binding args tenv)
+  (let ((types (caddr binding)))
+    (if (not (eq? types 'escaped))
+	(set-car! (cddr binding)
+		  (if (= (sys:length args) (sys:length types))
+		      (sys:map2 sys:type-join types (sys:types-of args tenv))
+		      'escaped)))))
+
+(define (sys:type-bind vars types body tenv)
+  (if (null? vars)
+      tenv
+      (let loop ((vars vars)
+		 (types types)
+		 (assigned (sys:assigned-vars body '())))
+	(if (null? vars)
+	    tenv
+	    (cons (cons (car vars)
+			(if (memq (car vars) assigned) 'set! (car types)))
+		  (loop (cdr vars) (cdr types) assigned))))))
+
+(define (sys:map2 f xs ys)
+  (if (null? xs)
+      '()
+      (cons (f (car xs) (car ys)) (sys:map2 f (cdr xs) (cdr ys)))))
+
+(define (sys:type-join t1 t2)
+  (and (eq? t1 t2) t1))
+
+(define (sys:types-of exps tenv)
+  (map1 (lambda (exp) (sys:type-of exp tenv)) exps))
+
+(define (sys:type-of exp tenv)
+  (cond ((number? exp)
+	 (and (fixnum? exp) 'fixnum))
+	((symbol? exp)
+	 (let ((binding (assq exp tenv)))
+	   (and binding
+		(memq (cdr binding) '(fixnum pair))
+		(cdr binding))))
+	((not (pair? exp))
+	 #f)
+	((eq? (car exp) 'quote)
+	 (cond ((pair? (cadr exp)) 'pair)
+	       ((fixnum? (cadr exp)) 'fixnum)
+	       (else #f)))
+	((eq? (car exp) 'if)
+	 (and (pair? (cddr exp))
+	      (pair? (cdddr exp))
+	      (sys:type-join (sys:type-of (caddr exp) tenv)
+			     (sys:type-of (cadddr exp) tenv))))
+	((sys:builtin? (car exp) tenv)
+	 (cond ((memq (car exp) sys:fixnum-valued-subrs) 'fixnum)
+	       ((memq (car exp) sys:fixnum-preserving-subrs)
+		(and (sys:all? (lambda (type) (eq? type 'fixnum))
+			       (sys:types-of (cdr exp) tenv))
+		     'fixnum))
+	       ((eq? (car exp) 'cons) 'pair)
+	       ((and (eq? (car exp) 'list) (pair? (cdr exp))) 'pair)
+	       (else #f)))
+	(else
+	 #f)))
+
+;;; The (var . type) facts that hold when TEST evaluates to true (if
+;;; WHEN is #t) or to false (if WHEN is #f)
+(define (sys:facts test when tenv)
+  (if (pair? test)
+      (let ((op (car test)) (args (cdr test)))
+	(cond ((and (eq? op 'not) (sys:builtin? op tenv))
+	       (sys:facts (car args) (not when) tenv))
+	      ((and when (eq? op 'and))
+	       (sys:facts-of-all args #t tenv))
+	      ((and (not when) (eq? op 'or))
+	       (sys:facts-of-all args #f tenv))
+	      ((and when
+		    (memq op '(pair? fixnum?))
+		    (sys:builtin? op tenv)
+		    (symbol? (car args)))
+	       (list (cons (car args)
+			   (if (eq? op 'pair?) 'pair 'fixnum))))
+	      (else
+	       '())))
+      '()))
+
+(define (sys:facts-of-all tests when tenv)
+  (if (null? tests)
+      '()
+      (append (sys:facts (car tests) when tenv)
+	      (sys:facts-of-all (cdr tests) when tenv))))
+
+;;; Adds the facts about local, unassigned variables to TENV
+(define (sys:refine facts tenv)
+  (cond ((null? facts)
+	 tenv)
+	((let ((binding (assq (caar facts) tenv)))
+	   (and binding
+		(not (eq? (cdr binding) 'set!))
+		(not (sys:loop-binding? binding))))
+	 (cons (car facts) (sys:refine (cdr facts) tenv)))
+	(else
+	 (sys:refine (cdr facts) tenv))))
+
+
+;;; Closure conversion
+
+;;; A LAMBDA nested in a local scope is rewritten to
+;;; (SYS:LAMBDA (var...) args . body), where var... are the local
+;;; variables that the body refers to; the evaluator closes over those
+;;; bindings only.  A lambda whose body uses THE-ENVIRONMENT keeps the
+;;; whole environment.  The code is assumed to be evaluated at top
+;;; level.
+
+(define (sys:compile exp)
+  (sys:close-lambdas (if *optimize*
+			 (sys:specialize (sys:optimize (sys:simplify exp) '())
+					 '())
+			 (sys:simplify exp))
+		     '()))
+
+(define (sys:close-lambdas exp scope)
+  (if (pair? exp)
+      (let ((op (car exp)) (args (cdr exp)))
+	(cond ((or (eq? op 'quote) (eq? op 'sys:lambda))
+	       exp)
+	      ((eq? op 'lambda)
+	       (let ((body (sys:close-lambdas-body
+			    (cdr args)
+			    (sys:param-vars (car args) scope))))
+		 (if (or (null? scope)
+			 (sys:mentions? 'the-environment body))
+		     (list* 'lambda (car args) body)
+		     (list* 'sys:lambda
+			    (sys:free-vars-in
+			     (list* 'lambda (car args) body) scope)
+			    (car args)
+			    body))))
+	      ((eq? op 'let)
+	       (if (symbol? (car args))
+		   (list* 'let
+			  (car args)
+			  (sys:close-lambdas-bspecs (cadr args) scope)
+			  (sys:close-lambdas-body
+			   (cddr args)
+			   (cons (car args)
+				 (append (sys:let-vars (cadr args)) scope))))
+		   (list* 'let
+			  (sys:close-lambdas-bspecs (car args) scope)
+			  (sys:close-lambdas-body
+			   (cdr args)
+			   (append (sys:let-vars (car args)) scope)))))
+	      ((eq? op 'letrec)
+	       (let ((scope (append (sys:let-vars (car args)) scope)))
+		 (list* 'letrec
+			(sys:close-lambdas-bspecs (car args) scope)
+			(sys:close-lambdas-body (cdr args) scope))))
+	      ((eq? op 'do)
+	       (let ((inner (append (sys:let-vars (car args)) scope)))
+		 (list* 'do
+			(map1 (lambda (spec)
+				(list* (car spec)
+				       (sys:close-lambdas (cadr spec) scope)
+				       (sys:close-lambdas-body (cddr spec)
+							       inner)))
+			      (car args))
+			(sys:close-lambdas-body (cadr args) inner)
+			(sys:close-lambdas-body (cddr args) inner))))
+	      ((eq? op 'cond)
+	       (list* 'cond
+		      (map1 (lambda (clause)
+			      (if (eq? (car clause) 'else)
+				  (cons 'else
+					(sys:close-lambdas-body (cdr clause)
+								scope))
+				  (sys:close-lambdas-body clause scope)))
+			    args)))
+	      ((eq? op 'case)
+	       (list* 'case
+		      (sys:close-lambdas (car args) scope)
+		      (map1 (lambda (clause)
+			      (cons (car clause)
+				    (sys:close-lambdas-body (cdr clause)
+							    scope)))
+			    (cdr args))))
+	      ((or (eq? op 'set!) (eq? op 'define))
+	       (list op (car args) (sys:close-lambdas (cadr args) scope)))
+	      (else
+	       (sys:close-lambdas-body exp scope))))
+      exp))
+
+(define (sys:close-lambdas-body body scope)
+  (map1 (lambda (exp) (sys:close-lambdas exp scope)) body))
+
+(define (sys:close-lambdas-bspecs bspecs scope)
+  (map1 (lambda (bspec)
+	  (cons (car bspec) (sys:close-lambdas-body (cdr bspec) scope)))
+	bspecs))
+
+;;; (var...) of a parameter list, added to vars
+(define (sys:param-vars params vars)
+  (cond ((null? params) vars)
+	((symbol? params) (cons params vars))
+	(else (cons (car params) (sys:param-vars (cdr params) vars)))))
+
+(define (sys:mentions? sym tree)
+  (cond ((eq? sym tree) #t)
+	((pair? tree)
+	 (or (sys:mentions? sym (car tree))
+	     (sys:mentions? sym (cdr tree))))
+	(else #f)))
+
+;;; The variables of scope that occur free in exp
+(define (sys:free-vars-in exp scope)
+  (let loop ((vars (sys:free-vars exp '() '())) (acc '()))
+    (cond ((null? vars) acc)
+	  ((memq (car vars) scope)
+	   (loop (cdr vars) (cons (car vars) acc)))
+	  (else
+	   (loop (cdr vars) acc)))))
+
+(define (sys:free-vars exp bound acc)
+  (cond ((symbol? exp)
+	 (if (or (memq exp bound) (memq exp acc))
+	     acc
+	     (cons exp acc)))
+	((not (pair? exp))
+	 acc)
+	(else
+	 (let ((op (car exp)) (args (cdr exp)))
+	   (cond ((eq? op 'quote)
+		  acc)
+		 ((eq? op 'lambda)
+		  (sys:free-vars-body (cdr args)
+				      (sys:param-vars (car args) bound)
+				      acc))
+		 ((eq? op 'sys:lambda)
+		  (sys:free-vars-body (car args) bound acc))
+		 ((and (eq? op 'let) (symbol? (car args)))
+		  (sys:free-vars-body
+		   (cddr args)
+		   (cons (car args) (append (sys:let-vars (cadr args)) bound))
+		   (sys:free-vars-body (sys:let-exps (cadr args)) bound acc)))
+		 ((eq? op 'let)
+		  (sys:free-vars-body
+		   (cdr args)
+		   (append (sys:let-vars (car args)) bound)
+		   (sys:free-vars-body (sys:let-exps (car args)) bound acc)))
+		 ((eq? op 'letrec)
+		  (let ((bound (append (sys:let-vars (car args)) bound)))
+		    (sys:free-vars-body
+		     (cdr args)
+		     bound
+		     (sys:free-vars-body (sys:let-exps (car args)) bound acc))))
+		 ((eq? op 'do)
+		  (let ((inner (append (sys:let-vars (car args)) bound)))
+		    (sys:free-vars-body
+		     (append (map1 cddr (car args)) (cdr args))
+		     inner
+		     (sys:free-vars-body (sys:let-exps (car args))
+					 bound acc))))
+		 ((eq? op 'cond)
+		  (sys:free-vars-body
+		   (map1 (lambda (clause)
+			   (if (eq? (car clause) 'else)
+			       (cons 'begin (cdr clause))
+			       (cons 'begin clause)))
+			 args)
+		   bound acc))
+		 ((eq? op 'case)
+		  (sys:free-vars-body
+		   (map1 (lambda (clause) (cons 'begin (cdr clause)))
+			 (cdr args))
+		   bound
+		   (sys:free-vars (car args) bound acc)))
+		 (else
+		  (sys:free-vars-body exp bound acc)))))))
+
+(define (sys:free-vars-body body bound acc)
+  (if (pair? body)
+      (sys:free-vars-body (cdr body)
+			  bound
+			  (sys:free-vars (car body) bound acc))
+      acc))
+
 (define (sys:simplify-all inport outport)
   (let loop ((e (read inport)))
     (if (not (eof-object? e))
 	(begin
-	  (write (sys:simplify e) outport)
+	  (write (sys:compile e) outport)
 	  (newline outport)
 	  (loop (read inport))))))
 
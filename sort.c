@@ -0,0 +1,324 @@
+/*
+ * Tscheme: A Tiny Scheme Interpreter
+ * Copyright (c) 1995-2013 Takuo WATANABE (Tokyo Institute of Technology)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <setjmp.h>
+
+#include "tscheme.h"
+
+/* Sorting
+
+   SORT, SORT!, LIST-SORT, VECTOR-SORT and MERGE are stable natural
+   merge sorts.  The input is cut into its runs: an ascending run is
+   taken as it is, a strictly descending one is reversed.  The runs
+   are merged like the digits of a binary counter, so that the two
+   runs merged are of about the same length, and an input already in
+   order costs n - 1 comparisons.  A list is sorted by relinking its
+   pairs; a vector in place through a scratch vector, made only when
+   there are runs to merge.
+
+   A comparison is applied through apply_procedure, but a subr of two
+   arguments is called directly, and < or > on fixnums and string<?
+   are done inline. */
+
+enum { CMP_PROC, CMP_SUBR, CMP_LESSTHAN, CMP_GREATERTHAN, CMP_STRING };
+
+struct comparator {
+    int kind;
+    SCM proc;
+};
+
+/* The number of runs pending a merge is below 2^MAX_LEVELS */
+#define MAX_LEVELS 64
+
+static struct comparator comparator(SCM proc) {
+    struct comparator c;
+    c.proc = proc;
+    if (IS_SUBRN(proc) &&
+        SUBR_FUN(proc) == (SCM (*)(void))s_string_lessthan)
+        c.kind = CMP_STRING;
+    else if (!IS_SUBR2(proc))
+        c.kind = CMP_PROC;
+    else if (SUBR_FUN(proc) == (SCM (*)(void))s_lessthan)
+        c.kind = CMP_LESSTHAN;
+    else if (SUBR_FUN(proc) == (SCM (*)(void))s_greaterthan)
+        c.kind = CMP_GREATERTHAN;
+    else
+        c.kind = CMP_SUBR;
+    return c;
+}
+
+/* Whether X is less than Y by C */
+static bool less(struct comparator *c, SCM x, SCM y) {
+    switch (c->kind) {
+    case CMP_PROC:
+        return NEQ(apply_procedure(c->proc, CONS(x, CONS(y, NIL))),
+                   boolean_false);
+    case CMP_LESSTHAN:
+        if (IS_FIXNUM(x) && IS_FIXNUM(y))
+            return FIXNUM(x) < FIXNUM(y);
+        break;
+    case CMP_GREATERTHAN:
+        if (IS_FIXNUM(x) && IS_FIXNUM(y))
+            return FIXNUM(x) > FIXNUM(y);
+        break;
+    case CMP_STRING:
+        if (!IS_STRING(x))
+            wta_error("string<?", 1);
+        if (!IS_STRING(y))
+            wta_error("string<?", 2);
+        return string_compare(x, y) < 0;
+    }
+    return NEQ((*(SCM (*)(SCM, SCM))SUBR_FUN(c->proc))(x, y),
+               boolean_false);
+}
+
+static SCM list_arg(char *fname, SCM l, int argno) {
+    SCM p;
+    for (p = l; IS_PAIR(p); p = CDR(p))
+        ;
+    if (!IS_NULL(p))
+        wta_error(fname, argno);
+    return l;
+}
+
+/* Lists */
+
+/* Merges the sorted lists A and B by relinking their pairs; an
+   element of B goes first only if it is less than that of A */
+static SCM merge_lists(struct comparator *c, SCM a, SCM b) {
+    SCM r = NIL, *tail = &r;
+    while (IS_PAIR(a) && IS_PAIR(b)) {
+        if (less(c, CAR(b), CAR(a))) {
+            *tail = b;
+            b = CDR(b);
+        }
+        else {
+            *tail = a;
+            a = CDR(a);
+        }
+        tail = &CDR(*tail);
+    }
+    *tail = IS_PAIR(a) ? a : b;
+    return r;
+}
+
+/* Cuts the first run off the non-empty list L, leaving the rest in
+   *REST */
+static SCM take_run(struct comparator *c, SCM l, SCM *rest) {
+    SCM run, p, next;
+
+    if (IS_PAIR(CDR(l)) && less(c, CAR(CDR(l)), CAR(l))) {
+        /* strictly descending: reversed while it is cut off */
+        run = l;
+        p = CDR(l);
+        CDR(l) = NIL;
+        while (IS_PAIR(p) && less(c, CAR(p), CAR(run))) {
+            next = CDR(p);
+            CDR(p) = run;
+            run = p;
+            p = next;
+        }
+        *rest = p;
+        return run;
+    }
+    for (p = l; IS_PAIR(CDR(p)) && !less(c, CAR(CDR(p)), CAR(p));
+         p = CDR(p))
+        ;
+    *rest = CDR(p);
+    CDR(p) = NIL;
+    return l;
+}
+
+/* Sorts the proper list L by relinking its pairs.  RUNS[k] is a run
+   merged from about 2^k runs of the input, or NIL. */
+static SCM sort_list(struct comparator *c, SCM l) {
+    SCM runs[MAX_LEVELS], run;
+    int k, levels = 0;
+
+    while (IS_PAIR(l)) {
+        run = take_run(c, l, &l);
+        for (k = 0; k < levels && NEQ(runs[k], NIL); k++) {
+            run = merge_lists(c, runs[k], run);
+            runs[k] = NIL;
+        }
+        if (k == levels)
+            levels++;
+        runs[k] = run;
+    }
+    for (run = NIL, k = 0; k < levels; k++)
+        if (NEQ(runs[k], NIL))
+            run = merge_lists(c, runs[k], run);
+    return run;
+}
+
+static SCM copy_list(SCM l) {
+    SCM r = NIL, *tail = &r;
+    for (; IS_PAIR(l); l = CDR(l)) {
+        *tail = CONS(CAR(l), NIL);
+        tail = &CDR(*tail);
+    }
+    return r;
+}
+
+/* Vectors */
+
+/* Merges the sorted ranges [LO, MID) and [MID, HI) of VEC, the
+   first through the scratch vector *SCRATCH, which is made on the
+   first merge */
+static void merge_ranges(struct comparator *c, SCM vec, SCM *scratch,
+                         long lo, long mid, long hi) {
+    long i, n = mid - lo, k = lo;
+    SCM *v = VECTOR_DATA(vec), *tmp;
+
+    if (IS_NULL(*scratch))
+        *scratch = mk_vector(VECTOR_DIM(vec), unspecified_value);
+    tmp = VECTOR_DATA(*scratch);
+    for (i = 0; i < n; i++)
+        tmp[i] = v[lo + i];
+    i = 0;
+    while (i < n && mid < hi)
+        v[k++] = less(c, v[mid], tmp[i]) ? v[mid++] : tmp[i++];
+    while (i < n)
+        v[k++] = tmp[i++];
+}
+
+/* The end of the run of V starting at LO, before N */
+static long find_run(struct comparator *c, SCM *v, long lo, long n) {
+    long hi = lo + 1, i, j;
+    SCM x;
+
+    if (hi < n && less(c, v[hi], v[lo])) {
+        while (++hi < n && less(c, v[hi], v[hi - 1]))
+            ;
+        for (i = lo, j = hi - 1; i < j; i++, j--) {
+            x = v[i];
+            v[i] = v[j];
+            v[j] = x;
+        }
+        return hi;
+    }
+    while (hi < n && !less(c, v[hi], v[hi - 1]))
+        hi++;
+    return hi;
+}
+
+/* Sorts the vector VEC in place.  The pending runs are adjacent:
+   run k starts at START[k] and was merged from about 2^LEVEL[k] runs
+   of the input, LEVEL decreasing along the stack. */
+static void sort_vector(struct comparator *c, SCM vec) {
+    long n = VECTOR_DIM(vec), lo, hi, start[MAX_LEVELS];
+    int level[MAX_LEVELS], top = 0, l;
+    SCM scratch = NIL;
+
+    for (lo = 0; lo < n; lo = hi) {
+        hi = find_run(c, VECTOR_DATA(vec), lo, n);
+        for (l = 0; top > 0 && level[top - 1] == l; l++) {
+            top--;
+            merge_ranges(c, vec, &scratch, start[top], lo, hi);
+            lo = start[top];
+        }
+        start[top] = lo;
+        level[top++] = l;
+    }
+    for (; top > 1; top--)
+        merge_ranges(c, vec, &scratch, start[top - 2], start[top - 1], n);
+}
+
+static SCM copy_vector(SCM vec) {
+    SCM r = mk_vector(VECTOR_DIM(vec), unspecified_value);
+    long i;
+    for (i = 0; i < VECTOR_DIM(vec); i++)
+        VECTOR_DATA(r)[i] = VECTOR_DATA(vec)[i];
+    return r;
+}
+
+/* Sorts SEQ, argument ARGNO of FNAME, in place if INPLACE */
+static SCM sort(char *fname, SCM seq, SCM proc, int argno, bool inplace) {
+    struct comparator c = comparator(proc);
+
+    if (IS_VECTOR(seq)) {
+        if (!inplace)
+            seq = copy_vector(seq);
+        sort_vector(&c, seq);
+        return seq;
+    }
+    list_arg(fname, seq, argno);
+    return sort_list(&c, inplace ? seq : copy_list(seq));
+}
+
+/* SORT sequence less? */
+SCM s_sort(SCM seq, SCM proc) {
+    return sort("sort", seq, proc, 1, false);
+}
+
+/* SORT! sequence less? -- a list is relinked, and its sorted value
+   is the result */
+SCM s_sort_x(SCM seq, SCM proc) {
+    return sort("sort!", seq, proc, 1, true);
+}
+
+/* LIST-SORT less? list */
+SCM s_list_sort(SCM proc, SCM list) {
+    struct comparator c = comparator(proc);
+    return sort_list(&c, copy_list(list_arg("list-sort", list, 2)));
+}
+
+/* VECTOR-SORT less? vector */
+SCM s_vector_sort(SCM proc, SCM vec) {
+    if (!IS_VECTOR(vec))
+        wta_error("vector-sort", 2);
+    return sort("vector-sort", vec, proc, 2, false);
+}
+
+/* MERGE list list less? -- the sorted lists are not changed */
+SCM s_merge(SCM a, SCM b, SCM proc) {
+    struct comparator c = comparator(proc);
+    SCM r = NIL, *tail = &r;
+
+    list_arg("merge", a, 1);
+    list_arg("merge", b, 2);
+    while (IS_PAIR(a) && IS_PAIR(b)) {
+        if (less(&c, CAR(b), CAR(a))) {
+            *tail = CONS(CAR(b), NIL);
+            b = CDR(b);
+        }
+        else {
+            *tail = CONS(CAR(a), NIL);
+            a = CDR(a);
+        }
+        tail = &CDR(*tail);
+    }
+    *tail = copy_list(IS_PAIR(a) ? a : b);
+    return r;
+}
+
+void init_sort_subrs(void) {
+    mk_subr("SORT", (SCM (*)(void))s_sort, 2);
+    mk_subr("SORT!", (SCM (*)(void))s_sort_x, 2);
+    mk_subr("LIST-SORT", (SCM (*)(void))s_list_sort, 2);
+    mk_subr("VECTOR-SORT", (SCM (*)(void))s_vector_sort, 2);
+    mk_subr("MERGE", (SCM (*)(void))s_merge, 3);
+}
@@ -34,6 +34,7 @@ static SCM heap_start, heap_end;
 SCM free_list;
 SCM stack_start;
 static int mark_counter;
+long stat_cells_allocated;
 
 SCM obarray[DEFAULT_OBARRAY_SIZE];
 long obarray_dim = DEFAULT_OBARRAY_SIZE;
@@ -46,7 +47,7 @@ stdin_value, stdout_value, stderr_value, eof_value,
     sym_quote, sym_quasiquote, sym_unquote, sym_unquote_splicing,
     sym_lambda, sym_and, sym_or, sym_let, sym_let_star, sym_letrec,
     sym_begin, sym_do, sym_delay, sym_if, sym_cond, sym_case, sym_else,
-    sym_set, sym_define, sym_dot;
+    sym_set, sym_define, sym_dot, sym_sys_lambda;
 
 SCM sym_toplevel;
 
@@ -77,11 +78,20 @@ void gc(void) {
     fprintf(stderr, "GC: stack:     ");
     gc_mark_locations((SCM *)stack_start, (SCM *)&stack_end_var);
 
+    /* Frames of the explicit-stack evaluator */
+    fprintf(stderr, "GC: eval stack: ");
+    gc_mark_locations_array(eval_stack, eval_stack_ptr);
+
+    /* Multiple values */
+    fprintf(stderr, "GC: values:    ");
+    gc_mark_locations_array(mv_values, mv_count);
+
     /* Obarray */
     fprintf(stderr, "GC: obarray:   ");
     gc_mark_locations_array(obarray, obarray_dim);
 
     gc_sweep();
+    invalidate_call_caches();
 
     /* Resume signal settings */
     signal(SIGINT, interrupt_handler);
@@ -141,10 +151,66 @@ static void gc_mark(SCM p) {
         case T_ENV:
             pp = ENV(pp);
             goto gc_mark_loop;
+        case T_PROMISE:
+            pp = PROMISE_BOX(pp);
+            goto gc_mark_loop;
+        case T_VECTOR: {
+            long i, n = VECTOR_DIM(pp);
+            if (n == 0)
+                break;
+            for (i = 0; i < n - 1; i++)
+                gc_mark(VECTOR_DATA(pp)[i]);
+            pp = VECTOR_DATA(pp)[n - 1];
+            goto gc_mark_loop;
+        }
+        case T_HASHTABLE: {
+            struct hashtable *t = HASHTABLE(pp);
+            long i;
+            for (i = 0; i < t->size; i++)
+                if (t->entries[i].key != NULL) {
+                    gc_mark(t->entries[i].key);
+                    gc_mark(t->entries[i].value);
+                }
+            if (t->equiv != NULL)
+                gc_mark(t->equiv);
+            if (t->hash != NULL)
+                gc_mark(t->hash);
+            break;
+        }
+        case T_HAMT_NODE: {
+            long i, n = 1 + 2 * HAMT_COUNT(pp);
+            for (i = 0; i < n; i++)
+                if (HAMT_SLOTS(pp)[i] != NULL)
+                    gc_mark(HAMT_SLOTS(pp)[i]);
+            break;
+        }
+        case T_MAP:
+        case T_SET:
+            pp = MAP_ROOT(pp);
+            goto gc_mark_loop;
+        case T_RECORD_TYPE:
+            gc_mark(RTD_NAME(pp));
+            pp = RTD_FIELDS(pp);
+            goto gc_mark_loop;
+        case T_RECORD: {
+            long i, n = RTD_NFIELDS(RECORD_RTD(pp));
+            for (i = 0; i < n; i++)
+                gc_mark(RECORD_FIELDS(pp)[i]);
+            pp = RECORD_RTD(pp);
+            goto gc_mark_loop;
+        }
+        case T_RECORD_PROC:
+            gc_mark(RECPROC_RTD(pp));
+            pp = RECPROC_INFO(pp);
+            goto gc_mark_loop;
+        case T_STRING:
+            if (STR_BASE(pp) == NULL)
+                break;
+            pp = STR_BASE(pp);
+            goto gc_mark_loop;
         case T_NULL:
         case T_BOOLEAN:
         case T_CHARACTER:
-        case T_STRING:
         case T_SUBR0:
         case T_SUBR1:
         case T_SUBR2:
@@ -153,6 +219,10 @@ static void gc_mark(SCM p) {
         case T_FSUBR:
         case T_PORT:
         case T_EOF_VALUE:
+        case T_BYTEVECTOR:
+        case T_S32VECTOR:
+        case T_FLONUM:
+        case T_BIGNUM:
             break;
         default:
             fprintf(stderr, "DEBUG: Should not reach here! (tt=%d)\n",
@@ -170,11 +240,33 @@ static void gc_sweep(void) {
         if (UNMARKED(p)) {
             switch BOXED_TYPE(p) {
                 case T_STRING:
-                    free(STR_DATA(p));
+                    free(STR_BODY(p));
+                    break;
+                case T_VECTOR:
+                    free(VECTOR_DATA(p));
+                    break;
+                case T_BYTEVECTOR:
+                case T_S32VECTOR:
+                    free(NUMVEC_DATA(p));
+                    break;
+                case T_BIGNUM:
+                    free(BIG_DIGITS(p));
+                    break;
+                case T_HASHTABLE:
+                    free(HASHTABLE(p)->entries);
+                    free(HASHTABLE(p));
+                    break;
+                case T_HAMT_NODE:
+                    free(HAMT_SLOTS(p));
+                    break;
+                case T_RECORD:
+                    free(RECORD_FIELDS(p));
                     break;
                 case T_PORT:
-                    fclose(PORT_FPTR(p));
-                    fprintf(stderr, "file %s is closed\n", PORT_NAME(p));
+                    if (PORT_FPTR(p) != NULL) {
+                        fclose(PORT_FPTR(p));
+                        fprintf(stderr, "file %s is closed\n", PORT_NAME(p));
+                    }
                     break;
                 default:
                     break;
@@ -233,6 +325,7 @@ void init_storage(unsigned heapsize) {
     ptr = free_list = heap_start;
     count = 0;
     while (true) {
+        GC_TAGS(ptr) = (unsigned short)0;
         SET_BOXED_TYPE(ptr, T_FREE_CELL);
         next = ptr + 1;
         count++;
@@ -276,6 +369,7 @@ void init_storage(unsigned heapsize) {
     sym_set = mk_symbol("SET!");
     sym_define = mk_symbol("DEFINE");
     sym_dot = mk_symbol(".");
+    sym_sys_lambda = mk_symbol("SYS:LAMBDA");
 
     sym_toplevel = mk_symbol("SYS:TOPLEVEL");
 
@@ -0,0 +1,215 @@
+/*
+ * Tscheme: A Tiny Scheme Interpreter
+ * Copyright (c) 1995-2013 Takuo WATANABE (Tokyo Institute of Technology)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <setjmp.h>
+
+#include "tscheme.h"
+
+/* Strings
+
+   The characters of a string are kept in a body out of its cell (see
+   struct string in tscheme.h), which gc frees together with the
+   cell.  A string made by the reader or by a procedure owns its
+   buffer.  SUBSTRING makes a slice instead, which shares the buffer
+   of the string it is taken from and keeps that string alive, so it
+   takes constant time.  Since strings are not changed in place, a
+   slice needs no copy on write; but a short slice costs less to copy
+   than to share, and a slice referring to a small part of a large
+   buffer would keep all of it, so substrings of less than SLICE_MIN
+   characters or of less than 1/SLICE_RATIO of the buffer are copied.
+
+   The characters of a slice are not followed by a NUL, so the C
+   string of a string is taken with string_cstring, which turns a
+   slice into a string owning a copy when it has to.  The hash of a
+   string (see hashtable.c) is cached in its body. */
+
+#define SLICE_MIN   32
+#define SLICE_RATIO 8
+
+/* The characters of S as a C string */
+char *string_cstring(SCM s) {
+    struct string *body;
+
+    if (STR_DATA(s)[STR_DIM(s)] == '\0')
+        return STR_DATA(s);
+    body = mk_string_body(STR_DATA(s), STR_DIM(s));
+    free(STR_BODY(s));
+    STR_BODY(s) = body;
+    return STR_DATA(s);
+}
+
+/* Whether the strings X and Y have the same characters */
+int string_equal(SCM x, SCM y) {
+    if (STR_DIM(x) != STR_DIM(y))
+        return NO;
+    if (STR_DATA(x) == STR_DATA(y))
+        return YES;
+    if (STR_HASH(x) != 0 && STR_HASH(y) != 0 && STR_HASH(x) != STR_HASH(y))
+        return NO;
+    return memcmp(STR_DATA(x), STR_DATA(y), STR_DIM(x)) == 0;
+}
+
+/* <0, 0 or >0 as the string X is before, the same as or after Y */
+int string_compare(SCM x, SCM y) {
+    long n = STR_DIM(x) < STR_DIM(y) ? STR_DIM(x) : STR_DIM(y);
+    int c = memcmp(STR_DATA(x), STR_DATA(y), n);
+    if (c != 0)
+        return c;
+    return STR_DIM(x) < STR_DIM(y) ? -1 : STR_DIM(x) > STR_DIM(y);
+}
+
+static SCM string_arg(char *fname, SCM s, int argno) {
+    if (!IS_STRING(s))
+        wta_error(fname, argno);
+    return s;
+}
+
+/* The index K of a character of S, which is argument ARGNO of FNAME;
+   with endp, K may also be the length of S. */
+static long string_index(char *fname, SCM s, SCM k, int argno,
+                         bool endp) {
+    if (!IS_FIXNUM(k))
+        wta_error(fname, argno);
+    if (FIXNUM(k) < 0 || FIXNUM(k) > STR_DIM(s) ||
+        (FIXNUM(k) == STR_DIM(s) && !endp))
+        error1("ERROR: %s: Index out of range.\n", fname);
+    return FIXNUM(k);
+}
+
+/* Reads the optional START and END arguments in ARGS, the first of
+   which is argument ARGNO of FNAME, into *START and *END. */
+static void string_range(char *fname, SCM s, SCM args, int argno,
+                         long *start, long *end) {
+    *start = 0;
+    *end = STR_DIM(s);
+    if (IS_PAIR(args)) {
+        *start = string_index(fname, s, CAR(args), argno, true);
+        args = CDR(args);
+    }
+    if (IS_PAIR(args))
+        *end = string_index(fname, s, CAR(args), argno + 1, true);
+    if (*end < *start)
+        error1("ERROR: %s: Index out of range.\n", fname);
+}
+
+/* STRING-LENGTH string */
+SCM s_string_length(SCM s) {
+    return MK_FIXNUM(STR_DIM(string_arg("string-length", s, 1)));
+}
+
+/* STRING-REF string k */
+SCM s_string_ref(SCM s, SCM k) {
+    string_arg("string-ref", s, 1);
+    return mk_character((unsigned char)
+                        STR_DATA(s)[string_index("string-ref", s, k, 2,
+                                                 false)]);
+}
+
+/* SUBSTRING string start end */
+SCM s_substring(SCM s, SCM start, SCM end) {
+    SCM base;
+    long i, j;
+
+    string_arg("substring", s, 1);
+    i = string_index("substring", s, start, 2, true);
+    j = string_index("substring", s, end, 3, true);
+    if (j < i)
+        error1("ERROR: %s: Index out of range.\n", "substring");
+    if (i == 0 && j == STR_DIM(s))
+        return s;
+    base = STR_BASE(s) != NULL ? STR_BASE(s) : s;
+    if (j - i < SLICE_MIN || (j - i) * SLICE_RATIO < STR_DIM(base))
+        return mk_string(STR_DATA(s) + i, j - i);
+    return mk_string_slice(base, STR_DATA(s) + i, j - i);
+}
+
+/* STRING-COPY string [start [end]] -- a string owning its buffer */
+SCM s_string_copy(SCM args) {
+    SCM s;
+    long start, end;
+
+    check_nargs("string-copy", args, 1, 3);
+    s = string_arg("string-copy", CAR(args), 1);
+    string_range("string-copy", s, CDR(args), 2, &start, &end);
+    return mk_string(STR_DATA(s) + start, end - start);
+}
+
+/* STRING->LIST string [start [end]] */
+SCM s_string_to_list(SCM args) {
+    SCM s, l = NIL;
+    long start, i;
+
+    check_nargs("string->list", args, 1, 3);
+    s = string_arg("string->list", CAR(args), 1);
+    string_range("string->list", s, CDR(args), 2, &start, &i);
+    while (i > start)
+        l = CONS(mk_character((unsigned char)STR_DATA(s)[--i]), l);
+    return l;
+}
+
+static int string_less(SCM x, SCM y) {
+    return string_compare(x, y) < 0;
+}
+
+/* Whether TEST holds for each string in ARGS of FNAME and the next */
+static SCM string_order(char *fname, SCM args, int (*test)(SCM, SCM)) {
+    SCM l;
+    int i;
+
+    if (!IS_PAIR(args))
+        wna_error(fname, 0);
+    string_arg(fname, CAR(args), 1);
+    for (l = args, i = 2; IS_PAIR(CDR(l)); l = CDR(l), i++)
+        if (!test(CAR(l), string_arg(fname, CADR(l), i)))
+            return boolean_false;
+    return boolean_true;
+}
+
+/* STRING=? string string... */
+SCM s_string_equal(SCM args) {
+    return string_order("string=?", args, string_equal);
+}
+
+/* STRING<? string string... */
+SCM s_string_lessthan(SCM args) {
+    return string_order("string<?", args, string_less);
+}
+
+void init_string_subrs(void) {
+    mk_subr("STRING-LENGTH", (SCM (*)(void))s_string_length, 1);
+    mk_subr("STRING-REF", (SCM (*)(void))s_string_ref, 2);
+    mk_subr("SUBSTRING", (SCM (*)(void))s_substring, 3);
+    SET_FLAG(mk_subr("STRING-COPY", (SCM (*)(void))s_string_copy, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("STRING->LIST", (SCM (*)(void))s_string_to_list, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("STRING=?", (SCM (*)(void))s_string_equal, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("STRING<?", (SCM (*)(void))s_string_lessthan, -1),
+             FLAG_STACK_ARGS);
+}
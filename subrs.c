@@ -26,6 +26,7 @@
 #include <stdlib.h>
 #include <setjmp.h>
 #include <string.h>
+#include <math.h>
 
 #include "tscheme.h"
 
@@ -131,15 +132,202 @@ SCM s_memq(SCM key, SCM list) {
     return boolean_false;
 }
 
-/* LAST list */
+/* ASSQ obj alist */
+SCM s_assq(SCM key, SCM alist) {
+    SCM l = alist;
+    while (!IS_NULL(l)) {
+        if (!IS_PAIR(l) || !IS_PAIR(CAR(l)))
+            wta_error("assq", 2);
+        if (EQ(key, CAAR(l)))
+            return CAR(l);
+        l = CDR(l);
+    }
+    return boolean_false;
+}
+
+/* C[AD]+R pair: OPS are the letters between C and R, applied from
+   the right */
+static SCM cxr(char *fname, char *ops, SCM x) {
+    char *p = ops + strlen(ops);
+    while (p-- > ops) {
+        if (!IS_PAIR(x))
+            wta_error(fname, 1);
+        x = *p == 'a' ? CAR(x) : CDR(x);
+    }
+    return x;
+}
+
+#define DEFINE_CXR(ops)                                 \
+    static SCM s_c##ops##r(SCM x) {                     \
+        return cxr("c" #ops "r", #ops, x);              \
+    }
+
+DEFINE_CXR(aa) DEFINE_CXR(ad) DEFINE_CXR(da) DEFINE_CXR(dd)
+DEFINE_CXR(aaa) DEFINE_CXR(aad) DEFINE_CXR(ada) DEFINE_CXR(add)
+DEFINE_CXR(daa) DEFINE_CXR(dad) DEFINE_CXR(dda) DEFINE_CXR(ddd)
+DEFINE_CXR(aaaa) DEFINE_CXR(aaad) DEFINE_CXR(aada) DEFINE_CXR(aadd)
+DEFINE_CXR(adaa) DEFINE_CXR(adad) DEFINE_CXR(adda) DEFINE_CXR(addd)
+DEFINE_CXR(daaa) DEFINE_CXR(daad) DEFINE_CXR(dada) DEFINE_CXR(dadd)
+DEFINE_CXR(ddaa) DEFINE_CXR(ddad) DEFINE_CXR(ddda) DEFINE_CXR(dddd)
+
+/* The list functions below loop along their lists; a result is built
+   from its head, appending each new pair at *tail. */
+
+/* Checks that L, argument ARGNO of FNAME, is a proper list */
+static SCM list_arg(char *fname, SCM l, int argno) {
+    SCM p;
+    for (p = l; IS_PAIR(p); p = CDR(p))
+        ;
+    if (!IS_NULL(p))
+        wta_error(fname, argno);
+    return l;
+}
+
+/* Appends a copy of the proper list L at *TAIL; returns the new tail */
+static SCM *copy_list_at(SCM *tail, SCM l) {
+    for (; IS_PAIR(l); l = CDR(l)) {
+        *tail = CONS(CAR(l), NIL);
+        tail = &CDR(*tail);
+    }
+    return tail;
+}
+
+/* LAST list -- the last element */
 SCM s_last(SCM list) {
     SCM p = list;
-    if (!(IS_PAIR(p) || IS_NULL(p)))
+    if (!IS_PAIR(p))
         wta_error("last", 1);
-    if (IS_PAIR(p))
-        while (IS_PAIR(CDR(p)))
-            p = CDR(p);
-    return p;
+    while (IS_PAIR(CDR(p)))
+        p = CDR(p);
+    return CAR(p);
+}
+
+/* BUTLAST list -- a copy without the last element */
+SCM s_butlast(SCM list) {
+    SCM r = NIL, *tail = &r, p = list;
+    if (!IS_PAIR(p))
+        wta_error("butlast", 1);
+    for (; IS_PAIR(CDR(p)); p = CDR(p)) {
+        *tail = CONS(CAR(p), NIL);
+        tail = &CDR(*tail);
+    }
+    return r;
+}
+
+/* APPEND list... x -- the lists but the last are copied */
+SCM n_append(SCM args) {
+    SCM r = NIL, *tail = &r;
+    int i;
+    for (i = 1; IS_PAIR(args) && IS_PAIR(CDR(args)); args = CDR(args), i++)
+        tail = copy_list_at(tail, list_arg("append", CAR(args), i));
+    if (IS_PAIR(args))
+        *tail = CAR(args);
+    return r;
+}
+
+/* LIST* x... y -- (x... . y) */
+SCM n_list_star(SCM args) {
+    SCM r = NIL, *tail = &r;
+    for (; IS_PAIR(args) && IS_PAIR(CDR(args)); args = CDR(args)) {
+        *tail = CONS(CAR(args), NIL);
+        tail = &CDR(*tail);
+    }
+    if (IS_PAIR(args))
+        *tail = CAR(args);
+    return r;
+}
+
+/* REVERSE list */
+SCM s_reverse(SCM list) {
+    SCM r = NIL, l;
+    for (l = list_arg("reverse", list, 1); IS_PAIR(l); l = CDR(l))
+        r = CONS(CAR(l), r);
+    return r;
+}
+
+/* ASSOC obj alist [compare] -- by EQUAL? unless COMPARE is given */
+SCM n_assoc(SCM args) {
+    SCM key, l, compare = NIL;
+    if (check_nargs("assoc", args, 2, 3) == 3)
+        compare = THIRD(args);
+    key = FIRST(args);
+    for (l = SECOND(args); !IS_NULL(l); l = CDR(l)) {
+        if (!IS_PAIR(l) || !IS_PAIR(CAR(l)))
+            wta_error("assoc", 2);
+        if (IS_NULL(compare) ? equal(key, CAAR(l)) :
+            NEQ(apply_procedure(compare, CONS(key, CONS(CAAR(l), NIL))),
+                boolean_false))
+            return CAR(l);
+    }
+    return boolean_false;
+}
+
+/* MAP1 f list */
+SCM s_map1(SCM f, SCM list) {
+    SCM r = NIL, *tail = &r, l;
+    for (l = list_arg("map", list, 2); IS_PAIR(l); l = CDR(l)) {
+        *tail = CONS(apply_procedure(f, CONS(CAR(l), NIL)), NIL);
+        tail = &CDR(*tail);
+    }
+    return r;
+}
+
+/* The arguments to F from the heads of LISTS, whose pairs are
+   advanced to their cdrs, or NIL when one of them is exhausted */
+static SCM next_args(char *fname, SCM lists) {
+    SCM args = NIL, *tail = &args;
+    int i;
+    for (i = 2; IS_PAIR(lists); lists = CDR(lists), i++) {
+        if (!IS_PAIR(CAR(lists))) {
+            if (!IS_NULL(CAR(lists)))
+                wta_error(fname, i);
+            return NIL;
+        }
+        *tail = CONS(CAAR(lists), NIL);
+        tail = &CDR(*tail);
+        CAR(lists) = CDAR(lists);
+    }
+    return args;
+}
+
+/* Applies F to the elements of the lists in ARGS = (f list...) in
+   turn, stopping at the end of the shortest; collects the results if
+   MAP is set */
+static SCM map_lists(char *fname, SCM args, int map) {
+    SCM f, lists, r = NIL, *tail = &r, x;
+
+    if (!IS_PAIR(args) || !IS_PAIR(CDR(args)))
+        wna_error(fname, IS_PAIR(args) ? 1 : 0);
+    f = CAR(args);
+    lists = NIL;                /* a copy, whose cars are advanced */
+    copy_list_at(&lists, CDR(args));
+    while (NEQ(x = next_args(fname, lists), NIL)) {
+        x = apply_procedure(f, x);
+        if (map) {
+            *tail = CONS(x, NIL);
+            tail = &CDR(*tail);
+        }
+    }
+    return map ? r : unspecified_value;
+}
+
+/* MAP f list... */
+SCM n_map(SCM args) {
+    if (IS_PAIR(args) && IS_PAIR(CDR(args)) && IS_NULL(CDDR(args)))
+        return s_map1(FIRST(args), SECOND(args));
+    return map_lists("map", args, YES);
+}
+
+/* FOR-EACH f list... */
+SCM n_for_each(SCM args) {
+    SCM l;
+    if (IS_PAIR(args) && IS_PAIR(CDR(args)) && IS_NULL(CDDR(args))) {
+        for (l = list_arg("for-each", SECOND(args), 2); IS_PAIR(l);
+             l = CDR(l))
+            apply_procedure(FIRST(args), CONS(CAR(l), NIL));
+        return unspecified_value;
+    }
+    return map_lists("for-each", args, NO);
 }
 
 /* APPEND list list */
@@ -229,7 +417,7 @@ SCM s_symbol_to_string(SCM symbol) {
 SCM s_string_to_symbol(SCM s) {
     if (!IS_STRING(s))
         wta_error("string->symbol", 1);
-    return (mk_symbol(STR_DATA(s)));
+    return (mk_symbol(string_cstring(s)));
 }
 
 /* String */
@@ -239,159 +427,503 @@ SCM s_stringp(SCM x) {
 }
 
 SCM s_string_append(SCM strings) {
-    SCM xs = strings;
-    int nargs = 0, len = 0;
+    SCM xs = strings, x;
+    int nargs = 0;
+    long len = 0, p = 0;
     while (!IS_NULL(xs)) {
         nargs++;
         if (!IS_STRING(CAR(xs))) wta_error("string-append", nargs);
         len += STR_DIM(CAR(xs));
         xs = CDR(xs);
     }
-    char *buf;
-    if ((buf = (char *)malloc(len + 1)) == NULL)
-        fatal_error("malloc: s_string_append");
-    xs = strings;
-    int p = 0;
-    while (!IS_NULL(xs)) {
-        int i = 0;
-        int d = STR_DIM(CAR(xs));
-        char *s = STR_DATA(CAR(xs));
-        while (i<d) buf[p++] = s[i++];
-        xs = CDR(xs);
+    x = mk_string(NULL, len);
+    for (xs = strings; !IS_NULL(xs); xs = CDR(xs)) {
+        memcpy(STR_DATA(x) + p, STR_DATA(CAR(xs)), STR_DIM(CAR(xs)));
+        p += STR_DIM(CAR(xs));
     }
-    buf[p] = '\0';
-    SCM x;
-    NEWCELL(x, T_STRING);
-    STR_DIM(x) = len;
-    STR_DATA(x) = buf;
     return x;
 }
 
-/* Fixnum */
+/* Numbers
+
+   A number is an exact integer, which is a fixnum or a bignum (see
+   bignum.c), or a flonum.  Arithmetic on fixnums checks for overflow
+   and goes on with bignums when the result does not fit; if either
+   operand is a flonum, the other is converted and the result is a
+   flonum.  / is the truncated quotient of two exact integers and
+   flonum division otherwise. */
+
+/* The value of X, argument ARGNO of FNAME, as a double */
+static double num_arg(char *fname, SCM x, int argno) {
+    if (IS_FIXNUM(x))
+        return (double)FIXNUM(x);
+    if (IS_BIGNUM(x))
+        return big_to_double(x);
+    if (!IS_FLONUM(x))
+        wta_error(fname, argno);
+    return FLONUM(x);
+}
 
-/* NUMBER? x */
+#define BOOL(c) ((c) ? boolean_true : boolean_false)
+
+#define NUM_COMPARE(fname, x, y, op)                            \
+    if (IS_FIXNUM(x) && IS_FIXNUM(y))                           \
+        return BOOL(FIXNUM(x) op FIXNUM(y));                    \
+    if (IS_EXACT(x) && IS_EXACT(y))                             \
+        return BOOL(big_compare(x, y) op 0);                    \
+    return BOOL(num_arg(fname, x, 1) op num_arg(fname, y, 2))
+
+/* NUMBER? x, REAL? x */
 SCM s_numberp(SCM x) {
-    return IS_FIXNUM(x) ? boolean_true : boolean_false;
+    return BOOL(IS_NUMBER(x));
+}
+
+/* INTEGER? x */
+SCM s_integerp(SCM x) {
+    return BOOL(IS_EXACT(x) ||
+                (IS_FLONUM(x) && isfinite(FLONUM(x)) &&
+                 FLONUM(x) == floor(FLONUM(x))));
+}
+
+/* FIXNUM? x */
+SCM s_fixnump(SCM x) {
+    return BOOL(IS_FIXNUM(x));
+}
+
+/* BIGNUM? x */
+SCM s_bignump(SCM x) {
+    return BOOL(IS_BIGNUM(x));
+}
+
+/* FLONUM? x */
+SCM s_flonump(SCM x) {
+    return BOOL(IS_FLONUM(x));
+}
+
+/* EXACT? z */
+SCM s_exactp(SCM x) {
+    num_arg("exact?", x, 1);
+    return BOOL(IS_EXACT(x));
+}
+
+/* INEXACT? z */
+SCM s_inexactp(SCM x) {
+    num_arg("inexact?", x, 1);
+    return BOOL(IS_FLONUM(x));
+}
+
+/* Whether X and Y are eqv: flonums are the same if their bits are,
+   and characters, which are boxed, if their codes are */
+int eqv(SCM x, SCM y) {
+    if (IS_CHARACTER(x) && IS_CHARACTER(y))
+        return CHARACTER(x) == CHARACTER(y);
+    if (IS_FLONUM(x) && IS_FLONUM(y))
+        return memcmp(&FLONUM(x), &FLONUM(y), sizeof(double)) == 0;
+    if (IS_BIGNUM(x) && IS_BIGNUM(y))
+        return big_compare(x, y) == 0;
+    return EQ(x, y);
+}
+
+/* Whether X and Y are equal: eqv, or pairs, vectors, strings or
+   numeric vectors with equal contents.  Lists are followed along
+   their cdrs without recursion. */
+int equal(SCM x, SCM y) {
+    long i;
+
+    for (; IS_PAIR(x) && IS_PAIR(y); x = CDR(x), y = CDR(y))
+        if (!equal(CAR(x), CAR(y)))
+            return NO;
+    if (eqv(x, y))
+        return YES;
+    if (IS_STRING(x) && IS_STRING(y))
+        return string_equal(x, y);
+    if (IS_VECTOR(x) && IS_VECTOR(y)) {
+        if (VECTOR_DIM(x) != VECTOR_DIM(y))
+            return NO;
+        for (i = 0; i < VECTOR_DIM(x); i++)
+            if (!equal(VECTOR_DATA(x)[i], VECTOR_DATA(y)[i]))
+                return NO;
+        return YES;
+    }
+    if ((IS_BYTEVECTOR(x) && IS_BYTEVECTOR(y)) ||
+        (IS_S32VECTOR(x) && IS_S32VECTOR(y)))
+        return NUMVEC_DIM(x) == NUMVEC_DIM(y) &&
+            memcmp(NUMVEC_DATA(x), NUMVEC_DATA(y),
+                   NUMVEC_DIM(x) * (IS_BYTEVECTOR(x) ? 1 : sizeof(int)))
+            == 0;
+    return NO;
+}
+
+/* EQV? x y */
+SCM s_eqv(SCM x, SCM y) {
+    return BOOL(eqv(x, y));
+}
+
+/* EQUAL? x y */
+SCM s_equal(SCM x, SCM y) {
+    return BOOL(equal(x, y));
 }
 
 /* ZERO? n */
 SCM s_zerop(SCM x) {
-    if (!IS_FIXNUM(x))
-        wta_error("zero?", 1);
-    return EQ(MK_FIXNUM(0),x) ? boolean_true : boolean_false;
+    if (IS_EXACT(x))
+        return BOOL(EQ(MK_FIXNUM(0), x));
+    return BOOL(num_arg("zero?", x, 1) == 0.0);
 }
 
 /* + n n */
 SCM s_plus(SCM x, SCM y) {
-    if (!IS_FIXNUM(x))
-        wta_error("+", 1);
-    if (!IS_FIXNUM(y))
-        wta_error("+", 2);
-    return MK_FIXNUM(FIXNUM(x) + FIXNUM(y));
+    int r;
+    if (IS_FIXNUM(x) && IS_FIXNUM(y) && FIXNUM_ADD(x, y, &r))
+        return FIXNUM_OF_BITS(r);
+    if (IS_EXACT(x) && IS_EXACT(y))
+        return big_add(x, y);
+    return mk_flonum(num_arg("+", x, 1) + num_arg("+", y, 2));
 }
 
 /* - n n */
 SCM s_minus(SCM x, SCM y) {
-    if (!IS_FIXNUM(x))
-        wta_error("-", 1);
-    if (!IS_FIXNUM(y))
-        wta_error("-", 2);
-    return MK_FIXNUM(FIXNUM(x) - FIXNUM(y));
+    int r;
+    if (IS_FIXNUM(x) && IS_FIXNUM(y) && FIXNUM_SUB(x, y, &r))
+        return FIXNUM_OF_BITS(r);
+    if (IS_EXACT(x) && IS_EXACT(y))
+        return big_sub(x, y);
+    return mk_flonum(num_arg("-", x, 1) - num_arg("-", y, 2));
 }
 
 /* * n n */
 SCM s_times(SCM x, SCM y) {
-    if (!IS_FIXNUM(x))
-        wta_error("*", 1);
-    if (!IS_FIXNUM(y))
-        wta_error("*", 2);
-    return MK_FIXNUM(FIXNUM(x) * FIXNUM(y));
+    int r;
+    if (IS_FIXNUM(x) && IS_FIXNUM(y) && FIXNUM_MUL(x, y, &r))
+        return FIXNUM_OF_BITS(r);
+    if (IS_EXACT(x) && IS_EXACT(y))
+        return big_mul(x, y);
+    return mk_flonum(num_arg("*", x, 1) * num_arg("*", y, 2));
 }
 
 /* / n n */
 SCM s_quotient(SCM x, SCM y) {
-    if (!IS_FIXNUM(x))
-        wta_error("/", 1);
-    if (!IS_FIXNUM(y))
-        wta_error("/", 2);
-    return(MK_FIXNUM(FIXNUM(x) / FIXNUM(y)));
+    SCM rem;
+    if (IS_FIXNUM(x) && IS_FIXNUM(y) && FIXNUM(y) > 0)
+        return MK_FIXNUM(FIXNUM(x) / FIXNUM(y));
+    if (IS_EXACT(x) && IS_EXACT(y))
+        return big_divide(x, y, &rem);
+    return mk_flonum(num_arg("/", x, 1) / num_arg("/", y, 2));
+}
+
+/* The remainder of exact integers X and Y for FNAME, with the sign
+   of Y if MODULOP and that of X otherwise */
+static SCM integer_remainder(char *fname, SCM x, SCM y, int modulop) {
+    SCM rem;
+    if (!IS_EXACT(x))
+        wta_error(fname, 1);
+    if (!IS_EXACT(y))
+        wta_error(fname, 2);
+    if (EQ(y, MK_FIXNUM(0)))
+        error1("ERROR: %s: Division by zero.\n", fname);
+    if (IS_FIXNUM(x) && IS_FIXNUM(y) && FIXNUM(y) > 0) {
+        int r = FIXNUM(x) % FIXNUM(y);
+        return MK_FIXNUM(modulop && r < 0 ? r + FIXNUM(y) : r);
+    }
+    big_divide(x, y, &rem);
+    if (modulop && NEQ(rem, MK_FIXNUM(0)) &&
+        (big_compare(rem, MK_FIXNUM(0)) < 0) !=
+        (big_compare(y, MK_FIXNUM(0)) < 0))
+        rem = big_add(rem, y);
+    return rem;
+}
+
+/* QUOTIENT n n -- exact integers */
+SCM s_integer_quotient(SCM x, SCM y) {
+    if (!IS_EXACT(x))
+        wta_error("quotient", 1);
+    if (!IS_EXACT(y))
+        wta_error("quotient", 2);
+    if (EQ(y, MK_FIXNUM(0)))
+        error1("ERROR: %s: Division by zero.\n", "quotient");
+    return s_quotient(x, y);
+}
+
+/* REMAINDER n n */
+SCM s_remainder(SCM x, SCM y) {
+    return integer_remainder("remainder", x, y, 0);
+}
+
+/* MODULO n n */
+SCM s_modulo(SCM x, SCM y) {
+    return integer_remainder("modulo", x, y, 1);
 }
 
 /* 1+ n */
 SCM s_oneplus(SCM x) {
-    if (!IS_FIXNUM(x))
-        wta_error("1+", 1);
-    return (MK_FIXNUM(FIXNUM(x) + 1));
+    int r;
+    if (IS_FIXNUM(x) && FIXNUM_ADD(x, MK_FIXNUM(1), &r))
+        return FIXNUM_OF_BITS(r);
+    if (IS_EXACT(x))
+        return big_add(x, MK_FIXNUM(1));
+    return mk_flonum(num_arg("1+", x, 1) + 1.0);
 }
 
 /* -1+ n */
 SCM s_minusoneplus(SCM x) {
-    if (!IS_FIXNUM(x))
-        wta_error("-1+", 1);
-    return (MK_FIXNUM(FIXNUM(x) - 1));
+    int r;
+    if (IS_FIXNUM(x) && FIXNUM_SUB(x, MK_FIXNUM(1), &r))
+        return FIXNUM_OF_BITS(r);
+    if (IS_EXACT(x))
+        return big_sub(x, MK_FIXNUM(1));
+    return mk_flonum(num_arg("-1+", x, 1) - 1.0);
 }
 
 /* = n n */
 SCM s_numequal(SCM x, SCM y) {
-    if (!IS_FIXNUM(x))
-        wta_error("=", 1);
-    if (!IS_FIXNUM(y))
-        wta_error("=", 2);
-    return FIXNUM(x) == FIXNUM(y) ? boolean_true : boolean_false;
+    NUM_COMPARE("=", x, y, ==);
 }
 
 /* < n n */
 SCM s_lessthan(SCM x, SCM y) {
-    if (!IS_FIXNUM(x))
-        wta_error("<", 1);
-    if (!IS_FIXNUM(y))
-        wta_error("<", 2);
-    return FIXNUM(x) < FIXNUM(y) ? boolean_true : boolean_false;
+    NUM_COMPARE("<", x, y, <);
 }
 
 /* <= n n */
-SCM s_lessequal (SCM x, SCM y) {
-    if (!IS_FIXNUM(x)) wta_error ("<=", 1);
-    if (!IS_FIXNUM(y)) wta_error ("<=", 2);
-    return FIXNUM(x) <= FIXNUM(y) ? boolean_true : boolean_false;
+SCM s_lessequal(SCM x, SCM y) {
+    NUM_COMPARE("<=", x, y, <=);
 }
 
 /* > n n */
 SCM s_greaterthan(SCM x, SCM y) {
-    if (!IS_FIXNUM(x))
-        wta_error(">", 1);
-    if (!IS_FIXNUM(y))
-        wta_error(">", 2);
-    return FIXNUM(x) > FIXNUM(y) ? boolean_true : boolean_false;
+    NUM_COMPARE(">", x, y, >);
 }
 
 /* >= n n */
 SCM s_greaterequal(SCM x, SCM y) {
-    if (!IS_FIXNUM(x))
-        wta_error(">=", 1);
-    if (!IS_FIXNUM(y))
-        wta_error(">=", 2);
-    return FIXNUM(x) >= FIXNUM(y) ? boolean_true : boolean_false;
+    NUM_COMPARE(">=", x, y, >=);
+}
+
+/* EXACT->INEXACT z, INEXACT z */
+SCM s_exact_to_inexact(SCM x) {
+    return IS_FLONUM(x) ? x : mk_flonum(num_arg("inexact", x, 1));
+}
+
+/* INEXACT->EXACT z, EXACT z */
+SCM s_inexact_to_exact(SCM x) {
+    double d = num_arg("exact", x, 1);
+    if (IS_EXACT(x))
+        return x;
+    if (!isfinite(d) || d != floor(d))
+        error1("ERROR: %s: No exact representation.\n", "exact");
+    if (d >= FIXNUM_MIN && d <= FIXNUM_MAX)
+        return MK_FIXNUM((int)d);
+    return big_from_double(d);
 }
 
+/* The integer-valued functions below give exact integers back as
+   they are. */
+
+/* FLOOR x */
+SCM s_floor(SCM x) {
+    return IS_EXACT(x) ? x : mk_flonum(floor(num_arg("floor", x, 1)));
+}
+
+/* CEILING x */
+SCM s_ceiling(SCM x) {
+    return IS_EXACT(x) ? x : mk_flonum(ceil(num_arg("ceiling", x, 1)));
+}
+
+/* ROUND x -- to even */
+SCM s_round(SCM x) {
+    return IS_EXACT(x) ? x : mk_flonum(rint(num_arg("round", x, 1)));
+}
+
+/* TRUNCATE x */
+SCM s_truncate(SCM x) {
+    return IS_EXACT(x) ? x : mk_flonum(trunc(num_arg("truncate", x, 1)));
+}
+
+/* SQRT z -- exact for the square of a fixnum */
+SCM s_sqrt(SCM x) {
+    double r = sqrt(num_arg("sqrt", x, 1));
+    if (IS_FIXNUM(x) && r == floor(r))
+        return MK_FIXNUM((int)r);
+    return mk_flonum(r);
+}
+
+/* EXPT z1 z2 -- exact for an exact base and a non-negative fixnum
+   exponent */
+SCM s_expt(SCM x, SCM y) {
+    double d;
+    if (IS_EXACT(x) && IS_FIXNUM(y) && FIXNUM(y) >= 0)
+        return big_expt(x, FIXNUM(y));
+    d = num_arg("expt", x, 1);
+    return mk_flonum(pow(d, num_arg("expt", y, 2)));
+}
+
+/* EXP z */
+SCM s_exp(SCM x) {
+    return mk_flonum(exp(num_arg("exp", x, 1)));
+}
+
+/* LOG z [base] */
+SCM s_log(SCM args) {
+    double d;
+    if (check_nargs("log", args, 1, 2) == 1)
+        return mk_flonum(log(num_arg("log", FIRST(args), 1)));
+    d = log(num_arg("log", FIRST(args), 1));
+    return mk_flonum(d / log(num_arg("log", SECOND(args), 2)));
+}
+
+/* SIN z */
+SCM s_sin(SCM x) {
+    return mk_flonum(sin(num_arg("sin", x, 1)));
+}
+
+/* COS z */
+SCM s_cos(SCM x) {
+    return mk_flonum(cos(num_arg("cos", x, 1)));
+}
+
+/* TAN z */
+SCM s_tan(SCM x) {
+    return mk_flonum(tan(num_arg("tan", x, 1)));
+}
+
+/* ASIN z */
+SCM s_asin(SCM x) {
+    return mk_flonum(asin(num_arg("asin", x, 1)));
+}
+
+/* ACOS z */
+SCM s_acos(SCM x) {
+    return mk_flonum(acos(num_arg("acos", x, 1)));
+}
+
+/* ATAN z, ATAN y x */
+SCM s_atan(SCM args) {
+    double d;
+    if (check_nargs("atan", args, 1, 2) == 1)
+        return mk_flonum(atan(num_arg("atan", FIRST(args), 1)));
+    d = num_arg("atan", FIRST(args), 1);
+    return mk_flonum(atan2(d, num_arg("atan", SECOND(args), 2)));
+}
+
+/* Pair and fixnum primitives for compiled code.  The compiler calls
+   these only where it has proved the types of the arguments; the
+   pair ones still fall back to CAR and CDR, which signal the error,
+   so that a wrong proof cannot crash the process.  A value typed as
+   a fixnum may still be a bignum that an overflow has produced, so
+   the fixnum ones only skip the dispatch on flonums: they take the
+   fixnum fast path when they can and the generic one otherwise. */
+
+/* SYS:CAR pair */
+SCM s_sys_car(SCM pair) {
+    return IS_PAIR(pair) ? CAR(pair) : s_car(pair);
+}
+
+/* SYS:CDR pair */
+SCM s_sys_cdr(SCM pair) {
+    return IS_PAIR(pair) ? CDR(pair) : s_cdr(pair);
+}
+
+/* SYS:ZERO? n */
+SCM s_sys_zerop(SCM x) {
+    return EQ(MK_FIXNUM(0),x) ? boolean_true : boolean_false;
+}
+
+/* SYS:1+ n */
+SCM s_sys_oneplus(SCM x) {
+    int r;
+    if (IS_FIXNUM(x) && FIXNUM_ADD(x, MK_FIXNUM(1), &r))
+        return FIXNUM_OF_BITS(r);
+    return big_add(x, MK_FIXNUM(1));
+}
+
+/* SYS:-1+ n */
+SCM s_sys_minusoneplus(SCM x) {
+    int r;
+    if (IS_FIXNUM(x) && FIXNUM_SUB(x, MK_FIXNUM(1), &r))
+        return FIXNUM_OF_BITS(r);
+    return big_sub(x, MK_FIXNUM(1));
+}
+
+/* SYS:+ n n */
+SCM s_sys_plus(SCM x, SCM y) {
+    int r;
+    if (IS_FIXNUM(x) && IS_FIXNUM(y) && FIXNUM_ADD(x, y, &r))
+        return FIXNUM_OF_BITS(r);
+    return big_add(x, y);
+}
+
+/* SYS:- n n */
+SCM s_sys_minus(SCM x, SCM y) {
+    int r;
+    if (IS_FIXNUM(x) && IS_FIXNUM(y) && FIXNUM_SUB(x, y, &r))
+        return FIXNUM_OF_BITS(r);
+    return big_sub(x, y);
+}
+
+/* SYS:* n n */
+SCM s_sys_times(SCM x, SCM y) {
+    int r;
+    if (IS_FIXNUM(x) && IS_FIXNUM(y) && FIXNUM_MUL(x, y, &r))
+        return FIXNUM_OF_BITS(r);
+    return big_mul(x, y);
+}
+
+#define SYS_COMPARE(x, y, op)                                   \
+    if (IS_FIXNUM(x) && IS_FIXNUM(y))                           \
+        return BOOL(FIXNUM(x) op FIXNUM(y));                    \
+    return BOOL(big_compare(x, y) op 0)
+
+/* SYS:= n n */
+SCM s_sys_numequal(SCM x, SCM y) {
+    SYS_COMPARE(x, y, ==);
+}
+
+/* SYS:< n n */
+SCM s_sys_lessthan(SCM x, SCM y) {
+    SYS_COMPARE(x, y, <);
+}
+
+/* SYS:<= n n */
+SCM s_sys_lessequal(SCM x, SCM y) {
+    SYS_COMPARE(x, y, <=);
+}
+
+/* SYS:> n n */
+SCM s_sys_greaterthan(SCM x, SCM y) {
+    SYS_COMPARE(x, y, >);
+}
+
+/* SYS:>= n n */
+SCM s_sys_greaterequal(SCM x, SCM y) {
+    SYS_COMPARE(x, y, >=);
+}
+
+/* STRING->NUMBER string -- #f if it is not the syntax of a number */
 SCM s_string_to_number(SCM s) {
+    SCM x;
     if (!IS_STRING(s))
         wta_error("string->number", 1);
-    return MK_FIXNUM(atoi(STR_DATA(s)));
+    x = parse_number(string_cstring(s));
+    return x != NULL ? x : boolean_false;
 }
 
+/* NUMBER->STRING z */
 SCM s_number_to_string(SCM n) {
-    if (!IS_FIXNUM(n))
-        wta_error("number->string", 1);
-    char *newstr;
-    if ((newstr = (char *)malloc(20)) == NULL)
-        fatal_error("malloc: s_number_to_string");
-    sprintf(newstr, "%d", FIXNUM(n));
+    char buf[FLONUM_BUF_SIZE], *s;
     SCM x;
-    NEWCELL(x, T_STRING);
-    STR_DIM(x) = (unsigned int)strlen(newstr);
-    STR_DATA(x) = newstr;
-    return x;
+    if (IS_FIXNUM(n))
+        sprintf(buf, "%d", FIXNUM(n));
+    else if (IS_BIGNUM(n)) {
+        s = integer_to_string(n);
+        x = mk_string(s, (long)strlen(s));
+        free(s);
+        return x;
+    }
+    else if (IS_FLONUM(n))
+        format_flonum(buf, FLONUM(n));
+    else
+        wta_error("number->string", 1);
+    return mk_string(buf, (long)strlen(buf));
 }
 
 /* Closure */
@@ -427,7 +959,51 @@ SCM s_procedurep(SCM x) {
              IS_SUBR2(x) ||
              IS_SUBR3(x) ||
              IS_SUBRN(x) ||
-             IS_FSUBR(x)) ? boolean_true : boolean_false);
+             IS_FSUBR(x) ||
+             IS_RECORD_PROC(x)) ? boolean_true : boolean_false);
+}
+
+/* PROMISE */
+
+SCM s_promisep(SCM x) {
+    return IS_PROMISE(x) ? boolean_true : boolean_false;
+}
+
+SCM s_make_promise(SCM x) {
+    return IS_PROMISE(x) ? x : mk_promise(boolean_true, x);
+}
+
+/* SYS:MAKE-PROMISE state thunk -- for DELAY and DELAY-FORCE */
+SCM s_sys_make_promise(SCM state, SCM thunk) {
+    return mk_promise(state, thunk);
+}
+
+/* Forcing a DELAY-FORCE promise takes over the box of the promise
+   its thunk returns and goes on with that one, in this loop rather
+   than by recursion, so a long chain runs in constant space. */
+SCM s_force(SCM promise) {
+    SCM box, state, x;
+
+    if (!IS_PROMISE(promise))
+        return promise;
+    for (;;) {
+        box = PROMISE_BOX(promise);
+        state = CAR(box);
+        if (EQ(state, boolean_true))
+            return CDR(box);
+        x = apply_procedure(CDR(box), NIL);
+        box = PROMISE_BOX(promise);
+        if (EQ(CAR(box), boolean_true))     /* forced by the thunk */
+            return CDR(box);
+        if (NEQ(state, boolean_false) || !IS_PROMISE(x)) {
+            CAR(box) = boolean_true;
+            CDR(box) = x;
+            return x;
+        }
+        CAR(box) = CAR(PROMISE_BOX(x));
+        CDR(box) = CDR(PROMISE_BOX(x));
+        PROMISE_BOX(x) = box;
+    }
 }
 
 /* ENVIRONMENT */
@@ -449,6 +1025,58 @@ SCM s_listify_environment(SCM env) {
     return ENV(env);
 }
 
+/* SYSTEM */
+
+static struct {
+    char *name;
+    long *counter;
+} stats[] = {
+    { "CELLS-ALLOCATED", &stat_cells_allocated },
+    { "CALL-CACHE-HITS", &stat_call_cache_hits },
+    { "CALL-CACHE-MISSES", &stat_call_cache_misses },
+    { "INLINE-CALLS", &stat_inline_calls },
+    { "UNCHECKED-CALLS", &stat_unchecked_calls },
+    { "MACRO-EXPANSIONS", &stat_macro_expansions },
+    { "SAFE-POINTS", &stat_safe_points },
+};
+
+#define NSTATS ((int)(sizeof(stats) / sizeof(stats[0])))
+
+/* SYS:STATS -- alist of the interpreter's event counters */
+SCM s_sys_stats(void) {
+    SCM alist = NIL;
+    int i;
+    for (i = NSTATS - 1; i >= 0; i--)
+        alist = CONS(CONS(mk_symbol(stats[i].name),
+                          MK_FIXNUM(*stats[i].counter)),
+                     alist);
+    return alist;
+}
+
+/* SYS:RESET-STATS */
+SCM s_sys_reset_stats(void) {
+    int i;
+    for (i = 0; i < NSTATS; i++)
+        *stats[i].counter = 0;
+    return unspecified_value;
+}
+
+/* SYS:EVAL-MODE -- STACK or RECURSIVE */
+SCM s_sys_eval_mode(void) {
+    return mk_symbol(stack_eval_mode ? "STACK" : "RECURSIVE");
+}
+
+/* SYS:SET-EVAL-MODE! -- takes effect from the next call of evaluate */
+SCM s_sys_set_eval_mode(SCM mode) {
+    if (EQ(mode, mk_symbol("STACK")))
+        stack_eval_mode = YES;
+    else if (EQ(mode, mk_symbol("RECURSIVE")))
+        stack_eval_mode = NO;
+    else
+        wta_error("sys:set-eval-mode!", 1);
+    return unspecified_value;
+}
+
 void init_subrs(void) {
     /* Any */
     mk_subr("EQ?", (SCM (*)(void))s_eq, 2);
@@ -466,8 +1094,47 @@ void init_subrs(void) {
     mk_subr("LIST", (SCM (*)(void))n_list, -1);
     mk_subr("LENGTH", (SCM (*)(void))s_length, 1);
     mk_subr("MEMQ", (SCM (*)(void))s_memq, 2);
+    mk_subr("ASSQ", (SCM (*)(void))s_assq, 2);
     mk_subr("LAST", (SCM (*)(void))s_last, 1);
+    mk_subr("BUTLAST", (SCM (*)(void))s_butlast, 1);
     mk_subr("REC-APPEND", (SCM (*)(void))s_rec_append, 2);
+    SET_FLAG(mk_subr("APPEND", (SCM (*)(void))n_append, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("LIST*", (SCM (*)(void))n_list_star, -1),
+             FLAG_STACK_ARGS);
+    mk_subr("REVERSE", (SCM (*)(void))s_reverse, 1);
+    mk_subr("ASSOC", (SCM (*)(void))n_assoc, -1);
+    mk_subr("MAP1", (SCM (*)(void))s_map1, 2);
+    mk_subr("MAP", (SCM (*)(void))n_map, -1);
+    mk_subr("FOR-EACH", (SCM (*)(void))n_for_each, -1);
+    mk_subr("CAAR", (SCM (*)(void))s_caar, 1);
+    mk_subr("CADR", (SCM (*)(void))s_cadr, 1);
+    mk_subr("CDAR", (SCM (*)(void))s_cdar, 1);
+    mk_subr("CDDR", (SCM (*)(void))s_cddr, 1);
+    mk_subr("CAAAR", (SCM (*)(void))s_caaar, 1);
+    mk_subr("CAADR", (SCM (*)(void))s_caadr, 1);
+    mk_subr("CADAR", (SCM (*)(void))s_cadar, 1);
+    mk_subr("CADDR", (SCM (*)(void))s_caddr, 1);
+    mk_subr("CDAAR", (SCM (*)(void))s_cdaar, 1);
+    mk_subr("CDADR", (SCM (*)(void))s_cdadr, 1);
+    mk_subr("CDDAR", (SCM (*)(void))s_cddar, 1);
+    mk_subr("CDDDR", (SCM (*)(void))s_cdddr, 1);
+    mk_subr("CAAAAR", (SCM (*)(void))s_caaaar, 1);
+    mk_subr("CAAADR", (SCM (*)(void))s_caaadr, 1);
+    mk_subr("CAADAR", (SCM (*)(void))s_caadar, 1);
+    mk_subr("CAADDR", (SCM (*)(void))s_caaddr, 1);
+    mk_subr("CADAAR", (SCM (*)(void))s_cadaar, 1);
+    mk_subr("CADADR", (SCM (*)(void))s_cadadr, 1);
+    mk_subr("CADDAR", (SCM (*)(void))s_caddar, 1);
+    mk_subr("CADDDR", (SCM (*)(void))s_cadddr, 1);
+    mk_subr("CDAAAR", (SCM (*)(void))s_cdaaar, 1);
+    mk_subr("CDAADR", (SCM (*)(void))s_cdaadr, 1);
+    mk_subr("CDADAR", (SCM (*)(void))s_cdadar, 1);
+    mk_subr("CDADDR", (SCM (*)(void))s_cdaddr, 1);
+    mk_subr("CDDAAR", (SCM (*)(void))s_cddaar, 1);
+    mk_subr("CDDADR", (SCM (*)(void))s_cddadr, 1);
+    mk_subr("CDDDAR", (SCM (*)(void))s_cdddar, 1);
+    mk_subr("CDDDDR", (SCM (*)(void))s_cddddr, 1);
 
     /* char */
     mk_subr("CHAR?", (SCM (*)(void))s_charp, 1);
@@ -488,15 +1155,28 @@ void init_subrs(void) {
 
     /* String */
     mk_subr("STRING?", (SCM (*)(void))s_stringp, 1);
-    mk_subr("STRING-APPEND", (SCM (*)(void))s_string_append, -1);
+    SET_FLAG(mk_subr("STRING-APPEND", (SCM (*)(void))s_string_append, -1),
+             FLAG_STACK_ARGS);
 
-    /* Fixnum */
+    /* Numbers */
     mk_subr("NUMBER?", (SCM (*)(void))s_numberp, 1);
+    mk_subr("REAL?", (SCM (*)(void))s_numberp, 1);
+    mk_subr("INTEGER?", (SCM (*)(void))s_integerp, 1);
+    mk_subr("FIXNUM?", (SCM (*)(void))s_fixnump, 1);
+    mk_subr("BIGNUM?", (SCM (*)(void))s_bignump, 1);
+    mk_subr("FLONUM?", (SCM (*)(void))s_flonump, 1);
+    mk_subr("EXACT?", (SCM (*)(void))s_exactp, 1);
+    mk_subr("INEXACT?", (SCM (*)(void))s_inexactp, 1);
+    mk_subr("EQV?", (SCM (*)(void))s_eqv, 2);
+    mk_subr("EQUAL?", (SCM (*)(void))s_equal, 2);
     mk_subr("ZERO?", (SCM (*)(void))s_zerop, 1);
     mk_subr("+", (SCM (*)(void))s_plus, 2);
     mk_subr("-", (SCM (*)(void))s_minus, 2);
     mk_subr("*", (SCM (*)(void))s_times, 2);
     mk_subr("/", (SCM (*)(void))s_quotient, 2);
+    mk_subr("QUOTIENT", (SCM (*)(void))s_integer_quotient, 2);
+    mk_subr("REMAINDER", (SCM (*)(void))s_remainder, 2);
+    mk_subr("MODULO", (SCM (*)(void))s_modulo, 2);
     mk_subr("1+", (SCM (*)(void))s_oneplus, 1);
     mk_subr("-1+", (SCM (*)(void))s_minusoneplus, 1);
     mk_subr("=", (SCM (*)(void))s_numequal, 2);
@@ -504,9 +1184,42 @@ void init_subrs(void) {
     mk_subr("<=", (SCM (*)(void))s_lessequal, 2);
     mk_subr(">", (SCM (*)(void))s_greaterthan, 2);
     mk_subr(">=", (SCM (*)(void))s_greaterequal, 2);
+    mk_subr("EXACT->INEXACT", (SCM (*)(void))s_exact_to_inexact, 1);
+    mk_subr("INEXACT", (SCM (*)(void))s_exact_to_inexact, 1);
+    mk_subr("INEXACT->EXACT", (SCM (*)(void))s_inexact_to_exact, 1);
+    mk_subr("EXACT", (SCM (*)(void))s_inexact_to_exact, 1);
+    mk_subr("FLOOR", (SCM (*)(void))s_floor, 1);
+    mk_subr("CEILING", (SCM (*)(void))s_ceiling, 1);
+    mk_subr("ROUND", (SCM (*)(void))s_round, 1);
+    mk_subr("TRUNCATE", (SCM (*)(void))s_truncate, 1);
+    mk_subr("SQRT", (SCM (*)(void))s_sqrt, 1);
+    mk_subr("EXPT", (SCM (*)(void))s_expt, 2);
+    mk_subr("EXP", (SCM (*)(void))s_exp, 1);
+    SET_FLAG(mk_subr("LOG", (SCM (*)(void))s_log, -1), FLAG_STACK_ARGS);
+    mk_subr("SIN", (SCM (*)(void))s_sin, 1);
+    mk_subr("COS", (SCM (*)(void))s_cos, 1);
+    mk_subr("TAN", (SCM (*)(void))s_tan, 1);
+    mk_subr("ASIN", (SCM (*)(void))s_asin, 1);
+    mk_subr("ACOS", (SCM (*)(void))s_acos, 1);
+    SET_FLAG(mk_subr("ATAN", (SCM (*)(void))s_atan, -1), FLAG_STACK_ARGS);
     mk_subr("STRING->NUMBER", (SCM (*)(void))s_string_to_number, 1);
     mk_subr("NUMBER->STRING", (SCM (*)(void))s_number_to_string, 1);
 
+    /* Unchecked */
+    mk_subr("SYS:CAR", (SCM (*)(void))s_sys_car, 1);
+    mk_subr("SYS:CDR", (SCM (*)(void))s_sys_cdr, 1);
+    mk_subr("SYS:ZERO?", (SCM (*)(void))s_sys_zerop, 1);
+    mk_subr("SYS:1+", (SCM (*)(void))s_sys_oneplus, 1);
+    mk_subr("SYS:-1+", (SCM (*)(void))s_sys_minusoneplus, 1);
+    mk_subr("SYS:+", (SCM (*)(void))s_sys_plus, 2);
+    mk_subr("SYS:-", (SCM (*)(void))s_sys_minus, 2);
+    mk_subr("SYS:*", (SCM (*)(void))s_sys_times, 2);
+    mk_subr("SYS:=", (SCM (*)(void))s_sys_numequal, 2);
+    mk_subr("SYS:<", (SCM (*)(void))s_sys_lessthan, 2);
+    mk_subr("SYS:<=", (SCM (*)(void))s_sys_lessequal, 2);
+    mk_subr("SYS:>", (SCM (*)(void))s_sys_greaterthan, 2);
+    mk_subr("SYS:>=", (SCM (*)(void))s_sys_greaterequal, 2);
+
     /* Closure */
     mk_subr("CLOSURE?", (SCM (*)(void))s_closurep, 1);
     mk_subr("CLOSURE-BODY", (SCM (*)(void))s_closure_body, 1);
@@ -516,11 +1229,29 @@ void init_subrs(void) {
     /* Function */
     mk_subr("PROCEDURE?", (SCM (*)(void))s_procedurep, 1);
 
+    /* Promise */
+    mk_subr("PROMISE?", (SCM (*)(void))s_promisep, 1);
+    mk_subr("MAKE-PROMISE", (SCM (*)(void))s_make_promise, 1);
+    mk_subr("SYS:MAKE-PROMISE", (SCM (*)(void))s_sys_make_promise, 2);
+    mk_subr("FORCE", (SCM (*)(void))s_force, 1);
+
     /* Environment */
     mk_subr("ENVIRONMENT?", (SCM (*)(void))s_environmentp, 1);
     mk_fsubr("THE-ENVIRONMENT", (SCM (*)(void))s_the_environment);
     mk_subr("LISTIFY-ENVIRONMENT", (SCM (*)(void))s_listify_environment, 1);
 
     /* Special */
-    mk_subr("SYS:EVAL", (SCM (*)(void))evaluate, 2);
+    mk_subr("SYS:EVAL", (SCM (*)(void))s_sys_eval, 2);
+    SET_FLAG(mk_subr("VALUES", (SCM (*)(void))s_values, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("APPLY", (SCM (*)(void))s_apply, -1), FLAG_APPLY);
+    mk_subr("CALL-WITH-VALUES", (SCM (*)(void))s_call_with_values, 2);
+    mk_subr("WITH-BUDGET", (SCM (*)(void))s_with_budget, 2);
+    mk_subr("SYS:VALUES-CHECK", (SCM (*)(void))s_sys_values_check, 3);
+    mk_subr("SYS:VALUE-REF", (SCM (*)(void))s_sys_value_ref, 1);
+    mk_subr("SYS:VALUES-REST", (SCM (*)(void))s_sys_values_rest, 1);
+    mk_subr("SYS:STATS", (SCM (*)(void))s_sys_stats, 0);
+    mk_subr("SYS:RESET-STATS", (SCM (*)(void))s_sys_reset_stats, 0);
+    mk_subr("SYS:EVAL-MODE", (SCM (*)(void))s_sys_eval_mode, 0);
+    mk_subr("SYS:SET-EVAL-MODE!", (SCM (*)(void))s_sys_set_eval_mode, 1);
 }
@@ -37,6 +37,10 @@
 #define DEFAULT_NUMCELLS 100000
 #define DEFAULT_OBARRAY_SIZE 512
 #define STRBUF_SIZE 2048
+#define FLONUM_BUF_SIZE 32
+#define MAX_STACK_ARGS 8
+#define MAX_VALUES 16
+#define NO_DEADLINE (-1L)
 
 /* *** Assumption ***
 
@@ -80,7 +84,44 @@ enum {
     T_CLOSURE,
     T_ENV,
     T_PORT,
-    T_EOF_VALUE
+    T_EOF_VALUE,
+    T_PROMISE,
+    T_VECTOR,
+    T_BYTEVECTOR,
+    T_S32VECTOR,
+    T_FLONUM,
+    T_BIGNUM,
+    T_HASHTABLE,
+    T_HAMT_NODE,
+    T_MAP,
+    T_SET,
+    T_RECORD_TYPE,
+    T_RECORD,
+    T_RECORD_PROC
+};
+
+/* The body of a hash table, kept out of its cell (see hashtable.c).
+   An empty slot has a NULL key and value, and a deleted one a NULL
+   key only. */
+struct hashtable {
+    int kind;
+    long size, count, used;
+    struct hash_entry {
+        struct object *key, *value;
+        unsigned hash;
+    } *entries;
+    struct object *equiv, *hash;
+};
+
+/* The characters of a string, kept out of its cell (see string.c).
+   A string owns its buffer, which follows the body and ends with a
+   NUL, or is a slice of the buffer of BASE, which owns it.  HASH
+   caches the string hash, or is 0. */
+struct string {
+    char *data;
+    unsigned hash;
+    struct object *base;
+    char chars[];
 };
 
 struct object {
@@ -106,7 +147,7 @@ struct object {
         struct { struct object *pname, *value; } symbol;
 
         /* Strings */
-        struct { long dim; char *data; } string;
+        struct { long dim; struct string *body; } string;
 
         /* Subrs (functions) */
         struct { struct object *name, *(*fun)(void); } subr;	    
@@ -122,6 +163,35 @@ struct object {
 
         /* EOF value */
         int eof_value;
+
+        /* Promise */
+        struct object *promise;
+
+        /* Vectors */
+        struct { long dim; struct object **data; } vector;
+
+        /* Bytevectors and s32vectors */
+        struct { long dim; void *data; } numvec;
+
+        /* Flonums */
+        double flonum;
+
+        /* Bignums */
+        struct { long size; unsigned int *digits; } bignum;
+
+        /* Hash tables */
+        struct hashtable *hashtable;
+
+        /* Nodes of hash array mapped tries */
+        struct { unsigned bitmap; struct object **slots; } hamt;
+
+        /* Persistent maps and sets */
+        struct { long count; struct object *root; } map;
+
+        /* Record types, records and record procedures */
+        struct { struct object *name, *fields; } rtd;
+        struct { struct object *rtd, **fields; } record;
+        struct { struct object *rtd, *info; } recproc;
     } as;
 };
 
@@ -143,6 +213,29 @@ typedef struct object* SCM;
 #define IS_FIXNUM(x) (((unsigned)(x))&ITYP_FIXNUM)
 #define MK_FIXNUM(n) ((SCM)((((unsigned)(n))<<ITYP_BITS)|ITYP_FIXNUM))
 #define FIXNUM(x)    ((int)(((int)(x))>>ITYP_BITS))
+#define FIXNUM_MAX   ((1 << (31 - ITYP_BITS)) - 1)
+#define FIXNUM_MIN   (-FIXNUM_MAX - 1)
+
+#define IS_FLONUM(x) IS_TYPE(x,T_FLONUM)
+#define FLONUM(x)    ((x)->as.flonum)
+#define IS_BIGNUM(x)  IS_TYPE(x,T_BIGNUM)
+#define BIG_SIZE(x)   ((x)->as.bignum.size)
+#define BIG_DIGITS(x) ((x)->as.bignum.digits)
+#define IS_EXACT(x)   (IS_FIXNUM(x) || IS_BIGNUM(x))
+#define IS_NUMBER(x)  (IS_EXACT(x) || IS_FLONUM(x))
+
+/* Overflow-checked fixnum arithmetic.  The operands are used as
+   tagged, shifted left by ITYP_BITS, so that a result out of fixnum
+   range overflows an int.  FIXNUM_ADD etc. store the shifted result
+   in the int *R and are false on overflow; FIXNUM_OF_BITS boxes it. */
+#define FIXNUM_BITS(x)    ((int)((unsigned)(x) & ~ITYP_MASK))
+#define FIXNUM_OF_BITS(r) ((SCM)(((unsigned)(r)) | ITYP_FIXNUM))
+#define FIXNUM_ADD(x,y,r) \
+    (!__builtin_add_overflow(FIXNUM_BITS(x), FIXNUM_BITS(y), r))
+#define FIXNUM_SUB(x,y,r) \
+    (!__builtin_sub_overflow(FIXNUM_BITS(x), FIXNUM_BITS(y), r))
+#define FIXNUM_MUL(x,y,r) \
+    (!__builtin_mul_overflow(FIXNUM(x), FIXNUM_BITS(y), r))
 
 #define IS_BOOLEAN(x)      IS_TYPE(x,T_BOOLEAN)
 #define BOOLEAN(x) ((x)->as.boolean)
@@ -173,7 +266,10 @@ typedef struct object* SCM;
 
 #define IS_STRING(x) IS_TYPE(x,T_STRING)
 #define STR_DIM(x) ((x)->as.string.dim)
-#define STR_DATA(x) ((x)->as.string.data)
+#define STR_BODY(x) ((x)->as.string.body)
+#define STR_DATA(x) (STR_BODY(x)->data)
+#define STR_HASH(x) (STR_BODY(x)->hash)
+#define STR_BASE(x) (STR_BODY(x)->base)
 
 #define IS_SUBR0(x) IS_TYPE(x,T_SUBR0)
 #define IS_SUBR1(x) IS_TYPE(x,T_SUBR1)
@@ -198,34 +294,130 @@ typedef struct object* SCM;
 #define IS_EOF_VALUE(x) IS_TYPE(x,T_EOF_VALUE)
 #define EOF_VALUE(x) ((x)->as.eof_value)
 
+/* The box is (state . x), shared by the promises that a
+   DELAY-FORCE chain has reduced to one: state #t means x is the
+   value, DELAY that x is a thunk for it, and #f that x is a thunk
+   returning another promise. */
+#define IS_PROMISE(x)  IS_TYPE(x,T_PROMISE)
+#define PROMISE_BOX(x) ((x)->as.promise)
+
+#define IS_VECTOR(x)   IS_TYPE(x,T_VECTOR)
+#define VECTOR_DIM(x)  ((x)->as.vector.dim)
+#define VECTOR_DATA(x) ((x)->as.vector.data)
+
+#define IS_BYTEVECTOR(x) IS_TYPE(x,T_BYTEVECTOR)
+#define IS_S32VECTOR(x)  IS_TYPE(x,T_S32VECTOR)
+#define NUMVEC_DIM(x)    ((x)->as.numvec.dim)
+#define NUMVEC_DATA(x)   ((x)->as.numvec.data)
+#define U8_DATA(x)       ((unsigned char *)NUMVEC_DATA(x))
+#define S32_DATA(x)      ((int *)NUMVEC_DATA(x))
+
+#define IS_HASHTABLE(x) IS_TYPE(x,T_HASHTABLE)
+#define HASHTABLE(x)    ((x)->as.hashtable)
+
+/* A HAMT node has an entry for each bit set in its bitmap, kept in
+   the malloc'ed array of slots after the owner of the node (see
+   hamt.c). */
+#define IS_HAMT_NODE(x) IS_TYPE(x,T_HAMT_NODE)
+#define HAMT_BITMAP(x)  ((x)->as.hamt.bitmap)
+#define HAMT_SLOTS(x)   ((x)->as.hamt.slots)
+#define HAMT_COUNT(x)   __builtin_popcount(HAMT_BITMAP(x))
+
+#define IS_MAP(x)    IS_TYPE(x,T_MAP)
+#define IS_SET(x)    IS_TYPE(x,T_SET)
+#define MAP_COUNT(x) ((x)->as.map.count)
+#define MAP_ROOT(x)  ((x)->as.map.root)
+
+/* A record type has a name and a vector of field names, and a record
+   a malloc'ed array with a value for each of them.  The info of a
+   record procedure is (name . spec), see record.c. */
+#define IS_RECORD_TYPE(x) IS_TYPE(x,T_RECORD_TYPE)
+#define RTD_NAME(x)       ((x)->as.rtd.name)
+#define RTD_FIELDS(x)     ((x)->as.rtd.fields)
+#define RTD_NFIELDS(x)    VECTOR_DIM(RTD_FIELDS(x))
+
+#define IS_RECORD(x)     IS_TYPE(x,T_RECORD)
+#define RECORD_RTD(x)    ((x)->as.record.rtd)
+#define RECORD_FIELDS(x) ((x)->as.record.fields)
+
+#define IS_RECORD_PROC(x) IS_TYPE(x,T_RECORD_PROC)
+#define RECPROC_RTD(x)    ((x)->as.recproc.rtd)
+#define RECPROC_INFO(x)   ((x)->as.recproc.info)
+#define RECPROC_NAME(x)   CAR(RECPROC_INFO(x))
+
 #define IS_FREE_CELL(x) IS_TYPE(x,T_FREE_CELL)
 
 
 /* Garbage collection */
 
+/* The lowest bit of gc_tags is the mark bit; the other bits hold
+   per-object flags that survive collections (see FLAG_*). */
+
 #define GC_TAGS(x)  ((x)->gc_tags)
-#define MARK(x)     (GC_TAGS(x) = (unsigned short)1)
-#define UNMARK(x)   (GC_TAGS(x) = (unsigned short)0)
-#define MARKED(x)   (GC_TAGS(x) == (unsigned short)1)
-#define UNMARKED(x) (GC_TAGS(x) == (unsigned short)0)
+#define GC_MARK_BIT ((unsigned short)1)
+#define MARK(x)     (GC_TAGS(x) |= GC_MARK_BIT)
+#define UNMARK(x)   (GC_TAGS(x) &= (unsigned short)~GC_MARK_BIT)
+#define MARKED(x)   ((GC_TAGS(x) & GC_MARK_BIT) != 0)
+#define UNMARKED(x) ((GC_TAGS(x) & GC_MARK_BIT) == 0)
 
 #define NEWCELL(_place, _type)                  \
     { if IS_NULL(free_list) gc();               \
         _place = free_list;                     \
         free_list = CDR(free_list);             \
-        UNMARK(_place);                         \
+        GC_TAGS(_place) = (unsigned short)0;    \
         SET_BOXED_TYPE(_place, _type);          \
+        stat_cells_allocated++;                 \
     }
 
+/* Object flags */
+
+/* symbol: has been bound in a local environment at least once */
+#define FLAG_LEXICAL ((unsigned short)2)
+/* subrn: does not retain its argument list (may get it on the stack) */
+#define FLAG_STACK_ARGS ((unsigned short)4)
+/* named let or do form: checked whether it can run in place */
+#define FLAG_LOOP_CHECKED ((unsigned short)8)
+/* named let or do form: can update its variables in place;
+   closure: the procedure of such a named let */
+#define FLAG_LOOP ((unsigned short)16)
+/* subrn: APPLY, whose calls the evaluator turns into tail calls */
+#define FLAG_APPLY ((unsigned short)32)
+/* map or set: a transient, which is updated in place */
+#define FLAG_TRANSIENT ((unsigned short)64)
+
+#define HAS_FLAG(x,f)   ((GC_TAGS(x) & (f)) != 0)
+#define SET_FLAG(x,f)   (GC_TAGS(x) |= (f))
+#define CLEAR_FLAG(x,f) (GC_TAGS(x) &= (unsigned short)~(f))
+
+#define IS_LEXICAL(x) HAS_FLAG(x, FLAG_LEXICAL)
+
+/* subr: opcode of a primitive inlined by the evaluator (bits 8-15) */
+#define INLINE_OP(x)        (GC_TAGS(x) >> 8)
+#define SET_INLINE_OP(x,op) (GC_TAGS(x) |= (unsigned short)((op) << 8))
+
 /* external variable declarations */
 
+/* eval.c */
+extern int stack_eval_mode;
+extern SCM *eval_stack;
+extern long eval_stack_ptr, eval_frame;
+extern long stat_call_cache_hits, stat_call_cache_misses, stat_inline_calls,
+    stat_unchecked_calls;
+extern SCM multiple_values, mv_values[];
+extern long eval_deadline, stat_safe_points;
+extern int mv_count;
+
 /* error.c */
 extern jmp_buf error_return;
 
+/* simplify.c */
+extern long stat_macro_expansions;
+
 /* storage.c */
 /* extern SCM heap_start, heap_end; */
 extern SCM free_list;
 extern SCM stack_start;
+extern long stat_cells_allocated;
 extern SCM obarray[];
 extern long obarray_dim;
 extern SCM the_null_value, boolean_true, boolean_false;
@@ -234,7 +426,7 @@ extern SCM unbound_value, unspecified_value,
     sym_quote, sym_quasiquote, sym_unquote, sym_unquote_splicing,
     sym_lambda, sym_and, sym_or, sym_let, sym_let_star, sym_letrec,
     sym_begin, sym_do, sym_delay, sym_if, sym_cond, sym_case, sym_else,
-    sym_set, sym_define, sym_dot;
+    sym_set, sym_define, sym_dot, sym_sys_lambda;
 extern SCM sym_toplevel;
 
 /* function prototypes */
@@ -249,20 +441,52 @@ void show_obarray(void);
 
 /* object.c */
 SCM mk_pair(SCM car, SCM cdr);
+struct string *mk_string_body(char *string, long dim);
 SCM mk_string(char *string, long dim);
+SCM mk_string_slice(SCM base, char *data, long dim);
+SCM mk_character(int c);
 SCM newsym(SCM pname, SCM value);
 SCM mk_symbol(char *name);
 SCM mk_subr(char *name, SCM (*fun)(void), int nargs);
 SCM mk_fsubr(char *name, SCM (*fun)(void));
-SCM mk_closure(SCM args, SCM code, SCM env);
+SCM mk_closure(SCM code, SCM env);
+SCM mk_promise(SCM state, SCM x);
+SCM mk_vector(long dim, SCM fill);
+SCM mk_numvec(int type, long dim);
+SCM mk_flonum(double d);
+SCM mk_bignum(long size, unsigned int *digits);
+SCM mk_hashtable(struct hashtable *table);
+SCM mk_hamt_node(unsigned bitmap, SCM *slots);
+SCM mk_map(int type, long count, SCM root);
+SCM mk_record_type(SCM name, SCM fields);
+SCM mk_record(SCM rtd);
+SCM mk_record_proc(SCM rtd, SCM info);
 
 /* subrs.c */
 
+int eqv(SCM x, SCM y);
+int equal(SCM x, SCM y);
+SCM s_lessthan(SCM x, SCM y);
+SCM s_greaterthan(SCM x, SCM y);
 void init_subrs(void);
 
 /* eval.c */
 
 SCM evaluate(SCM exp, SCM env);
+SCM s_sys_eval(SCM exp, SCM env);
+SCM apply_procedure(SCM fun, SCM args);
+SCM s_apply(SCM args);
+SCM s_values(SCM args);
+SCM s_call_with_values(SCM producer, SCM consumer);
+SCM s_sys_values_check(SCM x, SCM n, SCM restp);
+SCM s_sys_value_ref(SCM i);
+SCM s_sys_values_rest(SCM i);
+void set_eval_deadline(long d);
+void request_interrupt(void);
+SCM s_with_budget(SCM n, SCM thunk);
+void invalidate_call_caches(void);
+void reset_eval_stack(void);
+void init_eval(void);
 
 /* error.c */
 
@@ -272,23 +496,84 @@ void fatal_error(char *message);
 void error0(char *message);
 void error1(char *message, char *arg);
 int check_nargs(char *fname, SCM args, int min, int max);
+void reset_handlers(void);
+void init_error_subrs(void);
+
+/* bignum.c */
+
+SCM mk_integer(long long n);
+int integer_value(SCM x, long long *n);
+SCM big_add(SCM x, SCM y);
+SCM big_sub(SCM x, SCM y);
+SCM big_mul(SCM x, SCM y);
+SCM big_divide(SCM x, SCM y, SCM *rem);
+int big_compare(SCM x, SCM y);
+double big_to_double(SCM x);
+SCM big_from_double(double d);
+SCM big_expt(SCM x, long k);
+SCM parse_integer(char *s);
+char *integer_to_string(SCM x);
+
+/* vector.c */
+
+SCM s_list_to_vector(SCM list);
+void init_vector_subrs(void);
+
+/* bytevector.c */
+
+SCM s_list_to_bytevector(SCM list);
+SCM s_list_to_s32vector(SCM list);
+void init_bytevector_subrs(void);
+
+/* hashtable.c */
+
+unsigned equal_hash_value(SCM x);
+void init_hashtable_subrs(void);
+
+/* hamt.c */
+
+void init_hamt_subrs(void);
+
+/* record.c */
+
+SCM apply_record_proc(SCM proc, SCM *vals, int n);
+void init_record_subrs(void);
+
+/* string.c */
+
+char *string_cstring(SCM s);
+int string_equal(SCM x, SCM y);
+int string_compare(SCM x, SCM y);
+SCM s_string_lessthan(SCM args);
+void init_string_subrs(void);
+
+/* sort.c */
+
+void init_sort_subrs(void);
 
 /* io.c */
 
 SCM scm_write(SCM data, SCM port, int displayp);
+void format_flonum(char *buf, double d);
 void do_load(char *file);
 void do_load_if_exists(char *file);
 void init_io_subrs(void);
 
+/* simplify.c */
+
+void init_simplify_subrs(void);
+
 /* read.c */
 
 SCM n_read(SCM args);
 SCM scm_read(SCM port);
 SCM do_read(FILE *fp);
+SCM parse_number(char *s);
 
 /* misc.c */
 
 int memq(SCM key, SCM list);
+int memv(SCM key, SCM list);
 SCM map1(SCM (*f)(SCM), SCM list);
 
 /* EOF */
@@ -0,0 +1,284 @@
+/*
+ * Tscheme: A Tiny Scheme Interpreter
+ * Copyright (c) 1995-2013 Takuo WATANABE (Tokyo Institute of Technology)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <setjmp.h>
+
+#include "tscheme.h"
+
+/* Vectors
+
+   The elements of a vector are kept in a malloc'ed array, which gc
+   marks through and frees together with the cell, as the text of a
+   string.  Procedures taking optional START and END arguments are
+   SUBRNs that check their argument lists themselves. */
+
+/* The index K of an element of VEC, which is argument ARGNO of
+   FNAME; with endp, K may also be the length of VEC. */
+static long vector_index(char *fname, SCM vec, SCM k, int argno,
+                         bool endp) {
+    if (!IS_FIXNUM(k))
+        wta_error(fname, argno);
+    if (FIXNUM(k) < 0 || FIXNUM(k) > VECTOR_DIM(vec) ||
+        (FIXNUM(k) == VECTOR_DIM(vec) && !endp))
+        error1("ERROR: %s: Index out of range.\n", fname);
+    return FIXNUM(k);
+}
+
+/* Reads the optional START and END arguments in ARGS, the first of
+   which is argument ARGNO of FNAME, into *START and *END. */
+static void vector_range(char *fname, SCM vec, SCM args, int argno,
+                         long *start, long *end) {
+    *start = 0;
+    *end = VECTOR_DIM(vec);
+    if (IS_PAIR(args)) {
+        *start = vector_index(fname, vec, CAR(args), argno, true);
+        args = CDR(args);
+    }
+    if (IS_PAIR(args))
+        *end = vector_index(fname, vec, CAR(args), argno + 1, true);
+    if (*end < *start)
+        error1("ERROR: %s: Index out of range.\n", fname);
+}
+
+/* VECTOR? x */
+SCM s_vectorp(SCM x) {
+    return IS_VECTOR(x) ? boolean_true : boolean_false;
+}
+
+/* MAKE-VECTOR k [fill] */
+SCM s_make_vector(SCM args) {
+    int n = check_nargs("make-vector", args, 1, 2);
+    if (!IS_FIXNUM(CAR(args)) || FIXNUM(CAR(args)) < 0)
+        wta_error("make-vector", 1);
+    return mk_vector(FIXNUM(CAR(args)),
+                     n == 2 ? SECOND(args) : unspecified_value);
+}
+
+/* VECTOR x... */
+SCM s_vector(SCM args) {
+    return s_list_to_vector(args);
+}
+
+/* VECTOR-LENGTH vector */
+SCM s_vector_length(SCM vec) {
+    if (!IS_VECTOR(vec))
+        wta_error("vector-length", 1);
+    return MK_FIXNUM(VECTOR_DIM(vec));
+}
+
+/* VECTOR-REF vector k */
+SCM s_vector_ref(SCM vec, SCM k) {
+    if (!IS_VECTOR(vec))
+        wta_error("vector-ref", 1);
+    return VECTOR_DATA(vec)[vector_index("vector-ref", vec, k, 2, false)];
+}
+
+/* VECTOR-SET! vector k x */
+SCM s_vector_set(SCM vec, SCM k, SCM x) {
+    if (!IS_VECTOR(vec))
+        wta_error("vector-set!", 1);
+    VECTOR_DATA(vec)[vector_index("vector-set!", vec, k, 2, false)] = x;
+    return unspecified_value;
+}
+
+/* VECTOR-FILL! vector x [start [end]] */
+SCM s_vector_fill(SCM args) {
+    SCM vec;
+    long i, end;
+
+    check_nargs("vector-fill!", args, 2, 4);
+    if (!IS_VECTOR(vec = CAR(args)))
+        wta_error("vector-fill!", 1);
+    vector_range("vector-fill!", vec, CDDR(args), 3, &i, &end);
+    for (; i < end; i++)
+        VECTOR_DATA(vec)[i] = SECOND(args);
+    return unspecified_value;
+}
+
+/* VECTOR->LIST vector [start [end]] */
+SCM s_vector_to_list(SCM args) {
+    SCM vec, l = NIL;
+    long start, i;
+
+    check_nargs("vector->list", args, 1, 3);
+    if (!IS_VECTOR(vec = CAR(args)))
+        wta_error("vector->list", 1);
+    vector_range("vector->list", vec, CDR(args), 2, &start, &i);
+    while (i > start)
+        l = CONS(VECTOR_DATA(vec)[--i], l);
+    return l;
+}
+
+/* LIST->VECTOR list */
+SCM s_list_to_vector(SCM list) {
+    SCM l, vec;
+    long n = 0;
+
+    for (l = list; IS_PAIR(l); l = CDR(l))
+        n++;
+    if (!IS_NULL(l))
+        wta_error("list->vector", 1);
+    vec = mk_vector(n, unspecified_value);
+    for (n = 0, l = list; IS_PAIR(l); l = CDR(l))
+        VECTOR_DATA(vec)[n++] = CAR(l);
+    return vec;
+}
+
+/* VECTOR-COPY vector [start [end]] */
+SCM s_vector_copy(SCM args) {
+    SCM vec, copy;
+    long start, end, i;
+
+    check_nargs("vector-copy", args, 1, 3);
+    if (!IS_VECTOR(vec = CAR(args)))
+        wta_error("vector-copy", 1);
+    vector_range("vector-copy", vec, CDR(args), 2, &start, &end);
+    copy = mk_vector(end - start, unspecified_value);
+    for (i = start; i < end; i++)
+        VECTOR_DATA(copy)[i - start] = VECTOR_DATA(vec)[i];
+    return copy;
+}
+
+/* VECTOR-COPY! to at from [start [end]] -- the ranges may overlap */
+SCM s_vector_copy_to(SCM args) {
+    SCM to, from;
+    long at, start, end;
+
+    check_nargs("vector-copy!", args, 3, 5);
+    if (!IS_VECTOR(to = FIRST(args)))
+        wta_error("vector-copy!", 1);
+    at = vector_index("vector-copy!", to, SECOND(args), 2, true);
+    if (!IS_VECTOR(from = THIRD(args)))
+        wta_error("vector-copy!", 3);
+    vector_range("vector-copy!", from, CDR(CDDR(args)), 4, &start, &end);
+    if (end - start > VECTOR_DIM(to) - at)
+        error1("ERROR: %s: Index out of range.\n", "vector-copy!");
+    if (at <= start)
+        for (; start < end; start++)
+            VECTOR_DATA(to)[at++] = VECTOR_DATA(from)[start];
+    else
+        for (at += end - start; start < end; )
+            VECTOR_DATA(to)[--at] = VECTOR_DATA(from)[--end];
+    return unspecified_value;
+}
+
+/* VECTOR-APPEND vector... */
+SCM s_vector_append(SCM args) {
+    SCM l, vec;
+    long n = 0, i;
+    int argno = 0;
+
+    for (l = args; IS_PAIR(l); l = CDR(l)) {
+        argno++;
+        if (!IS_VECTOR(CAR(l)))
+            wta_error("vector-append", argno);
+        n += VECTOR_DIM(CAR(l));
+    }
+    vec = mk_vector(n, unspecified_value);
+    for (n = 0, l = args; IS_PAIR(l); l = CDR(l))
+        for (i = 0; i < VECTOR_DIM(CAR(l)); i++)
+            VECTOR_DATA(vec)[n++] = VECTOR_DATA(CAR(l))[i];
+    return vec;
+}
+
+/* The length of the shortest of the vectors VECS, the arguments of
+   FNAME from the second on. */
+static long vectors_min_length(char *fname, SCM vecs) {
+    long n = -1;
+    int argno = 1;
+
+    if (!IS_PAIR(vecs))
+        wna_error(fname, 1);
+    for (; IS_PAIR(vecs); vecs = CDR(vecs)) {
+        argno++;
+        if (!IS_VECTOR(CAR(vecs)))
+            wta_error(fname, argno);
+        if (n < 0 || VECTOR_DIM(CAR(vecs)) < n)
+            n = VECTOR_DIM(CAR(vecs));
+    }
+    return n;
+}
+
+/* The list of the I-th elements of the vectors VECS */
+static SCM vectors_ref(SCM vecs, long i) {
+    if (IS_NULL(vecs))
+        return NIL;
+    return CONS(VECTOR_DATA(CAR(vecs))[i], vectors_ref(CDR(vecs), i));
+}
+
+/* VECTOR-MAP proc vector... */
+SCM s_vector_map(SCM args) {
+    SCM vec;
+    long n, i;
+
+    if (!IS_PAIR(args))
+        wna_error("vector-map", 0);
+    n = vectors_min_length("vector-map", CDR(args));
+    vec = mk_vector(n, unspecified_value);
+    for (i = 0; i < n; i++)
+        VECTOR_DATA(vec)[i] =
+            apply_procedure(CAR(args), vectors_ref(CDR(args), i));
+    return vec;
+}
+
+/* VECTOR-FOR-EACH proc vector... */
+SCM s_vector_for_each(SCM args) {
+    long n, i;
+
+    if (!IS_PAIR(args))
+        wna_error("vector-for-each", 0);
+    n = vectors_min_length("vector-for-each", CDR(args));
+    for (i = 0; i < n; i++)
+        apply_procedure(CAR(args), vectors_ref(CDR(args), i));
+    return unspecified_value;
+}
+
+void init_vector_subrs(void) {
+    mk_subr("VECTOR?", (SCM (*)(void))s_vectorp, 1);
+    SET_FLAG(mk_subr("MAKE-VECTOR", (SCM (*)(void))s_make_vector, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("VECTOR", (SCM (*)(void))s_vector, -1),
+             FLAG_STACK_ARGS);
+    mk_subr("VECTOR-LENGTH", (SCM (*)(void))s_vector_length, 1);
+    mk_subr("VECTOR-REF", (SCM (*)(void))s_vector_ref, 2);
+    mk_subr("VECTOR-SET!", (SCM (*)(void))s_vector_set, 3);
+    SET_FLAG(mk_subr("VECTOR-FILL!", (SCM (*)(void))s_vector_fill, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("VECTOR->LIST", (SCM (*)(void))s_vector_to_list, -1),
+             FLAG_STACK_ARGS);
+    mk_subr("LIST->VECTOR", (SCM (*)(void))s_list_to_vector, 1);
+    SET_FLAG(mk_subr("VECTOR-COPY", (SCM (*)(void))s_vector_copy, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("VECTOR-COPY!", (SCM (*)(void))s_vector_copy_to, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("VECTOR-APPEND", (SCM (*)(void))s_vector_append, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("VECTOR-MAP", (SCM (*)(void))s_vector_map, -1),
+             FLAG_STACK_ARGS);
+    SET_FLAG(mk_subr("VECTOR-FOR-EACH",
+                     (SCM (*)(void))s_vector_for_each, -1),
+             FLAG_STACK_ARGS);
+}